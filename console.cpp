@@ -45,12 +45,24 @@ void printArgs(const char_t* format, va_list args)
 #ifdef PLATFORM_UNIX
 
 static volatile bool screenSizeChanged = false;
+static int wakePipe[2] = { -1, -1 };
 
 extern "C" void onSIGWINCH(int sig)
 {
     screenSizeChanged = true;
 }
 
+static bool takeWake()
+{
+    char chars[16];
+    bool woken = false;
+
+    while (read(wakePipe[0], chars, sizeof(chars)) > 0)
+        woken = true;
+
+    return woken;
+}
+
 struct KeyMapping
 {
     int len;
@@ -311,11 +323,13 @@ BackgroundColor Console::_defaultBackground;
 
 #ifdef PLATFORM_WINDOWS
 Buffer<INPUT_RECORD> Console::_inputRecords(16);
+HANDLE Console::_wakeEvent = nullptr;
 #else
 Array<char> Console::_inputChars(16);
 #endif
 
 Array<InputEvent> Console::_inputEvents;
+ConsoleStatistics Console::_statistics;
 
 void Console::initialize()
 {
@@ -338,11 +352,24 @@ void Console::initialize()
 
     _defaultBackground = static_cast<BackgroundColor>(
         csbi.wAttributes & (BACKGROUND_RED | BACKGROUND_GREEN | BACKGROUND_BLUE | BACKGROUND_INTENSITY));
+
+    _wakeEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    ASSERT(_wakeEvent);
 #else
     int rc = setvbuf(stdout, nullptr, _IONBF, 0);
     ASSERT(rc == 0);
 
     signal(SIGWINCH, onSIGWINCH);
+    installReadFaultHandler();
+
+    rc = pipe(wakePipe);
+    ASSERT(rc == 0);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        fcntl(wakePipe[i], F_SETFL, O_NONBLOCK);
+        fcntl(wakePipe[i], F_SETFD, FD_CLOEXEC);
+    }
 
     _defaultForeground = FOREGROUND_COLOR_DEFAULT;
     _defaultBackground = BACKGROUND_COLOR_DEFAULT;
@@ -357,6 +384,23 @@ void Console::shutdown()
     setColor(_defaultForeground, _defaultBackground);
 }
 
+void Console::wake()
+{
+    // makes readInput() return without events, can be called from any thread
+
+#ifdef PLATFORM_WINDOWS
+    if (_wakeEvent)
+        SetEvent(_wakeEvent);
+#else
+    if (wakePipe[1] >= 0)
+    {
+        char ch = 0;
+        ssize_t rc = ::write(wakePipe[1], &ch, 1);
+        (void)rc;
+    }
+#endif
+}
+
 bool Console::brightBackground()
 {
 #ifdef PLATFORM_WINDOWS
@@ -448,9 +492,29 @@ void Console::write(const char_t* chars, int len)
     DWORD written;
     BOOL rc = WriteConsole(handle, chars, l, &written, nullptr);
     ASSERT(rc);
+
+    ++_statistics.writes;
+    _statistics.bytes += l * sizeof(char_t);
 #else
-    int written = ::write(STDOUT_FILENO, chars, l);
-    ASSERT(written >= 0);
+    // a large frame may be accepted in several pieces or interrupted by SIGWINCH
+
+    while (l > 0)
+    {
+        ssize_t written = ::write(STDOUT_FILENO, chars, l);
+        ++_statistics.writes;
+
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            break;
+        }
+
+        _statistics.bytes += written;
+        chars += written;
+        l -= static_cast<int>(written);
+    }
 #endif
 }
 
@@ -522,13 +586,14 @@ void Console::write(int line, int column, const char_t* chars, int len)
     rc = WriteConsole(handle, chars, l, &written, nullptr);
     ASSERT(rc);
 
+    ++_statistics.writes;
+    _statistics.bytes += l * sizeof(char_t);
+
     rc = SetConsoleMode(handle, ENABLE_PROCESSED_OUTPUT | ENABLE_WRAP_AT_EOL_OUTPUT);
     ASSERT(rc);
 #else
     setCursorPosition(line, column);
-
-    int written = ::write(STDOUT_FILENO, chars, l);
-    ASSERT(written >= 0);
+    write(chars, l);
 #endif
 }
 
@@ -727,19 +792,22 @@ void Console::getSize(int& width, int& height)
 
 void Console::clear()
 {
-    printf("\x1b[2J\x1b[1;1H");
+    write(STR("\x1b[2J\x1b[1;1H"));
 }
 
 void Console::showCursor(bool show)
 {
-    printf(show ? "\x1b[?25h" : "\x1b[?25l");
+    write(show ? STR("\x1b[?25h") : STR("\x1b[?25l"));
 }
 
 void Console::setCursorPosition(int line, int column)
 {
     ASSERT(line > 0);
     ASSERT(column > 0);
-    printf("\x1b[%d;%dH", line, column);
+
+    char_t chars[32];
+    int len = snprintf(chars, sizeof(chars), "\x1b[%d;%dH", line, column);
+    write(chars, len);
 }
 
 #endif
@@ -753,7 +821,12 @@ const Array<InputEvent>& Console::readInput()
     HANDLE handle = GetStdHandle(STD_INPUT_HANDLE);
     ASSERT(handle);
 
-    if (WaitForSingleObject(handle, INFINITE) == WAIT_OBJECT_0)
+    HANDLE handles[] = { handle, _wakeEvent };
+    DWORD wait = WaitForMultipleObjects(_wakeEvent ? 2 : 1, handles, FALSE, INFINITE);
+
+    if (wait == WAIT_OBJECT_0 + 1)
+        ResetEvent(_wakeEvent);
+    else if (wait == WAIT_OBJECT_0)
     {
         DWORD numInputRec = 0;
         BOOL rc = GetNumberOfConsoleInputEvents(handle, &numInputRec);
@@ -956,8 +1029,10 @@ const Array<InputEvent>& Console::readInput()
                 _inputEvents.addLast(InputEvent(windowEvent));
                 return _inputEvents;
             }
+            else if (takeWake())
+                return _inputEvents;
             else
-                usleep(10000);
+                waitForInput(100);
         }
     }
 
@@ -1089,3 +1164,36 @@ const Array<InputEvent>& Console::readInput()
 
     return _inputEvents;
 }
+
+bool Console::waitForInput(int timeout)
+{
+    // true if input or wake() arrives within timeout milliseconds, 0 only checks for input
+    // already waiting
+
+    ASSERT(timeout >= 0);
+
+#ifdef PLATFORM_WINDOWS
+    HANDLE handle = GetStdHandle(STD_INPUT_HANDLE);
+    ASSERT(handle);
+
+    HANDLE handles[] = { handle, _wakeEvent };
+    DWORD rc = WaitForMultipleObjects(_wakeEvent ? 2 : 1, handles, FALSE, timeout);
+
+    if (rc == WAIT_OBJECT_0 + 1)
+        return true;
+    else if (rc != WAIT_OBJECT_0)
+        return false;
+
+    DWORD numInputRec = 0;
+    BOOL rc = GetNumberOfConsoleInputEvents(handle, &numInputRec);
+    ASSERT(rc);
+
+    return numInputRec > 0;
+#else
+    if (screenSizeChanged)
+        return true;
+
+    pollfd pfds[] = { { STDIN_FILENO, POLLIN, 0 }, { wakePipe[0], POLLIN, 0 } };
+    return poll(pfds, wakePipe[0] >= 0 ? 2 : 1, timeout) > 0 || screenSizeChanged;
+#endif
+}
@@ -140,6 +140,14 @@ enum BackgroundColor
 #endif
 };
 
+// ConsoleStatistics
+
+struct ConsoleStatistics
+{
+    int64_t writes;
+    int64_t bytes;
+};
+
 // Console
 
 class Console
@@ -192,6 +200,13 @@ public:
     static void setCursorPosition(int line, int column);
 
     static const Array<InputEvent>& readInput();
+    static bool waitForInput(int timeout);
+    static void wake();
+
+    static const ConsoleStatistics& statistics()
+    {
+        return _statistics;
+    }
 
 protected:
     static ForegroundColor _defaultForeground;
@@ -199,11 +214,13 @@ protected:
 
 #ifdef PLATFORM_WINDOWS
     static Buffer<INPUT_RECORD> _inputRecords;
+    static HANDLE _wakeEvent;
 #else
     static Array<char> _inputChars;
 #endif
 
     static Array<InputEvent> _inputEvents;
+    static ConsoleStatistics _statistics;
 };
 
 #endif
@@ -5,8 +5,10 @@ const char_t* APPLICATION_NAME = STR("ev");
 
 #ifdef PLATFORM_WINDOWS
 const char_t* CONFIG_FILE_NAME = STR("ev.cfg");
+const char_t* PROJECT_INDEX_FILE_NAME = STR("ev.idx");
 #else
 const char_t* CONFIG_FILE_NAME = STR(".ev.cfg");
+const char_t* PROJECT_INDEX_FILE_NAME = STR(".ev.idx");
 #endif
 
 #ifdef GUI_MODE
@@ -21,11 +23,28 @@ uint32_t rgbColors[] = {
 
 #endif
 
+const int HIGHLIGHTING_CHECKPOINT_INTERVAL = 100;
+const int MAX_AUTOCOMPLETE_SUGGESTIONS = 50;
+const int MAX_CONSOLE_COLORS = 128;
+const int64_t MAX_FRAME_DELAY = 100000;
+const int MAX_UNDO_LIMIT = 1024;
+const int64_t BACKGROUND_DECODE_SIZE = 16 * 1024 * 1024;
+const int VIEWPORT_DECODE_SIZE = 256 * 1024;
+
 bool charIsWord(unichar_t ch)
 {
     return charIsAlphaNum(ch) || ch == '_';
 }
 
+void addWordCount(FlatMap<String, int>& words, const String& word, int count)
+{
+    int& n = words[word];
+    n += count;
+
+    if (n == 0)
+        words.remove(word);
+}
+
 bool isWordBoundary(unichar_t prevCh, unichar_t ch)
 {
     return (!charIsWord(prevCh) && charIsWord(ch)) ||
@@ -120,619 +139,88 @@ ScreenCell::ScreenCell() :
 {
 }
 
-// CppSyntaxHighlighter
-
-CppSyntaxHighlighter::CppSyntaxHighlighter() : SyntaxHighlighter(DOCUMENT_TYPE_CPP)
-{
-    _keywords.add(String(STR("alignas")));
-    _keywords.add(String(STR("alignof")));
-    _keywords.add(String(STR("and")));
-    _keywords.add(String(STR("and_eq")));
-    _keywords.add(String(STR("asm")));
-    _keywords.add(String(STR("atomic_cancel")));
-    _keywords.add(String(STR("atomic_commit")));
-    _keywords.add(String(STR("atomic_noexcept")));
-    _keywords.add(String(STR("bitand")));
-    _keywords.add(String(STR("bitor")));
-    _keywords.add(String(STR("break")));
-    _keywords.add(String(STR("case")));
-    _keywords.add(String(STR("catch")));
-    _keywords.add(String(STR("class")));
-    _keywords.add(String(STR("compl")));
-    _keywords.add(String(STR("concept")));
-    _keywords.add(String(STR("const_cast")));
-    _keywords.add(String(STR("continue")));
-    _keywords.add(String(STR("co_await")));
-    _keywords.add(String(STR("co_return")));
-    _keywords.add(String(STR("co_yield")));
-    _keywords.add(String(STR("decltype")));
-    _keywords.add(String(STR("default")));
-    _keywords.add(String(STR("delete")));
-    _keywords.add(String(STR("do")));
-    _keywords.add(String(STR("dynamic_cast")));
-    _keywords.add(String(STR("else")));
-    _keywords.add(String(STR("enum")));
-    _keywords.add(String(STR("explicit")));
-    _keywords.add(String(STR("export")));
-    _keywords.add(String(STR("extern")));
-    _keywords.add(String(STR("false")));
-    _keywords.add(String(STR("for")));
-    _keywords.add(String(STR("friend")));
-    _keywords.add(String(STR("goto")));
-    _keywords.add(String(STR("if")));
-    _keywords.add(String(STR("import")));
-    _keywords.add(String(STR("inline")));
-    _keywords.add(String(STR("module")));
-    _keywords.add(String(STR("mutable")));
-    _keywords.add(String(STR("namespace")));
-    _keywords.add(String(STR("new")));
-    _keywords.add(String(STR("noexcept")));
-    _keywords.add(String(STR("not")));
-    _keywords.add(String(STR("not_eq")));
-    _keywords.add(String(STR("nullptr")));
-    _keywords.add(String(STR("operator")));
-    _keywords.add(String(STR("or")));
-    _keywords.add(String(STR("or_eq")));
-    _keywords.add(String(STR("private")));
-    _keywords.add(String(STR("protected")));
-    _keywords.add(String(STR("public")));
-    _keywords.add(String(STR("register")));
-    _keywords.add(String(STR("reflexpr")));
-    _keywords.add(String(STR("reinterpret_cast")));
-    _keywords.add(String(STR("requires")));
-    _keywords.add(String(STR("return")));
-    _keywords.add(String(STR("sizeof")));
-    _keywords.add(String(STR("static")));
-    _keywords.add(String(STR("static_assert")));
-    _keywords.add(String(STR("static_cast")));
-    _keywords.add(String(STR("struct")));
-    _keywords.add(String(STR("switch")));
-    _keywords.add(String(STR("synchronized")));
-    _keywords.add(String(STR("template")));
-    _keywords.add(String(STR("this")));
-    _keywords.add(String(STR("thread_local")));
-    _keywords.add(String(STR("throw")));
-    _keywords.add(String(STR("true")));
-    _keywords.add(String(STR("try")));
-    _keywords.add(String(STR("typedef")));
-    _keywords.add(String(STR("typeid")));
-    _keywords.add(String(STR("typename")));
-    _keywords.add(String(STR("union")));
-    _keywords.add(String(STR("using")));
-    _keywords.add(String(STR("virtual")));
-    _keywords.add(String(STR("while")));
-    _keywords.add(String(STR("xor")));
-    _keywords.add(String(STR("xor_eq")));
-    _keywords.add(String(STR("override")));
-    _keywords.add(String(STR("final")));
-    _keywords.add(String(STR("transaction_safe")));
-    _keywords.add(String(STR("transaction_safe_dynamic")));
-    _keywords.add(String(STR("_Pragma")));
-
-    _types.add(String(STR("auto")));
-    _types.add(String(STR("bool")));
-    _types.add(String(STR("byte")));
-    _types.add(String(STR("char")));
-    _types.add(String(STR("char16_t")));
-    _types.add(String(STR("char32_t")));
-    _types.add(String(STR("const")));
-    _types.add(String(STR("constexpr")));
-    _types.add(String(STR("double")));
-    _types.add(String(STR("float")));
-    _types.add(String(STR("int")));
-    _types.add(String(STR("long")));
-    _types.add(String(STR("short")));
-    _types.add(String(STR("signed")));
-    _types.add(String(STR("unsigned")));
-    _types.add(String(STR("void")));
-    _types.add(String(STR("volatile")));
-    _types.add(String(STR("wchar_t")));
-    _types.add(String(STR("int8_t")));
-    _types.add(String(STR("int16_t")));
-    _types.add(String(STR("int32_t")));
-    _types.add(String(STR("int64_t")));
-    _types.add(String(STR("uint8_t")));
-    _types.add(String(STR("uint16_t")));
-    _types.add(String(STR("uint32_t")));
-    _types.add(String(STR("uint64_t")));
-    _types.add(String(STR("intptr_t")));
-    _types.add(String(STR("uintptr_t")));
-    _types.add(String(STR("intmax_t")));
-    _types.add(String(STR("uintmax_t")));
-    _types.add(String(STR("size_t")));
-    _types.add(String(STR("ptrdiff_t")));
-    _types.add(String(STR("nullptr_t")));
-    _types.add(String(STR("max_align_t")));
-    _types.add(String(STR("unichar_t")));
-    _types.add(String(STR("char_t")));
-    _types.add(String(STR("byte_t")));
-
-    _preprocessor.add(String(STR("if")));
-    _preprocessor.add(String(STR("elif")));
-    _preprocessor.add(String(STR("else")));
-    _preprocessor.add(String(STR("endif")));
-    _preprocessor.add(String(STR("defined")));
-    _preprocessor.add(String(STR("ifdef")));
-    _preprocessor.add(String(STR("ifndef")));
-    _preprocessor.add(String(STR("define")));
-    _preprocessor.add(String(STR("undef")));
-    _preprocessor.add(String(STR("include")));
-    _preprocessor.add(String(STR("line")));
-    _preprocessor.add(String(STR("error")));
-    _preprocessor.add(String(STR("pragma")));
-}
-
-void CppSyntaxHighlighter::highlightChar(const String& text, int pos)
-{
-    if (_highlightingState.charsRemaining > 0)
-    {
-        --_highlightingState.charsRemaining;
-        if (_highlightingState.charsRemaining > 0)
-            return;
-
-        if (_highlightingState.reset)
-            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_NONE;
-    }
-
-    unichar_t ch = text.charAt(pos);
-
-    if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_STRING)
-    {
-        if (_highlightingState.prevCh == '\\')
-            _highlightingState.prevCh = 0;
-        else if (ch == _highlightingState.startCh)
-        {
-            _highlightingState.charsRemaining = 1;
-            _highlightingState.reset = true;
-        }
-        else if (ch == '\\')
-            _highlightingState.prevCh = ch;
-
-        return;
-    }
-    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_NUMBER)
-    {
-        if (!(charIsDigit(ch) || ch == 'x' || ch == 'X' || ch == 'a' || ch == 'A' || ch == 'b' || ch == 'B' ||
-              ch == 'c' || ch == 'C' || ch == 'd' || ch == 'D' || ch == 'e' || ch == 'E' || ch == 'f' || ch == 'F' ||
-              ch == '.' || ch == '+' || ch == '-'))
-            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_NONE;
-        else
-            return;
-    }
-    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_SINGLELINE_COMMENT)
-    {
-        if (ch == '\n')
-        {
-            _highlightingState.charsRemaining = 1;
-            _highlightingState.reset = true;
-        }
-
-        return;
-    }
-    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_MULTILINE_COMMENT)
-    {
-        if (ch == '*')
-        {
-            pos = text.charForward(pos);
-
-            if (pos < text.length())
-            {
-                if (text.charAt(pos) == '/')
-                {
-                    _highlightingState.charsRemaining = 2;
-                    _highlightingState.reset = true;
-                }
-            }
-        }
-
-        return;
-    }
-    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_PREPROCESSOR)
-    {
-        if (ch == '\n')
-        {
-            if (_highlightingState.prevCh != '\\')
-            {
-                _highlightingState.charsRemaining = 1;
-                _highlightingState.reset = true;
-            }
-
-            _highlightingState.prevCh = 0;
-        }
-        else if (ch == '\\')
-            _highlightingState.prevCh = ch;
-
-        return;
-    }
-
-    if (ch == '"' || ch == '\'')
-    {
-        _highlightingState.startCh = ch;
-        _highlightingState.highlightingType = HIGHLIGHTING_TYPE_STRING;
-    }
-    else if (charIsDigit(ch))
-    {
-        _highlightingState.highlightingType = HIGHLIGHTING_TYPE_NUMBER;
-    }
-    else if (charIsAlphaNum(ch) || ch == '_')
-    {
-        int s = pos;
-
-        do
-        {
-            pos = text.charForward(pos);
-            if (pos < text.length())
-                ch = text.charAt(pos);
-            else
-                break;
-        } while (charIsAlphaNum(ch) || charIsDigit(ch) || ch == '_');
-
-        _highlightingState.word = text.substr(s, pos - s);
-        _highlightingState.charsRemaining = _highlightingState.word.charLength();
-        _highlightingState.reset = true;
-
-        if (_keywords.contains(_highlightingState.word))
-            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_KEYWORD;
-        else if (_types.contains(_highlightingState.word))
-            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_TYPE;
-        else
-            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_IDENT;
-    }
-    else if (ch == '/')
-    {
-        pos = text.charForward(pos);
-
-        if (pos < text.length())
-        {
-            ch = text.charAt(pos);
-
-            if (ch == '*')
-            {
-                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_MULTILINE_COMMENT;
-                _highlightingState.charsRemaining = 2;
-                _highlightingState.reset = false;
-            }
-            else if (ch == '/')
-                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_SINGLELINE_COMMENT;
-        }
-    }
-    else if (ch == '#')
-    {
-        pos = text.charForward(pos);
-
-        if (pos < text.length())
-        {
-            ch = text.charAt(pos);
-            int q = pos;
-
-            while (charIsAlpha(ch))
-            {
-                pos = text.charForward(pos);
-                if (pos < text.length())
-                    ch = text.charAt(pos);
-                else
-                    break;
-            }
-
-            _highlightingState.word = text.substr(q, pos - q);
+// DocumentDecoder
 
-            if (_preprocessor.contains(_highlightingState.word))
-            {
-                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_PREPROCESSOR;
-
-                if (_highlightingState.word == STR("else") || _highlightingState.word == STR("endif"))
-                {
-                    _highlightingState.charsRemaining = _highlightingState.word.charLength() + 1;
-                    _highlightingState.reset = true;
-                }
-            }
-        }
-    }
+DocumentDecoder::DocumentDecoder(const String& filename) :
+    _file(filename), _mapping(_file), _finished(false), _encoding(TEXT_ENCODING_UTF8), _bom(false), _crLf(false),
+    _error(nullptr)
+{
+    if (_mapping.size() > INT_MAX)
+        throw Exception(STR("file is too large"));
 }
 
-ShellSyntaxHighlighter::ShellSyntaxHighlighter() : SyntaxHighlighter(DOCUMENT_TYPE_SHELL)
+void DocumentDecoder::start()
 {
-    _keywords.add(String(STR("case")));
-    _keywords.add(String(STR("do")));
-    _keywords.add(String(STR("done")));
-    _keywords.add(String(STR("elif")));
-    _keywords.add(String(STR("else")));
-    _keywords.add(String(STR("esac")));
-    _keywords.add(String(STR("fi")));
-    _keywords.add(String(STR("for")));
-    _keywords.add(String(STR("function")));
-    _keywords.add(String(STR("if")));
-    _keywords.add(String(STR("in")));
-    _keywords.add(String(STR("select")));
-    _keywords.add(String(STR("then")));
-    _keywords.add(String(STR("time")));
-    _keywords.add(String(STR("until")));
-    _keywords.add(String(STR("while")));
+    ASSERT(!_thread.started());
+    _thread.start(decodeProc, this);
 }
 
-void ShellSyntaxHighlighter::highlightChar(const String& text, int pos)
+bool DocumentDecoder::finished()
 {
-    if (_highlightingState.charsRemaining > 0)
-    {
-        --_highlightingState.charsRemaining;
-        if (_highlightingState.charsRemaining > 0)
-            return;
-
-        if (_highlightingState.reset)
-            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_NONE;
-    }
-
-    unichar_t ch = text.charAt(pos);
-
-    if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_STRING)
-    {
-        if (_highlightingState.prevCh == '\\')
-            _highlightingState.prevCh = 0;
-        else if (ch == _highlightingState.startCh)
-        {
-            _highlightingState.charsRemaining = 1;
-            _highlightingState.reset = true;
-        }
-        else if (ch == '\\')
-            _highlightingState.prevCh = ch;
-
-        return;
-    }
-    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_NUMBER)
-    {
-        if (!(charIsDigit(ch) || ch == 'x' || ch == 'X' || ch == 'a' || ch == 'A' || ch == 'b' || ch == 'B' ||
-              ch == 'c' || ch == 'C' || ch == 'd' || ch == 'D' || ch == 'e' || ch == 'E' || ch == 'f' || ch == 'F' ||
-              ch == '.' || ch == '+' || ch == '-'))
-            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_NONE;
-        else
-            return;
-    }
-    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_SINGLELINE_COMMENT)
-    {
-        if (ch == '\n')
-        {
-            _highlightingState.charsRemaining = 1;
-            _highlightingState.reset = true;
-        }
-
-        return;
-    }
-    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_VARIABLE_REF)
-    {
-        if (_highlightingState.startCh == '{')
-        {
-            if (ch == '}')
-            {
-                _highlightingState.charsRemaining = 1;
-                _highlightingState.reset = true;
-            }
-
-            return;
-        }
-        else
-        {
-            if (!(charIsAlphaNum(ch) || charIsDigit(ch) || ch == '_' || ch == '*' ||
-                    ch == '@' || ch == '#' || ch == '?' || ch == '-' || ch == '$' || ch == '!'))
-                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_NONE;
-            else
-                return;
-        }
-    }
-
-    if (ch == '"' || ch == '\'')
-    {
-        _highlightingState.startCh = ch;
-        _highlightingState.highlightingType = HIGHLIGHTING_TYPE_STRING;
-    }
-    else if (charIsDigit(ch))
-    {
-        _highlightingState.highlightingType = HIGHLIGHTING_TYPE_NUMBER;
-    }
-    else if (charIsAlphaNum(ch) || ch == '_')
-    {
-        int s = pos;
-
-        do
-        {
-            pos = text.charForward(pos);
-            if (pos < text.length())
-                ch = text.charAt(pos);
-            else
-                break;
-        } while (charIsAlphaNum(ch) || charIsDigit(ch) || ch == '_');
+    MutexLock lock(_mutex);
+    return _finished;
+}
 
-        _highlightingState.word = text.substr(s, pos - s);
-        _highlightingState.charsRemaining = _highlightingState.word.charLength();
-        _highlightingState.reset = true;
+String DocumentDecoder::finish(TextEncoding& encoding, bool& bom, bool& crLf)
+{
+    _thread.join();
 
-        if (_keywords.contains(_highlightingState.word))
-            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_KEYWORD;
-        else
-        {
-            if (pos < text.length() && ch == '=')
-                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_VARIABLE;
-            else
-                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_NONE;
-        }
-    }
-    else if (ch == '#')
-    {
-        _highlightingState.highlightingType = HIGHLIGHTING_TYPE_SINGLELINE_COMMENT;
-    }
-    else if (ch == '$')
-    {
-        pos = text.charForward(pos);
+    if (_error)
+        throw Exception(_error);
 
-        if (pos < text.length())
-        {
-            ch = text.charAt(pos);
-            _highlightingState.startCh = ch == '{' ? ch : 0;
-        }
+    encoding = _encoding;
+    bom = _bom;
+    crLf = _crLf;
 
-        _highlightingState.highlightingType = HIGHLIGHTING_TYPE_VARIABLE_REF;
-    }
+    return static_cast<String&&>(_text);
 }
 
-// XmlSyntaxHighlighter
-
-void XmlSyntaxHighlighter::highlightChar(const String& text, int pos)
+void DocumentDecoder::decodeProc(void* param)
 {
-    if (_highlightingState.charsRemaining > 0)
-    {
-        --_highlightingState.charsRemaining;
-        if (_highlightingState.charsRemaining > 0)
-            return;
-
-        if (_highlightingState.reset)
-            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_NONE;
-    }
+    static_cast<DocumentDecoder*>(param)->decode();
+}
 
-    unichar_t ch = text.charAt(pos);
+void DocumentDecoder::decode()
+{
+    Memory::Scope scope("load");
 
-    if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_TAG)
-    {
-        if (ch == '>')
-        {
-            _highlightingState.charsRemaining = 1;
-            _highlightingState.reset = true;
-        }
-        else if (charIsSpace(ch))
-            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_ATTRIBUTE;
+    String text;
+    TextEncoding encoding = TEXT_ENCODING_UTF8;
+    bool bom = false, crLf = false;
+    const char_t* error = nullptr;
 
-        return;
-    }
-    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_ATTRIBUTE)
+    try
     {
-        if (ch == '=')
-            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_ATTRIBUTE_EQUAL;
-        else if (ch == '>')
-        {
-            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_TAG;
-            _highlightingState.charsRemaining = 1;
-            _highlightingState.reset = true;
-        }
-        else if (ch == '/')
-            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_TAG;
-
-        return;
+        text = Unicode::bytesToString(static_cast<int>(_mapping.size()), _mapping.data(), encoding, bom, crLf);
     }
-    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_ATTRIBUTE_EQUAL)
+    catch (Exception& ex)
     {
-        if (ch == '\'' || ch == '"')
-        {
-            _highlightingState.startCh = ch;
-            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_ATTRIBUTE_VALUE;
-        }
-        else if (!charIsSpace(ch))
-        {
-            _highlightingState.startCh = 0;
-            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_ATTRIBUTE_VALUE;
-        }
-
-        return;
+        error = ex.message();
     }
-    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_ATTRIBUTE_VALUE)
-    {
-        if (_highlightingState.prevCh != 0)
-        {
-            _highlightingState.prevCh = 0;
-
-            if (ch == '>')
-            {
-                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_TAG;
-                _highlightingState.charsRemaining = 1;
-                _highlightingState.reset = true;
-            }
-            else if (ch == '/')
-                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_TAG;
-            else
-                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_ATTRIBUTE;
-        }
-        else if (_highlightingState.startCh != 0)
-        {
-            if (ch == _highlightingState.startCh)
-                _highlightingState.prevCh = 1;
-        }
-        else if (_highlightingState.startCh == 0)
-        {
-            if (ch == '>')
-            {
-                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_TAG;
-                _highlightingState.charsRemaining = 1;
-                _highlightingState.reset = true;
-            }
-            else if (ch == '/')
-                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_TAG;
-            else if (charIsSpace(ch))
-                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_ATTRIBUTE;
-        }
 
-        return;
-    }
-    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_MULTILINE_COMMENT)
     {
-        if (ch == '-')
-        {
-            pos = text.charForward(pos);
-
-            if (pos < text.length())
-            {
-                if (text.charAt(pos) == '-')
-                {
-                    pos = text.charForward(pos);
-
-                    if (pos < text.length())
-                    {
-                        if (text.charAt(pos) == '>')
-                        {
-                            _highlightingState.charsRemaining = 3;
-                            _highlightingState.reset = true;
-                        }
-                    }
-                }
-            }
-        }
-
-        return;
+        MutexLock lock(_mutex);
+        _text = static_cast<String&&>(text);
+        _encoding = encoding;
+        _bom = bom;
+        _crLf = crLf;
+        _error = error;
+        _finished = true;
     }
 
-    if (ch == '<')
-    {
-        pos = text.charForward(pos);
-
-        if (pos < text.length())
-        {
-            if (text.charAt(pos) == '!')
-            {
-                pos = text.charForward(pos);
-
-                if (pos < text.length())
-                {
-                    if (text.charAt(pos) == '-')
-                    {
-                        pos = text.charForward(pos);
-
-                        if (pos < text.length())
-                        {
-                            if (text.charAt(pos) == '-')
-                            {
-                                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_MULTILINE_COMMENT;
-                                return;
-                            }
-                        }
-                    }
-                }
-            }
-        }
+    // the main thread takes the text when readInput() returns
 
-        _highlightingState.highlightingType = HIGHLIGHTING_TYPE_TAG;
-    }
+    Console::wake();
 }
 
 // Document
 
-Document::Document(Editor* editor) : _editor(editor)
+Document::Document(Editor* editor) :
+    _editor(editor), _changes(0), _drawnChanges(-1), _editRecordPool(createUnique<List<EditRecord>::Pool>())
 {
+    _undoRecords.pool(_editRecordPool.ptr());
+    _redoRecords.pool(_editRecordPool.ptr());
+
     clear();
     setDimensions(1, 1, 1, 1);
 }
@@ -938,7 +426,7 @@ bool Document::moveToLine(int line)
     ASSERT(line > 0);
 
     int prev = _position;
-    lineColumnToPosition(_position, _line, _column, line, _preferredColumn, _position, _line, _column);
+    lineColumnToPosition(line, _preferredColumn, _position, _line, _column);
 
     if (_position != prev)
     {
@@ -956,7 +444,7 @@ bool Document::moveToLineColumn(int line, int column)
     ASSERT(line > 0 && column > 0);
 
     int prev = _position;
-    lineColumnToPosition(_position, _line, _column, line, column, _position, _line, _column);
+    lineColumnToPosition(line, column, _position, _line, _column);
 
     _preferredColumn = _column;
 
@@ -1000,7 +488,8 @@ void Document::insertNewLine()
         ch = _text.charAt(q);
     }
 
-    _text.replace(_position, _indent, q - _position);
+    startUndoGroup();
+    replaceText(_position, _indent, q - _position);
     setPositionLineColumn(_position + _indent.length());
 
     _modified = true;
@@ -1020,7 +509,8 @@ void Document::insertChar(unichar_t ch, bool afterIdent)
             p = _text.charForward(p);
     }
 
-    _text.insert(p, ch);
+    startUndoGroup(charIsWord(ch));
+    insertText(p, ch);
     p = _text.charForward(p);
     setPositionLineColumn(p);
 
@@ -1033,7 +523,8 @@ bool Document::deleteCharForward()
 {
     if (_position < _text.length())
     {
-        _text.erase(_position, _text.charForward(_position) - _position);
+        startUndoGroup(true);
+        eraseText(_position, _text.charForward(_position) - _position);
 
         _modified = true;
         _selectionMode = false;
@@ -1052,8 +543,9 @@ bool Document::deleteCharBack()
         int p = _text.charBack(_position);
         int prev = _position;
 
+        startUndoGroup(true);
         setPositionLineColumn(p);
-        _text.erase(_position, prev - _position);
+        eraseText(_position, prev - _position);
 
         _modified = true;
         _selectionMode = false;
@@ -1071,7 +563,8 @@ bool Document::deleteWordForward()
 
     if (p > _position)
     {
-        _text.erase(_position, p - _position);
+        startUndoGroup();
+        eraseText(_position, p - _position);
 
         _modified = true;
         _selectionMode = false;
@@ -1091,8 +584,9 @@ bool Document::deleteWordBack()
     {
         int prev = _position;
 
+        startUndoGroup();
         setPositionLineColumn(p);
-        _text.erase(_position, prev - _position);
+        eraseText(_position, prev - _position);
 
         _modified = true;
         _selectionMode = false;
@@ -1110,7 +604,8 @@ bool Document::deleteCharsForward()
 
     if (p > _position)
     {
-        _text.erase(_position, p - _position);
+        startUndoGroup();
+        eraseText(_position, p - _position);
 
         _modified = true;
         _selectionMode = false;
@@ -1130,8 +625,9 @@ bool Document::deleteCharsBack()
     {
         int prev = _position;
 
+        startUndoGroup();
         setPositionLineColumn(p);
-        _text.erase(_position, prev - _position);
+        eraseText(_position, prev - _position);
 
         _modified = true;
         _selectionMode = false;
@@ -1205,15 +701,17 @@ String Document::copyDeleteText(bool copy)
 
         if (!copy)
         {
+            startUndoGroup();
+
             if (_selection < 0)
             {
-                _text.erase(start, end - start);
-                lineColumnToPosition(start, _line, 1, _line, _preferredColumn, _position, _line, _column);
+                eraseText(start, end - start);
+                lineColumnToPosition(_line, _preferredColumn, _position, _line, _column);
             }
             else
             {
                 setPositionLineColumn(start);
-                _text.erase(start, end - start);
+                eraseText(start, end - start);
             }
 
             _modified = true;
@@ -1233,17 +731,19 @@ void Document::pasteText(const String& text)
 {
     ASSERT(!text.empty());
 
+    startUndoGroup();
+
     if (text.charAt(text.charBack(text.length())) == '\n')
     {
         int start = findLineStart(_position);
         _selection = start;
         setPositionLineColumn(start);
-        _text.insert(start, text);
+        insertText(start, text);
         setPositionLineColumn(start + text.length());
     }
     else
     {
-        _text.insert(_position, text);
+        insertText(_position, text);
         _selection = _position;
         setPositionLineColumn(_position + text.length());
     }
@@ -1318,18 +818,20 @@ void Document::completeWord(const char_t* suffix)
         end = _text.charForward(end);
     }
 
-    _text.replace(_position, suffix, end - _position);
+    startUndoGroup();
+    replaceText(_position, suffix, end - _position);
 
     _modified = true;
     _selectionMode = false;
     _selection = -1;
 }
 
-bool Document::find(const String& searchStr, bool caseSesitive, bool next)
+bool Document::find(const Searcher& searcher, bool next)
 {
-    ASSERT(!searchStr.empty());
+    ASSERT(!searcher.empty());
+    Memory::Scope scope("search");
 
-    int p = findPosition(_position, searchStr, caseSesitive, next);
+    int p = findPosition(_position, searcher, next);
 
     if (p != INVALID_POSITION && p != _position)
     {
@@ -1344,18 +846,20 @@ bool Document::find(const String& searchStr, bool caseSesitive, bool next)
     return false;
 }
 
-bool Document::replace(const String& searchStr, const String& replaceStr, bool caseSesitive)
+bool Document::replace(const Searcher& searcher, const String& replaceStr)
 {
-    ASSERT(!searchStr.empty());
+    ASSERT(!searcher.empty());
+    Memory::Scope scope("search");
 
-    int p = findPosition(_position, searchStr, caseSesitive, false);
+    int p = findPosition(_position, searcher, false);
 
     if (p == _position)
     {
-        _text.replace(p, replaceStr, searchStr.length());
+        startUndoGroup();
+        replaceText(p, replaceStr, searcher.pattern().length());
         p += replaceStr.length();
 
-        int q = findPosition(p, searchStr, caseSesitive, false);
+        int q = findPosition(p, searcher, false);
         if (q != INVALID_POSITION)
             p = q;
 
@@ -1371,12 +875,38 @@ bool Document::replace(const String& searchStr, const String& replaceStr, bool c
     return false;
 }
 
-bool Document::replaceAll(const String& searchStr, const String& replaceStr, bool caseSesitive)
+bool Document::replaceAll(const Searcher& searcher, const String& replaceStr)
 {
-    ASSERT(!searchStr.empty());
+    ASSERT(!searcher.empty());
+    Memory::Scope scope("search");
+
+    startUndoGroup();
+
+    int len = searcher.pattern().length();
+    const char_t* chars = _text.chars();
+    const char_t* end = chars + _text.length();
+    const char_t* from = chars;
+    const char_t* found;
+    String str;
+
+    while ((found = searcher.find(from, end)))
+    {
+        recordEdit(str.length() + (found - from), String(found, len), replaceStr);
+        str.append(from, found - from);
+        str.append(replaceStr);
+        from = found + len;
+    }
+
+    if (from > chars)
+    {
+        str.append(from, end - from);
+        indexWords(0, _text.length(), -1);
+        _text.assign(static_cast<String&&>(str));
+        indexWords(0, _text.length(), 1);
+    }
 
-    _text.replaceString(searchStr, replaceStr, caseSesitive);
-    lineColumnToPosition(0, 1, 1, _line, _column, _position, _line, _column);
+    invalidateHighlighting(0);
+    lineColumnToPosition(_line, _column, _position, _line, _column);
 
     _modified = true;
     _selectionMode = false;
@@ -1386,9 +916,10 @@ bool Document::replaceAll(const String& searchStr, const String& replaceStr, boo
     return true;
 }
 
-void Document::open(const String& filename)
+void Document::open(const String& filename, bool decodeInBackground)
 {
     ASSERT(!filename.empty());
+    Memory::Scope scope("load");
 
     clear();
     _filename = filename;
@@ -1397,14 +928,55 @@ void Document::open(const String& filename)
 
     if (file.open(filename))
     {
-        _text.assign(Unicode::bytesToString(file.read(), _encoding, _bom, _crLf));
-        _modified = false;
+        if (decodeInBackground && file.size() > BACKGROUND_DECODE_SIZE)
+        {
+            // the start of a large file is decoded right away so that the screen can be drawn,
+            // finishDecoding() replaces it with the whole text and indexes the words
+
+            Unique<DocumentDecoder> decoder = createUnique<DocumentDecoder>(filename);
+            const FileMapping& mapping = decoder->mapping();
+
+            _text.assign(Unicode::bytesToString(static_cast<int>(mapping.size()), mapping.data(),
+                                                _encoding, _bom, _crLf, VIEWPORT_DECODE_SIZE));
+
+            decoder->start();
+            _decoder = static_cast<Unique<DocumentDecoder>&&>(decoder);
+        }
+        else
+        {
+            FileMapping mapping(file);
+
+            if (mapping.size() > INT_MAX)
+                throw Exception(STR("file is too large"));
+
+            _text.assign(Unicode::bytesToString(mapping.size(), mapping.data(), _encoding, _bom, _crLf));
+            indexWords(0, _text.length(), 1);
+        }
+
+        markUnmodified();
         determineDocumentType(file.isExecutable());
     }
     else
         determineDocumentType(false);
 }
 
+bool Document::finishDecoding(bool wait)
+{
+    // the whole text starts with the part already shown, so positions stay valid,
+    // a document that fails to decode no longer decodes and is closed by the editor
+
+    if (!_decoder.ptr() || (!wait && !_decoder->finished()))
+        return false;
+
+    Unique<DocumentDecoder> decoder = static_cast<Unique<DocumentDecoder>&&>(_decoder);
+
+    _text.assign(decoder->finish(_encoding, _bom, _crLf));
+    indexWords(0, _text.length(), 1);
+    ++_changes;
+
+    return true;
+}
+
 void Document::save()
 {
     ASSERT(!_filename.empty());
@@ -1412,21 +984,56 @@ void Document::save()
     if (_editor->trimWhitespace())
         trimTrailingWhitespace();
 
-    File file(_filename, FILE_MODE_WRITE | FILE_MODE_CREATE | FILE_MODE_TRUNCATE);
-    file.write(Unicode::stringToBytes(_text, _encoding, _bom, _crLf));
+    String filename = File::resolvePath(_filename);
 
-    _modified = false;
-    _selectionMode = false;
-    _selection = -1;
-}
+    if (_editor->atomicSave() && File::canReplace(filename))
+    {
+        String tempFilename = filename + STR(".ev.tmp");
 
-void Document::clear()
-{
-    _text.ensureCapacity(1);
-    _text.clear();
+        try
+        {
+            {
+                File file(tempFilename, FILE_MODE_WRITE | FILE_MODE_CREATE | FILE_MODE_TRUNCATE);
+                file.writeText(_text, _encoding, _bom, _crLf);
+                file.flush();
+            }
+
+            File::replace(filename, tempFilename);
+        }
+        catch (...)
+        {
+            if (File::exists(tempFilename))
+                File::remove(tempFilename);
+            throw;
+        }
+    }
+    else
+    {
+        File file(_filename, FILE_MODE_WRITE | FILE_MODE_CREATE | FILE_MODE_TRUNCATE);
+        file.writeText(_text, _encoding, _bom, _crLf);
+    }
+
+    markUnmodified();
+    _selectionMode = false;
+    _selection = -1;
+}
+
+void Document::clear()
+{
+    auto it = _words.constIterator();
+    while (it.moveNext())
+        addWordCount(_wordChanges, it.value().key, -it.value().value);
+
+    _decoder = Unique<DocumentDecoder>();
+    _words.clear();
+    _text.clear();
+    _highlightingCheckpoints.clear();
+    clearUndo();
+    ++_changes;
 
     _position = 0;
     _modified = true;
+    _savedUndoGroup = -1;
 
     _filename.clear();
     _documentType = DOCUMENT_TYPE_TEXT;
@@ -1446,8 +1053,9 @@ void Document::clear()
 
 void Document::trimTrailingWhitespace()
 {
-    String trimmed;
-    int p = 0, start = 0, whitespace = 0;
+    int p = 0, whitespace = -1;
+
+    startUndoGroup();
 
     while (true)
     {
@@ -1455,33 +1063,28 @@ void Document::trimTrailingWhitespace()
 
         if (ch == '\n' || ch == 0)
         {
-            if (whitespace)
+            if (whitespace >= 0)
             {
-                trimmed.append(_text.chars() + start, whitespace - start);
-                start = p;
-                whitespace = 0;
+                eraseText(whitespace, p - whitespace);
+                p = whitespace;
+                whitespace = -1;
             }
         }
         else if (ch == ' ' || ch == '\t')
         {
-            if (!whitespace)
+            if (whitespace < 0)
                 whitespace = p;
         }
         else
-            whitespace = 0;
+            whitespace = -1;
 
         if (p < _text.length())
             p = _text.charForward(p);
         else
-        {
-            trimmed.append(_text.chars() + start, p - start);
             break;
-        }
     }
 
-    swap(trimmed, _text);
-
-    lineColumnToPosition(0, 1, 1, _line, _column, _position, _line, _column);
+    lineColumnToPosition(_line, _column, _position, _line, _column);
 
     _modified = true;
     _selectionMode = false;
@@ -1498,9 +1101,11 @@ void Document::setDimensions(int x, int y, int width, int height)
     _y = y;
     _width = width;
     _height = height;
+    _drawnChanges = -1;
 }
 
-void Document::draw(int screenWidth, Buffer<ScreenCell>& screen, bool unicodeLimit16)
+void Document::draw(int screenWidth, Buffer<ScreenCell>& screen, Buffer<bool>& dirtyRows, bool unicodeLimit16,
+    bool redraw)
 {
     ASSERT(screenWidth > 0);
 
@@ -1508,11 +1113,11 @@ void Document::draw(int screenWidth, Buffer<ScreenCell>& screen, bool unicodeLim
     bool highlightFromStart = true;
 
     if (_line < _top)
-        lineColumnToPosition(_position, _line, _column, _line, 1, _topPosition, _top, l);
+        lineColumnToPosition(_line, 1, _topPosition, _top, l);
     else if (_line >= _top + _height)
-        lineColumnToPosition(_position, _line, _column, _line - _height + 1, 1, _topPosition, _top, l);
+        lineColumnToPosition(_line - _height + 1, 1, _topPosition, _top, l);
     else if (_topPosition < 0)
-        lineColumnToPosition(_position, _line, _column, _top, 1, _topPosition, _top, l);
+        lineColumnToPosition(_top, 1, _topPosition, _top, l);
     else
         highlightFromStart = false;
 
@@ -1529,6 +1134,16 @@ void Document::draw(int screenWidth, Buffer<ScreenCell>& screen, bool unicodeLim
     ASSERT(_x > 0 && _y > 0);
     ASSERT(_width > 0 && _height > 0);
 
+    // the screen still shows the document when it is drawn in the same place
+    // and neither the text nor the visible part of it changed since
+
+    if (!redraw && _drawnChanges == _changes && _drawnTopPosition == _topPosition && _drawnLeft == _left)
+        return;
+
+    _drawnChanges = _changes;
+    _drawnTopPosition = _topPosition;
+    _drawnLeft = _left;
+
     int p = _topPosition;
     int len = _left + _width - 1;
 
@@ -1553,13 +1168,29 @@ void Document::draw(int screenWidth, Buffer<ScreenCell>& screen, bool unicodeLim
     {
         if (highlightFromStart)
         {
-            p = 0;
-            syntaxHighlighter->highlightingState() = HighlightingState();
+            int n = min((_top - 1) / HIGHLIGHTING_CHECKPOINT_INTERVAL, _highlightingCheckpoints.size());
+            int line = n * HIGHLIGHTING_CHECKPOINT_INTERVAL + 1;
+
+            if (n > 0)
+                syntaxHighlighter->highlightingState() = _highlightingCheckpoints[n - 1];
+            else
+                syntaxHighlighter->highlightingState() = HighlightingState();
+
+            p = _text.lineStart(line);
+            line += HIGHLIGHTING_CHECKPOINT_INTERVAL;
+            int checkpoint = line <= _text.lineCount() ? _text.lineStart(line) : INT_MAX;
 
             while (p < _topPosition)
             {
                 syntaxHighlighter->highlightChar(_text, p);
                 p = _text.charForward(p);
+
+                if (p == checkpoint)
+                {
+                    _highlightingCheckpoints.addLast(syntaxHighlighter->highlightingState());
+                    line += HIGHLIGHTING_CHECKPOINT_INTERVAL;
+                    checkpoint = line <= _text.lineCount() ? _text.lineStart(line) : INT_MAX;
+                }
             }
 
             _highlightingState = syntaxHighlighter->highlightingState();
@@ -1606,27 +1237,326 @@ void Document::draw(int screenWidth, Buffer<ScreenCell>& screen, bool unicodeLim
 
             if (i >= _left && i <= len)
             {
-                screen[q].ch = unicodeLimit16 && ch > 0xffff ? '?' : ch;
+                ScreenCell cell;
+                cell.ch = unicodeLimit16 && ch > 0xffff ? '?' : ch;
 
 #if defined(PLATFORM_WINDOWS) && !defined(GUI_MODE)
                 if (syntaxHighlighter)
-                    screen[q].color =
+                    cell.color =
                         defaultBackground() | colors[syntaxHighlighter->highlightingState().highlightingType];
                 else
-                    screen[q].color = defaultBackground() | defaultForeground();
+                    cell.color = defaultBackground() | defaultForeground();
 #else
                 if (syntaxHighlighter)
-                    screen[q].color = colors[syntaxHighlighter->highlightingState().highlightingType];
+                    cell.color = colors[syntaxHighlighter->highlightingState().highlightingType];
                 else
-                    screen[q].color = defaultForeground();
+                    cell.color = defaultForeground();
 #endif
 
+                if (!(screen[q] == cell))
+                {
+                    screen[q] = cell;
+                    dirtyRows[_y + j - 2] = true;
+                }
+
                 ++q;
             }
         }
     }
 }
 
+void Document::insertText(int pos, const String& str)
+{
+    recordEdit(pos, String(), str);
+    indexWords(pos, 0, -1);
+    _text.insert(pos, str);
+    indexWords(pos, str.length(), 1);
+    invalidateHighlighting(pos);
+}
+
+void Document::insertText(int pos, const char_t* chars)
+{
+    String str(chars);
+    recordEdit(pos, String(), str);
+    indexWords(pos, 0, -1);
+    _text.insert(pos, str);
+    indexWords(pos, str.length(), 1);
+    invalidateHighlighting(pos);
+}
+
+void Document::insertText(int pos, unichar_t ch, int n)
+{
+    String str(ch, n);
+    recordEdit(pos, String(), str);
+    indexWords(pos, 0, -1);
+    _text.insert(pos, str);
+    indexWords(pos, str.length(), 1);
+    invalidateHighlighting(pos);
+}
+
+void Document::eraseText(int pos, int len)
+{
+    recordEdit(pos, _text.substr(pos, len), String());
+    indexWords(pos, len, -1);
+    _text.erase(pos, len);
+    indexWords(pos, 0, 1);
+    invalidateHighlighting(pos);
+}
+
+void Document::replaceText(int pos, const String& str, int len)
+{
+    recordEdit(pos, _text.substr(pos, len), str);
+    indexWords(pos, len, -1);
+    _text.replace(pos, str, len);
+    indexWords(pos, str.length(), 1);
+    invalidateHighlighting(pos);
+}
+
+void Document::replaceText(int pos, const char_t* chars, int len)
+{
+    String str(chars);
+    recordEdit(pos, _text.substr(pos, len), str);
+    indexWords(pos, len, -1);
+    _text.replace(pos, str, len);
+    indexWords(pos, str.length(), 1);
+    invalidateHighlighting(pos);
+}
+
+void Document::invalidateHighlighting(int pos)
+{
+    int n = (_text.lineAt(pos) - 2) / HIGHLIGHTING_CHECKPOINT_INTERVAL;
+
+    while (_highlightingCheckpoints.size() > n)
+        _highlightingCheckpoints.removeLast();
+
+    if (pos < _topPosition)
+        _topPosition = -1;
+
+    ++_changes;
+}
+
+void Document::indexWords(int pos, int len, int count)
+{
+    Memory::Scope scope("index");
+
+    int start = pos, end = pos + len;
+
+    while (start > 0)
+    {
+        int p = _text.charBack(start);
+        if (!charIsWord(_text.charAt(p)))
+            break;
+        start = p;
+    }
+
+    while (charIsWord(_text.charAt(end)))
+        end = _text.charForward(end);
+
+    int p = start;
+
+    while (p < end)
+    {
+        while (p < end && !charIsWord(_text.charAt(p)))
+            p = _text.charForward(p);
+
+        int q = p;
+        while (q < end && charIsWord(_text.charAt(q)))
+            q = _text.charForward(q);
+
+        if (q > p)
+        {
+            String word = _text.substr(p, q - p);
+            addWordCount(_words, word, count);
+            addWordCount(_wordChanges, word, count);
+        }
+
+        p = q;
+    }
+}
+
+void Document::mergeWordChanges(WordIndex& words)
+{
+    auto it = _wordChanges.constIterator();
+    while (it.moveNext())
+        words.add(it.value().key, it.value().value);
+
+    _wordChanges.clear();
+}
+
+int editRecordSize(const EditRecord& record)
+{
+    return sizeof(ListNode<EditRecord>) + (record.erased.length() + record.inserted.length()) * sizeof(char_t);
+}
+
+void Document::startUndoGroup(bool coalesce)
+{
+    if (!(coalesce && _coalesceUndo))
+        ++_undoGroup;
+
+    _coalesceUndo = coalesce;
+}
+
+void Document::recordEdit(int pos, const String& erased, const String& inserted)
+{
+    Memory::Scope scope("undo");
+
+    if (erased.empty() && inserted.empty())
+        return;
+
+    for (auto node = _redoRecords.first(); node; node = node->next)
+        _undoSize -= editRecordSize(node->value);
+
+    _redoRecords.clear();
+
+    ListNode<EditRecord>* last = _undoRecords.last();
+
+    if (_coalesceUndo && last && last->value.group == _undoGroup)
+    {
+        EditRecord& record = last->value;
+        int size = editRecordSize(record);
+        bool merged = true;
+
+        if (record.erased.empty() && erased.empty() && pos == record.position + record.inserted.length())
+            record.inserted.append(inserted);
+        else if (record.inserted.empty() && inserted.empty() && pos + erased.length() == record.position)
+        {
+            record.erased.insert(0, erased);
+            record.position = pos;
+        }
+        else if (record.inserted.empty() && inserted.empty() && pos == record.position)
+            record.erased.append(erased);
+        else
+            merged = false;
+
+        if (merged)
+        {
+            _undoSize += editRecordSize(record) - size;
+            return;
+        }
+
+        ++_undoGroup;
+    }
+
+    _undoRecords.addLast(EditRecord(_undoGroup, pos, erased, inserted));
+    _undoSize += editRecordSize(_undoRecords.last()->value);
+
+    while (_undoSize > _editor->undoLimit() && _undoRecords.first()->value.group != _undoGroup)
+    {
+        int group = _undoRecords.first()->value.group;
+
+        do
+        {
+            _undoSize -= editRecordSize(_undoRecords.first()->value);
+            _undoRecords.removeFirst();
+        }
+        while (_undoRecords.first()->value.group == group);
+
+        _droppedUndoGroup = group;
+    }
+}
+
+void Document::clearUndo()
+{
+    _undoRecords.clear();
+    _redoRecords.clear();
+
+    if (!_editRecordPool.empty())
+        _editRecordPool->release();
+
+    _undoGroup = 0;
+    _coalesceUndo = false;
+    _undoSize = 0;
+    _droppedUndoGroup = 0;
+}
+
+void Document::markUnmodified()
+{
+    // the next edit starts a new group so that it can't be merged into the saved one
+
+    _modified = false;
+    _coalesceUndo = false;
+    _savedUndoGroup = lastUndoGroup();
+}
+
+int Document::lastUndoGroup() const
+{
+    return _undoRecords.empty() ? _droppedUndoGroup : _undoRecords.last()->value.group;
+}
+
+bool Document::undo()
+{
+    Memory::Scope scope("undo");
+
+    if (_undoRecords.empty())
+        return false;
+
+    int group = _undoRecords.last()->value.group;
+    int pos = 0;
+
+    do
+    {
+        EditRecord& record = _undoRecords.last()->value;
+
+        indexWords(record.position, record.inserted.length(), -1);
+        _text.replace(record.position, record.erased, record.inserted.length());
+        indexWords(record.position, record.erased.length(), 1);
+        invalidateHighlighting(record.position);
+        pos = record.position + record.erased.length();
+
+        _redoRecords.addLast(static_cast<EditRecord&&>(record));
+        _undoRecords.removeLast();
+    }
+    while (!_undoRecords.empty() && _undoRecords.last()->value.group == group);
+
+    positionToLineColumn(0, 1, 1, pos, _line, _column);
+    _position = pos;
+    _preferredColumn = _column;
+
+    _coalesceUndo = false;
+    _modified = lastUndoGroup() != _savedUndoGroup;
+    _selectionMode = false;
+    _selection = -1;
+
+    return true;
+}
+
+bool Document::redo()
+{
+    Memory::Scope scope("undo");
+
+    if (_redoRecords.empty())
+        return false;
+
+    int group = _redoRecords.last()->value.group;
+    int pos = 0;
+
+    do
+    {
+        EditRecord& record = _redoRecords.last()->value;
+
+        indexWords(record.position, record.erased.length(), -1);
+        _text.replace(record.position, record.inserted, record.erased.length());
+        indexWords(record.position, record.inserted.length(), 1);
+        invalidateHighlighting(record.position);
+        pos = record.position + record.inserted.length();
+
+        _undoRecords.addLast(static_cast<EditRecord&&>(record));
+        _redoRecords.removeLast();
+    }
+    while (!_redoRecords.empty() && _redoRecords.last()->value.group == group);
+
+    positionToLineColumn(0, 1, 1, pos, _line, _column);
+    _position = pos;
+    _preferredColumn = _column;
+
+    _coalesceUndo = false;
+    _modified = lastUndoGroup() != _savedUndoGroup;
+    _selectionMode = false;
+    _selection = -1;
+
+    return true;
+}
+
 void Document::setPositionLineColumn(int pos)
 {
     positionToLineColumn(_position, _line, _column, pos, _line, _column);
@@ -1644,31 +1574,21 @@ void Document::positionToLineColumn(int startPos, int startLine, int startColumn
     line = startLine;
     column = startColumn;
 
-    if (p > newPos)
-    {
-        while (p > newPos)
-        {
-            p = _text.charBack(p);
-            if (_text.charAt(p) == '\n')
-                --line;
-        }
+    if (p == newPos)
+        return;
 
-        p = findLineStart(p);
+    if (p > newPos || _text.lineEnd(line) < newPos)
+    {
+        line = _text.lineAt(newPos);
+        p = _text.lineStart(line);
         column = 1;
     }
-    else if (p == newPos)
-        return;
 
     while (p < newPos)
     {
         unichar_t ch = _text.charAt(p);
 
-        if (ch == '\n')
-        {
-            ++line;
-            column = 1;
-        }
-        else if (ch == '\t')
+        if (ch == '\t')
             column = ((column - 1) / _editor->indentSize() + 1) * _editor->indentSize() + 1;
         else
             ++column;
@@ -1677,43 +1597,19 @@ void Document::positionToLineColumn(int startPos, int startLine, int startColumn
     }
 }
 
-void Document::lineColumnToPosition(int startPos, int startLine, int startColumn, int newLine, int newColumn, int& pos,
-                                    int& line, int& column)
+void Document::lineColumnToPosition(int newLine, int newColumn, int& pos, int& line, int& column)
 {
-    ASSERT(startPos >= 0 && startPos <= _text.length());
-    ASSERT(startLine > 0 && startColumn > 0);
     ASSERT(newLine > 0 && newColumn > 0);
 
-    pos = startPos;
-    line = startLine;
-    column = 1;
-
-    if (line < newLine)
+    line = newLine;
+    if (line > _text.lineCount())
     {
-        while (pos < _text.length() && line < newLine)
-        {
-            if (_text.charAt(pos) == '\n')
-                ++line;
-
-            pos = _text.charForward(pos);
-        }
+        line = _text.lineCount();
+        newColumn = INT_MAX;
     }
-    else
-    {
-        while (pos > 0)
-        {
-            int p = _text.charBack(pos);
-            if (_text.charAt(p) == '\n')
-            {
-                if (line > newLine)
-                    --line;
-                else
-                    break;
-            }
 
-            pos = p;
-        }
-    }
+    pos = _text.lineStart(line);
+    column = 1;
 
     while (pos < _text.length() && column < newColumn)
     {
@@ -1733,30 +1629,13 @@ void Document::lineColumnToPosition(int startPos, int startLine, int startColumn
 int Document::findLineStart(int pos) const
 {
     ASSERT(pos >= 0 && pos <= _text.length());
-
-    while (pos > 0)
-    {
-        int p = _text.charBack(pos);
-        if (_text.charAt(p) == '\n')
-            break;
-        pos = p;
-    }
-
-    return pos;
+    return _text.lineStart(_text.lineAt(pos));
 }
 
 int Document::findLineEnd(int pos) const
 {
     ASSERT(pos >= 0 && pos <= _text.length());
-
-    while (pos < _text.length())
-    {
-        if (_text.charAt(pos) == '\n')
-            break;
-        pos = _text.charForward(pos);
-    }
-
-    return pos;
+    return _text.lineEnd(_text.lineAt(pos));
 }
 
 int Document::findNextLine(int pos) const
@@ -1898,9 +1777,9 @@ int Document::findCharsBack(int pos) const
     return p;
 }
 
-int Document::findPosition(int pos, const String& searchStr, bool caseSesitive, bool next) const
+int Document::findPosition(int pos, const Searcher& searcher, bool next) const
 {
-    ASSERT(!searchStr.empty());
+    ASSERT(!searcher.empty());
 
     int p = INVALID_POSITION;
 
@@ -1908,12 +1787,14 @@ int Document::findPosition(int pos, const String& searchStr, bool caseSesitive,
     {
         p = next ? _text.charForward(pos) : pos;
 
-        p = _text.find(searchStr, caseSesitive, p);
-        if (p == INVALID_POSITION)
-            p = _text.find(searchStr, caseSesitive);
+        int q = _text.find(searcher, p);
+        if (q == INVALID_POSITION)
+            q = _text.find(searcher, 0, min(_text.length(), p + searcher.pattern().length() - 1));
+
+        p = q;
     }
     else
-        p = _text.find(searchStr, caseSesitive);
+        p = _text.find(searcher);
 
     return p;
 }
@@ -1922,6 +1803,8 @@ void Document::changeLines(int (Document::*lineOp)(int))
 {
     ASSERT(lineOp);
 
+    startUndoGroup();
+
     if (_selection < 0)
     {
         int start = findLineStart(_position), p = _position;
@@ -2011,8 +1894,8 @@ int Document::indentLine(int pos)
     }
 
     n = (n / _editor->indentSize() + 1) * _editor->indentSize();
-    _text.erase(start, p - start);
-    _text.insert(start, ' ', n);
+    eraseText(start, p - start);
+    insertText(start, ' ', n);
 
     return pos - (p - start) + n;
 }
@@ -2040,8 +1923,8 @@ int Document::unindentLine(int pos)
     if (n > 0)
     {
         n = (n - 1) / _editor->indentSize() * _editor->indentSize();
-        _text.erase(start, p - start);
-        _text.insert(start, ' ', n);
+        eraseText(start, p - start);
+        insertText(start, ' ', n);
 
         pos = pos - (p - start) + n;
         if (pos < start)
@@ -2065,7 +1948,7 @@ int Document::commentLine(int pos)
         ch = _text.charAt(p);
     }
 
-    _text.insert(start, STR("//"));
+    insertText(start, STR("//"));
     return start;
 }
 
@@ -2091,44 +1974,868 @@ int Document::uncommentLine(int pos)
         if (ch == '/')
         {
             q = _text.charForward(q);
-            _text.erase(p, q - p);
+            eraseText(p, q - p);
+        }
+    }
+
+    return start;
+}
+
+void Document::determineDocumentType(bool fileExecutable)
+{
+    _drawnChanges = -1;
+
+    _highlightingCheckpoints.clear();
+
+    if (_filename.endsWith(STR(".c")) || _filename.endsWith(STR(".h")) || _filename.endsWith(STR(".cpp")) ||
+            _filename.endsWith(STR(".hpp")) || _filename.endsWith(STR(".cc")))
+        _documentType = DOCUMENT_TYPE_CPP;
+    else if (_filename.endsWith(STR(".sh")) || _filename.endsWith(STR(".ksh")))
+        _documentType = DOCUMENT_TYPE_SHELL;
+    else if (_filename.endsWith(STR(".bat")) || _filename.endsWith(STR(".cmd")))
+        _documentType = DOCUMENT_TYPE_BATCH;
+    else if (_filename.endsWith(STR(".ps1")))
+        _documentType = DOCUMENT_TYPE_POWERSHELL;
+    else if (_filename.endsWith(STR(".xml")) || _filename.endsWith(STR(".xsd")) || _filename.endsWith(STR(".htm")) ||
+             _filename.endsWith(STR(".html")) || _text.startsWith(STR("<?xml")))
+        _documentType = DOCUMENT_TYPE_XML;
+    else if (_filename.endsWith(STR(".py")))
+        _documentType = DOCUMENT_TYPE_PYTHON;
+    else if (_filename.endsWith(STR(".js")))
+        _documentType = DOCUMENT_TYPE_JAVASCRIPT;
+    else
+        _documentType = DOCUMENT_TYPE_TEXT;
+
+    if (_documentType == DOCUMENT_TYPE_TEXT && fileExecutable)
+        _documentType = DOCUMENT_TYPE_SHELL;
+}
+
+// WordIndex
+
+struct WordIndexCandidate
+{
+    int rank;
+    int node;
+    bool word;
+};
+
+void pushCandidate(Array<WordIndexCandidate>& heap, const WordIndexCandidate& candidate)
+{
+    heap.addLast(candidate);
+
+    for (int i = heap.size() - 1; i > 0 && heap[(i - 1) / 2].rank < heap[i].rank; i = (i - 1) / 2)
+        swap(heap[(i - 1) / 2], heap[i]);
+}
+
+WordIndexCandidate popCandidate(Array<WordIndexCandidate>& heap)
+{
+    WordIndexCandidate top = heap[0];
+    heap[0] = heap.last();
+    heap.removeLast();
+
+    int i = 0;
+
+    while (true)
+    {
+        int largest = i, left = 2 * i + 1, right = 2 * i + 2;
+
+        if (left < heap.size() && heap[left].rank > heap[largest].rank)
+            largest = left;
+        if (right < heap.size() && heap[right].rank > heap[largest].rank)
+            largest = right;
+
+        if (largest == i)
+            break;
+
+        swap(heap[i], heap[largest]);
+        i = largest;
+    }
+
+    return top;
+}
+
+WordIndex::WordIndex()
+{
+    clear();
+}
+
+void WordIndex::add(const String& word, int count)
+{
+    ASSERT(!word.empty());
+
+    int node = 0;
+
+    for (int i = 0; i < word.length(); ++i)
+    {
+        int child = findChild(node, word.chars()[i]);
+        node = child >= 0 ? child : addChild(node, word.chars()[i]);
+    }
+
+    _nodes[node].count += count;
+    ASSERT(_nodes[node].count >= 0);
+
+    if (_nodes[node].count == 0)
+        _nodes[node].preferred = false;
+
+    update(node);
+}
+
+void WordIndex::prefer(const String& word)
+{
+    int node = findNode(word);
+
+    if (node > 0)
+    {
+        _nodes[node].preferred = true;
+        update(node);
+    }
+}
+
+void WordIndex::clear()
+{
+    WordIndexNode root = { 0, false, 0, 0, -1, -1, -1 };
+
+    _nodes.clear();
+    _nodes.addLast(root);
+    _freeNodes.clear();
+}
+
+void WordIndex::findWords(const String& prefix, int maxWords, Array<AutocompleteSuggestion>& words) const
+{
+    ASSERT(maxWords > 0);
+
+    words.clear();
+
+    int node = findNode(prefix);
+    if (node < 0)
+        return;
+
+    // best-first search over the subtree, every node knows the best rank below it
+    // so words come out in rank order and the search stops after maxWords
+
+    Array<WordIndexCandidate> heap;
+
+    for (int child = _nodes[node].firstChild; child >= 0; child = _nodes[child].nextSibling)
+        pushCandidate(heap, { _nodes[child].best, child, false });
+
+    while (!heap.empty() && words.size() < maxWords)
+    {
+        WordIndexCandidate candidate = popCandidate(heap);
+
+        if (candidate.word)
+            words.addLast(AutocompleteSuggestion(word(candidate.node), candidate.rank));
+        else
+        {
+            int r = rank(candidate.node);
+            if (r > 0)
+                pushCandidate(heap, { r, candidate.node, true });
+
+            for (int child = _nodes[candidate.node].firstChild; child >= 0; child = _nodes[child].nextSibling)
+                pushCandidate(heap, { _nodes[child].best, child, false });
+        }
+    }
+
+    words.sort();
+}
+
+int WordIndex::findNode(const String& word) const
+{
+    int node = 0;
+
+    for (int i = 0; i < word.length() && node >= 0; ++i)
+        node = findChild(node, word.chars()[i]);
+
+    return node;
+}
+
+int WordIndex::findChild(int node, char_t ch) const
+{
+    int child = _nodes[node].firstChild;
+
+    while (child >= 0 && _nodes[child].ch != ch)
+        child = _nodes[child].nextSibling;
+
+    return child;
+}
+
+int WordIndex::addChild(int node, char_t ch)
+{
+    WordIndexNode child = { ch, false, 0, 0, node, -1, _nodes[node].firstChild };
+    int index;
+
+    if (_freeNodes.empty())
+    {
+        index = _nodes.size();
+        _nodes.addLast(child);
+    }
+    else
+    {
+        index = _freeNodes.last();
+        _freeNodes.removeLast();
+        _nodes[index] = child;
+    }
+
+    _nodes[node].firstChild = index;
+    return index;
+}
+
+void WordIndex::removeChild(int node, int child)
+{
+    int* link = &_nodes[node].firstChild;
+
+    while (*link != child)
+        link = &_nodes[*link].nextSibling;
+
+    *link = _nodes[child].nextSibling;
+    _freeNodes.addLast(child);
+}
+
+int WordIndex::rank(int node) const
+{
+    const WordIndexNode& n = _nodes[node];
+    return n.count > 0 ? (n.preferred ? INT_MAX : n.count) : 0;
+}
+
+void WordIndex::update(int node)
+{
+    while (node > 0)
+    {
+        int parent = _nodes[node].parent;
+
+        if (_nodes[node].count == 0 && _nodes[node].firstChild < 0)
+        {
+            removeChild(parent, node);
+            node = parent;
+            continue;
+        }
+
+        int best = rank(node);
+
+        for (int child = _nodes[node].firstChild; child >= 0; child = _nodes[child].nextSibling)
+            best = max(best, _nodes[child].best);
+
+        if (best == _nodes[node].best)
+            break;
+
+        _nodes[node].best = best;
+        node = parent;
+    }
+}
+
+String WordIndex::word(int node) const
+{
+    int len = 0;
+    for (int n = node; n > 0; n = _nodes[n].parent)
+        ++len;
+
+    Buffer<char_t> chars(len);
+    for (int n = node; n > 0; n = _nodes[n].parent)
+        chars[--len] = _nodes[n].ch;
+
+    return String(chars.values(), chars.size());
+}
+
+// ProjectIndex
+
+// index file layout: magic, version, char size, project word counts, file count, files
+// file: size, modification time, path, word counts
+// word counts: byte length, word count, words (count, length, chars)
+
+const byte_t PROJECT_INDEX_MAGIC[] = { 'E', 'V', 'I', 'X' };
+const uint32_t PROJECT_INDEX_VERSION = 1;
+const int64_t MAX_INDEXED_FILE_SIZE = 4 * 1024 * 1024;
+
+void addWordCount(WordIndex& words, const String& word, int count)
+{
+    words.add(word, count);
+}
+
+template<typename _Type>
+void readIndexValue(const byte_t*& data, const byte_t* end, _Type& value)
+{
+    if (static_cast<size_t>(end - data) < sizeof(_Type))
+        throw Exception(STR("project index is corrupted"));
+
+    memcpy(&value, data, sizeof(_Type));
+    data += sizeof(_Type);
+}
+
+const byte_t* readIndexBlock(const byte_t*& data, const byte_t* end, uint32_t size)
+{
+    if (static_cast<size_t>(end - data) < size)
+        throw Exception(STR("project index is corrupted"));
+
+    const byte_t* block = data;
+    data += size;
+
+    return block;
+}
+
+String readIndexString(const byte_t*& data, const byte_t* end)
+{
+    uint32_t len;
+    readIndexValue(data, end, len);
+
+    if (len > INT_MAX / sizeof(char_t))
+        throw Exception(STR("project index is corrupted"));
+
+    const byte_t* chars = readIndexBlock(data, end, len * sizeof(char_t));
+
+    Buffer<char_t> buffer(len);
+    memcpy(buffer.values(), chars, len * sizeof(char_t));
+
+    return String(buffer.values(), buffer.size());
+}
+
+void skipIndexWords(const byte_t*& data, const byte_t* end)
+{
+    uint32_t size, wordCount;
+    readIndexValue(data, end, size);
+
+    const byte_t* words = readIndexBlock(data, end, size);
+    const byte_t* wordsEnd = words + size;
+
+    readIndexValue(words, wordsEnd, wordCount);
+
+    for (uint32_t i = 0; i < wordCount; ++i)
+    {
+        int32_t count;
+        uint32_t len;
+
+        readIndexValue(words, wordsEnd, count);
+        readIndexValue(words, wordsEnd, len);
+
+        if (len > INT_MAX / sizeof(char_t))
+            throw Exception(STR("project index is corrupted"));
+
+        readIndexBlock(words, wordsEnd, len * sizeof(char_t));
+    }
+}
+
+template<typename _Words>
+void readIndexWords(const byte_t* data, const byte_t* end, _Words& words, int sign)
+{
+    uint32_t wordCount;
+    readIndexValue(data, end, wordCount);
+
+    for (uint32_t i = 0; i < wordCount; ++i)
+    {
+        int32_t count;
+        readIndexValue(data, end, count);
+        addWordCount(words, readIndexString(data, end), sign * count);
+    }
+}
+
+template<typename _Type>
+void writeIndexValue(byte_t*& data, const _Type& value)
+{
+    memcpy(data, &value, sizeof(_Type));
+    data += sizeof(_Type);
+}
+
+void writeIndexString(byte_t*& data, const String& str)
+{
+    writeIndexValue(data, static_cast<uint32_t>(str.length()));
+    memcpy(data, str.chars(), str.length() * sizeof(char_t));
+    data += str.length() * sizeof(char_t);
+}
+
+ByteBuffer encodeIndexWords(const FlatMap<String, int>& words)
+{
+    int64_t size = sizeof(uint32_t);
+
+    auto sizeIt = words.constIterator();
+    while (sizeIt.moveNext())
+        size += sizeof(int32_t) + sizeof(uint32_t) + sizeIt.value().key.length() * sizeof(char_t);
+
+    if (size > INT_MAX)
+        throw Exception(STR("project index is too large"));
+
+    ByteBuffer buffer(static_cast<int>(size));
+    byte_t* data = buffer.values();
+
+    writeIndexValue(data, static_cast<uint32_t>(words.size()));
+
+    auto it = words.constIterator();
+    while (it.moveNext())
+    {
+        writeIndexValue(data, static_cast<int32_t>(it.value().value));
+        writeIndexString(data, it.value().key);
+    }
+
+    return buffer;
+}
+
+bool readIndexHeader(const byte_t*& data, const byte_t* end)
+{
+    byte_t magic[sizeof(PROJECT_INDEX_MAGIC)];
+    uint32_t version, charSize;
+
+    readIndexValue(data, end, magic);
+    readIndexValue(data, end, version);
+    readIndexValue(data, end, charSize);
+
+    return memcmp(magic, PROJECT_INDEX_MAGIC, sizeof(magic)) == 0 &&
+        version == PROJECT_INDEX_VERSION && charSize == sizeof(char_t);
+}
+
+bool isIndexedFile(const String& filename)
+{
+    return filename.endsWith(STR(".c")) || filename.endsWith(STR(".h")) || filename.endsWith(STR(".cpp")) ||
+        filename.endsWith(STR(".hpp")) || filename.endsWith(STR(".cc")) || filename.endsWith(STR(".sh")) ||
+        filename.endsWith(STR(".ksh")) || filename.endsWith(STR(".bat")) || filename.endsWith(STR(".cmd")) ||
+        filename.endsWith(STR(".ps1")) || filename.endsWith(STR(".xml")) || filename.endsWith(STR(".xsd")) ||
+        filename.endsWith(STR(".htm")) || filename.endsWith(STR(".html")) || filename.endsWith(STR(".py")) ||
+        filename.endsWith(STR(".js")) || filename.endsWith(STR(".txt"));
+}
+
+void countWords(FlatMap<String, int>& words, const String& text)
+{
+    int p = 0;
+
+    while (p < text.length())
+    {
+        while (p < text.length() && !charIsWord(text.charAt(p)))
+            p = text.charForward(p);
+
+        int q = p;
+        while (q < text.length() && charIsWord(text.charAt(q)))
+            q = text.charForward(q);
+
+        if (q > p)
+            ++words[text.substr(p, q - p)];
+
+        p = q;
+    }
+}
+
+ProjectIndex::ProjectIndex(const String& filename) :
+    _filename(filename), _loaded(false), _finished(false), _cancelled(false)
+{
+}
+
+ProjectIndex::~ProjectIndex()
+{
+    {
+        MutexLock lock(_mutex);
+        _cancelled = true;
+    }
+
+    _thread.join();
+}
+
+void ProjectIndex::start(WordIndex& words)
+{
+    ASSERT(!_thread.started());
+    Memory::Scope scope("index");
+
+    // the whole index is checked before anything is added so that a damaged
+    // file contributes nothing, the worker thread relies on _loaded to agree
+
+    try
+    {
+        File file;
+
+        if (file.open(_filename))
+        {
+            // read rather than mapped, a mapped file that is truncated while being parsed
+            // can't be stopped without leaking what the parser allocated
+
+            ByteBuffer bytes = file.read();
+            const byte_t* data = bytes.values();
+            const byte_t* end = data + bytes.size();
+
+            if (readIndexHeader(data, end))
+            {
+                const byte_t* projectWords = data;
+                skipIndexWords(data, end);
+
+                uint32_t fileCount;
+                readIndexValue(data, end, fileCount);
+
+                for (uint32_t i = 0; i < fileCount; ++i)
+                {
+                    int64_t size, modified;
+                    uint32_t len;
+
+                    readIndexValue(data, end, size);
+                    readIndexValue(data, end, modified);
+                    readIndexValue(data, end, len);
+
+                    if (len > INT_MAX / sizeof(char_t))
+                        throw Exception(STR("project index is corrupted"));
+
+                    readIndexBlock(data, end, len * sizeof(char_t));
+                    skipIndexWords(data, end);
+                }
+
+                uint32_t size;
+                readIndexValue(projectWords, end, size);
+                readIndexWords(projectWords, projectWords + size, words, 1);
+                _loaded = true;
+            }
+        }
+    }
+    catch (Exception&)
+    {
+    }
+
+    _thread.start(updateProc, this);
+}
+
+void ProjectIndex::mergeWords(WordIndex& words)
+{
+    if (!_thread.started())
+        return;
+
+    {
+        MutexLock lock(_mutex);
+        if (!_finished)
+            return;
+    }
+
+    _thread.join();
+
+    auto it = _wordChanges.constIterator();
+    while (it.moveNext())
+        words.add(it.value().key, it.value().value);
+
+    _wordChanges.clear();
+}
+
+void ProjectIndex::updateProc(void* param)
+{
+    static_cast<ProjectIndex*>(param)->update();
+}
+
+void ProjectIndex::load(FlatMap<String, int>& words)
+{
+    File file(_filename);
+    ByteBuffer bytes = file.read();
+    const byte_t* data = bytes.values();
+    const byte_t* end = data + bytes.size();
+
+    readIndexHeader(data, end);
+
+    uint32_t size, fileCount;
+    readIndexValue(data, end, size);
+
+    const byte_t* projectWords = readIndexBlock(data, end, size);
+    readIndexWords(projectWords, projectWords + size, words, 1);
+
+    readIndexValue(data, end, fileCount);
+
+    for (uint32_t i = 0; i < fileCount; ++i)
+    {
+        ProjectFile projectFile;
+
+        readIndexValue(data, end, projectFile.size);
+        readIndexValue(data, end, projectFile.modified);
+        projectFile.path = readIndexString(data, end);
+
+        readIndexValue(data, end, size);
+
+        const byte_t* fileWords = readIndexBlock(data, end, size);
+        projectFile.words = ByteBuffer(static_cast<int>(size), fileWords);
+
+        _files.addLast(static_cast<ProjectFile&&>(projectFile));
+    }
+}
+
+void ProjectIndex::save(const FlatMap<String, int>& words)
+{
+    ByteBuffer projectWords = encodeIndexWords(words);
+    int64_t size = sizeof(PROJECT_INDEX_MAGIC) + 4 * sizeof(uint32_t) + projectWords.size();
+
+    for (int i = 0; i < _files.size(); ++i)
+        size += 2 * sizeof(int64_t) + 2 * sizeof(uint32_t) +
+            _files[i].path.length() * sizeof(char_t) + _files[i].words.size();
+
+    if (size > INT_MAX)
+        throw Exception(STR("project index is too large"));
+
+    ByteBuffer buffer(static_cast<int>(size));
+    byte_t* data = buffer.values();
+
+    writeIndexValue(data, PROJECT_INDEX_MAGIC);
+    writeIndexValue(data, PROJECT_INDEX_VERSION);
+    writeIndexValue(data, static_cast<uint32_t>(sizeof(char_t)));
+    writeIndexValue(data, static_cast<uint32_t>(projectWords.size()));
+    memcpy(data, projectWords.values(), projectWords.size());
+    data += projectWords.size();
+    writeIndexValue(data, static_cast<uint32_t>(_files.size()));
+
+    for (int i = 0; i < _files.size(); ++i)
+    {
+        writeIndexValue(data, _files[i].size);
+        writeIndexValue(data, _files[i].modified);
+        writeIndexString(data, _files[i].path);
+        writeIndexValue(data, static_cast<uint32_t>(_files[i].words.size()));
+        memcpy(data, _files[i].words.values(), _files[i].words.size());
+        data += _files[i].words.size();
+    }
+
+    ASSERT(data == buffer.values() + buffer.size());
+
+    String tempFilename = _filename + STR(".tmp");
+
+    try
+    {
+        {
+            File file(tempFilename, FILE_MODE_WRITE | FILE_MODE_CREATE | FILE_MODE_TRUNCATE);
+            file.write(buffer);
+            file.flush();
+        }
+
+        File::replace(_filename, tempFilename);
+    }
+    catch (...)
+    {
+        if (File::exists(tempFilename))
+            File::remove(tempFilename);
+        throw;
+    }
+}
+
+void ProjectIndex::update()
+{
+    Memory::Scope scope("index");
+
+    // runs on the worker thread, the main thread doesn't touch
+    // _files and _wordChanges until _finished is set
+
+    try
+    {
+        FlatMap<String, int> words;
+
+        if (_loaded)
+            load(words);
+
+        FlatMap<String, int> fileIndex;
+        for (int i = 0; i < _files.size(); ++i)
+            fileIndex[_files[i].path] = i;
+
+        Array<ProjectFile> files;
+        indexDirectory(STR("."), fileIndex, files);
+
+        if (!cancelled())
+        {
+            // files that weren't reused were deleted or changed
+
+            auto it = fileIndex.constIterator();
+            while (it.moveNext())
+            {
+                int i = it.value().value;
+
+                if (i != INVALID_POSITION)
+                {
+                    const ByteBuffer& fileWords = _files[i].words;
+                    readIndexWords(fileWords.values(), fileWords.values() + fileWords.size(), _wordChanges, -1);
+                }
+            }
+
+            auto changeIt = _wordChanges.constIterator();
+            while (changeIt.moveNext())
+                addWordCount(words, changeIt.value().key, changeIt.value().value);
+
+            swap(_files, files);
+            save(words);
+        }
+    }
+    catch (Exception&)
+    {
+    }
+
+    MutexLock lock(_mutex);
+    _finished = true;
+}
+
+void ProjectIndex::indexDirectory(const String& path, FlatMap<String, int>& fileIndex, Array<ProjectFile>& files)
+{
+    Array<DirectoryEntry> entries;
+
+    try
+    {
+        entries = Directory::entries(path);
+    }
+    catch (Exception&)
+    {
+        return;
+    }
+
+    for (int i = 0; i < entries.size() && !cancelled(); ++i)
+    {
+        const DirectoryEntry& entry = entries[i];
+        String entryPath = path + Environment::DIRECTORY_SEPARATOR + entry.name;
+
+        if (entry.directory)
+        {
+            if (!entry.name.startsWith(STR(".")))
+                indexDirectory(entryPath, fileIndex, files);
+        }
+        else if (isIndexedFile(entry.name) && entry.size <= MAX_INDEXED_FILE_SIZE)
+        {
+            int* index = fileIndex.find(entryPath);
+
+            if (index && _files[*index].size == entry.size && _files[*index].modified == entry.modified)
+            {
+                files.addLast(static_cast<ProjectFile&&>(_files[*index]));
+                *index = INVALID_POSITION;
+                continue;
+            }
+
+            ProjectFile projectFile;
+            projectFile.path = entryPath;
+            projectFile.size = entry.size;
+            projectFile.modified = entry.modified;
+
+            try
+            {
+                File file(entryPath);
+                FileMapping mapping(file);
+                TextEncoding encoding;
+                bool bom, crLf;
+                FlatMap<String, int> words;
+
+                countWords(words, Unicode::bytesToString(
+                    static_cast<int>(mapping.size()), mapping.data(), encoding, bom, crLf));
+                projectFile.words = encodeIndexWords(words);
+
+                auto it = words.constIterator();
+                while (it.moveNext())
+                    addWordCount(_wordChanges, it.value().key, it.value().value);
+            }
+            catch (Exception&)
+            {
+                continue;
+            }
+
+            files.addLast(static_cast<ProjectFile&&>(projectFile));
+        }
+    }
+}
+
+bool ProjectIndex::cancelled()
+{
+    MutexLock lock(_mutex);
+    return _cancelled;
+}
+
+// DocumentLoader
+
+DocumentLoader::DocumentLoader(Editor* editor, const Array<String>& filenames) :
+    _filenames(filenames), _states(filenames.size(), LOAD_STATE_PENDING), _errors(filenames.size()),
+    _nextDocument(0), _nextFile(0), _cancelled(false)
+{
+    ASSERT(editor);
+
+    for (int i = 0; i < _filenames.size(); ++i)
+        _documents.addLast(createUnique<Document>(editor));
+
+    int numThreads = min(Thread::processorCount(), _filenames.size());
+
+    for (int i = 0; i < numThreads; ++i)
+    {
+        _threads.addLast(createUnique<Thread>());
+        _threads[i]->start(loadProc, this);
+    }
+}
+
+DocumentLoader::~DocumentLoader()
+{
+    {
+        MutexLock lock(_mutex);
+        _cancelled = true;
+    }
+
+    for (int i = 0; i < _threads.size(); ++i)
+        _threads[i]->join();
+}
+
+void DocumentLoader::moveDocuments(List<Document>& documents, String& message)
+{
+    // documents are added in the order they were requested, a document that
+    // takes long to load holds back the ones after it
+
+    while (_nextDocument < _documents.size())
+    {
+        LoadState state;
+
+        {
+            MutexLock lock(_mutex);
+            state = _states[_nextDocument];
+        }
+
+        if (state == LOAD_STATE_PENDING)
+            break;
+        else if (state == LOAD_STATE_LOADED)
+            documents.addLast(static_cast<Document&&>(*_documents[_nextDocument]));
+        else
+            message = _errors[_nextDocument];
+
+        _documents[_nextDocument] = Unique<Document>();
+        ++_nextDocument;
+    }
+}
+
+void DocumentLoader::loadProc(void* param)
+{
+    static_cast<DocumentLoader*>(param)->load();
+}
+
+void DocumentLoader::load()
+{
+    Memory::Scope scope("load");
+
+    // each document is only touched by the thread that claimed it until
+    // its state is set, after that only by the main thread
+
+    while (true)
+    {
+        int i;
+
+        {
+            MutexLock lock(_mutex);
+
+            if (_cancelled || _nextFile == _filenames.size())
+                break;
+
+            i = _nextFile++;
+        }
+
+        LoadState state = LOAD_STATE_LOADED;
+        String error;
+
+        try
+        {
+            _documents[i]->open(_filenames[i]);
+        }
+        catch (Exception& ex)
+        {
+            state = LOAD_STATE_FAILED;
+            error = ex.message();
         }
-    }
 
-    return start;
-}
+        {
+            MutexLock lock(_mutex);
+            _states[i] = state;
+            _errors[i] = error;
+        }
 
-void Document::determineDocumentType(bool fileExecutable)
-{
-    if (_filename.endsWith(STR(".c")) || _filename.endsWith(STR(".h")) || _filename.endsWith(STR(".cpp")) ||
-            _filename.endsWith(STR(".hpp")) || _filename.endsWith(STR(".cc")))
-        _documentType = DOCUMENT_TYPE_CPP;
-    else if (_filename.endsWith(STR(".sh")) || _filename.endsWith(STR(".ksh")))
-        _documentType = DOCUMENT_TYPE_SHELL;
-    else if (_filename.endsWith(STR(".bat")) || _filename.endsWith(STR(".cmd")))
-        _documentType = DOCUMENT_TYPE_BATCH;
-    else if (_filename.endsWith(STR(".ps1")))
-        _documentType = DOCUMENT_TYPE_POWERSHELL;
-    else if (_filename.endsWith(STR(".xml")) || _filename.endsWith(STR(".xsd")) || _filename.endsWith(STR(".htm")) ||
-             _filename.endsWith(STR(".html")) || _text.startsWith(STR("<?xml")))
-        _documentType = DOCUMENT_TYPE_XML;
-    else if (_filename.endsWith(STR(".py")))
-        _documentType = DOCUMENT_TYPE_PYTHON;
-    else if (_filename.endsWith(STR(".js")))
-        _documentType = DOCUMENT_TYPE_JAVASCRIPT;
-    else
-        _documentType = DOCUMENT_TYPE_TEXT;
+        // the main thread adds the document when readInput() returns
 
-    if (_documentType == DOCUMENT_TYPE_TEXT && fileExecutable)
-        _documentType = DOCUMENT_TYPE_SHELL;
+        Console::wake();
+    }
 }
 
 // Editor
 
 Editor::Editor(const Array<String>& args) :
-    Application(args, STR("ev")), _commandLine(Document(this), nullptr, nullptr), _document(nullptr), _lastDocument(nullptr),
+    Application(args, STR("ev")), _commandLine(nullptr, nullptr, this), _document(nullptr), _lastDocument(nullptr),
+    _drawnDocument(nullptr),
     _recordingMacro(false), _width(120), _height(60), _cursorLine(0), _cursorColumn(0),
-    _charWidth(1), _charHeight(1), _offsetX(0), _offsetY(0),
+    _charWidth(1), _charHeight(1), _offsetX(0), _offsetY(0), _frameBytes(0), _frameWrites(0), _frames(0), _totalFrameBytes(0),
+    _updatePending(false), _redrawPending(false), _inputTime(0), _frameTime(0), _latencies(),
     _caseSesitive(true), _recentLocation(nullptr),
     _currentSuggestion(INVALID_POSITION)
 {
@@ -2138,6 +2845,13 @@ Editor::Editor(const Array<String>& args) :
     String term = Environment::getVariable(STR("TERM"));
     _unicodeLimit16 = term.contains(STR("xterm"));
 #endif
+
+#if !defined(GUI_MODE) && !defined(PLATFORM_WINDOWS)
+    _outputLine = _outputColumn = _outputColor = -1;
+
+    for (int color = 0; color < MAX_CONSOLE_COLORS; ++color)
+        _colorSequences.addLast(String::format(STR("\x1b[0;%dm"), color));
+#endif
 }
 
 SyntaxHighlighter* Editor::syntaxHighlighter(DocumentType documentType)
@@ -2162,9 +2876,7 @@ void Editor::newDocument(const String& filename)
 {
     ASSERT(!filename.empty());
 
-    _documents.addLast(Document(this));
-    _document = _documents.last();
-
+    _document = _documents.emplaceLast(this);
     _document->value.setDimensions(1, 1, _width, _height - 1);
     _document->value.filename(filename);
 }
@@ -2173,24 +2885,71 @@ void Editor::openDocument(const String& filename)
 {
     ASSERT(!filename.empty());
 
-    Document doc(this);
-    doc.setDimensions(1, 1, _width, _height - 1);
+    // the document is opened in its list node so that its text is never copied
+
+    auto doc = _documents.emplaceLast(this);
+    doc->value.setDimensions(1, 1, _width, _height - 1);
 
     try
     {
-        doc.open(filename);
-
-        _documents.addLast(doc);
-        _document = _documents.last();
-
-        findUniqueWords();
+        doc->value.open(filename, true);
+        _document = doc;
     }
     catch (Exception& ex)
     {
+        _documents.remove(doc);
         _message = ex.message();
     }
 }
 
+void Editor::addLoadedDocuments()
+{
+    if (_documentLoader.ptr())
+    {
+        auto last = _documents.last();
+        _documentLoader->moveDocuments(_documents, _message);
+
+        for (auto doc = last ? last->next : _documents.first(); doc; doc = doc->next)
+            doc->value.setDimensions(1, 1, _width, _height - 1);
+
+        if (!_document)
+            _document = _documents.first();
+
+        if (_documentLoader->finished())
+            _documentLoader = Unique<DocumentLoader>();
+    }
+}
+
+bool Editor::finishDecodingDocuments(bool wait)
+{
+    bool finished = false;
+
+    for (auto doc = _documents.first(); doc;)
+    {
+        auto next = doc->next;
+
+        try
+        {
+            finished = doc->value.finishDecoding(wait) || finished;
+        }
+        catch (Exception& ex)
+        {
+            // only part of the text was decoded, it must not be edited or saved
+
+            if (_document == doc)
+                _document = next ? next : _documents.first() != doc ? _documents.first() : nullptr;
+
+            _documents.remove(doc);
+            _message = ex.message();
+            finished = true;
+        }
+
+        doc = next;
+    }
+
+    return finished;
+}
+
 void Editor::saveDocument()
 {
     if (_document)
@@ -2204,8 +2963,6 @@ void Editor::saveDocument()
         {
             _message = ex.message();
         }
-
-        findUniqueWords();
     }
 }
 
@@ -2223,24 +2980,28 @@ void Editor::saveAllDocuments()
             _message = ex.message();
         }
     }
-
-    findUniqueWords();
 }
 
 void Editor::closeDocument()
 {
     if (_document)
     {
+        _document->value.mergeWordChanges(_uniqueWords);
+
+        auto it = _document->value.words().constIterator();
+        while (it.moveNext())
+            _uniqueWords.add(it.value().key, -it.value().value);
+
         auto doc = _document->next;
         _documents.remove(_document);
         _document = doc;
-
-        findUniqueWords();
     }
 }
 
 bool Editor::start()
 {
+    Array<String> filenames;
+
     for (int i = 1; i < _args.size(); ++i)
     {
         if (_args[i] == STR("--version"))
@@ -2261,13 +3022,34 @@ bool Editor::start()
             return false;
         }
         else
-            openDocument(_args[i]);
+            filenames.addLast(_args[i]);
+    }
+
+    // the first document is opened right away so that it can be shown,
+    // the rest are loaded on other threads and added as they become ready
+
+    if (filenames.size() > 1)
+    {
+        Array<String> otherFilenames;
+        for (int i = 1; i < filenames.size(); ++i)
+            otherFilenames.addLast(filenames[i]);
+
+        _documentLoader = createUnique<DocumentLoader>(this, otherFilenames);
     }
 
+    if (filenames.size() > 0)
+        openDocument(filenames[0]);
+
     readConfigFile(Environment::getUserDirectory() +
         Environment::DIRECTORY_SEPARATOR + CONFIG_FILE_NAME);
     readConfigFile(CONFIG_FILE_NAME);
 
+    if (_indexProject)
+    {
+        _projectIndex = createUnique<ProjectIndex>(String(PROJECT_INDEX_FILE_NAME));
+        _projectIndex->start(_uniqueWords);
+    }
+
     _document = _documents.first();
 
     return true;
@@ -2335,10 +3117,27 @@ void Editor::onResize(int width, int height)
 
 void Editor::onInput(const Array<InputEvent>& inputEvents)
 {
+    int64_t inputTime = Timer::ticks();
     bool update = false, modified = false;
     bool autocomplete = false, redrawAll = false;
     bool multipleInputEvents = inputEvents.size() > 1;
 
+    // input waits for documents still being decoded, an empty batch from
+    // Console::wake() only takes the ones that are done
+
+    // input waits for documents that are still decoding, the empty batch that
+    // Console::wake() causes only takes the ones that are done
+
+    ListNode<Document>* document = _document;
+
+    if (finishDecodingDocuments(!inputEvents.empty()))
+        update = redrawAll = true;
+
+    addLoadedDocuments();
+
+    if (_document != document)
+        update = redrawAll = true;
+
     for (int i = 0; i < inputEvents.size(); ++i)
     {
         InputEvent event = inputEvents[i];
@@ -2427,18 +3226,19 @@ void Editor::onInput(const Array<InputEvent>& inputEvents)
                         if (!_searchStr.empty())
                         {
                             _caseSesitive = true;
-                            update = doc.find(_searchStr, _caseSesitive, true);
+                            _searcher.assign(_searchStr, _caseSesitive);
+                            update = doc.find(_searcher, true);
                         }
                     }
                     else if (keyEvent.ch == 'f')
                     {
                         if (!_searchStr.empty())
-                            update = doc.find(_searchStr, _caseSesitive, true);
+                            update = doc.find(_searcher, true);
                     }
                     else if (keyEvent.ch == 'r')
                     {
                         if (!_searchStr.empty())
-                            modified = update = doc.replace(_searchStr, _replaceStr, _caseSesitive);
+                            modified = update = doc.replace(_searcher, _replaceStr);
                     }
                     else if (keyEvent.ch == 'a')
                     {
@@ -2457,6 +3257,14 @@ void Editor::onInput(const Array<InputEvent>& inputEvents)
                         _buffer = doc.copyDeleteText(true);
                         copyToClipboard(_buffer);
                     }
+                    else if (keyEvent.ch == 'z')
+                    {
+                        modified = update = doc.undo();
+                    }
+                    else if (keyEvent.ch == 'y')
+                    {
+                        modified = update = doc.redo();
+                    }
                     else if (keyEvent.ch == 'v' || keyEvent.ch == 'l')
                     {
                         pasteFromClipboard(_buffer);
@@ -2514,6 +3322,14 @@ void Editor::onInput(const Array<InputEvent>& inputEvents)
                     {
                         update = doc.toggleSelectionStart();
                     }
+                    else if (keyEvent.ch == 'z')
+                    {
+                        modified = update = doc.undo();
+                    }
+                    else if (keyEvent.ch == 'y')
+                    {
+                        modified = update = doc.redo();
+                    }
                     else if (keyEvent.ch == 'b')
                     {
                         update = doc.moveCharsBack();
@@ -2562,7 +3378,7 @@ void Editor::onInput(const Array<InputEvent>& inputEvents)
                     }
                     else if (keyEvent.ch == '\'')
                     {
-                        findUniqueWords();
+                        updateUniqueWords();
                         updateScreen(true);
                     }
                     else if (keyEvent.ch >= '0' && keyEvent.ch <= '9')
@@ -2717,7 +3533,7 @@ void Editor::onInput(const Array<InputEvent>& inputEvents)
                         {
                             if (!_commandLine.value.text().empty())
                             {
-                                if (!executeCommand(_commandLine.value.text()))
+                                if (!executeCommand(_commandLine.value.text().substr(0)))
                                 {
                                     destroyWindow();
                                     return;
@@ -2785,7 +3601,7 @@ void Editor::onInput(const Array<InputEvent>& inputEvents)
                         else
                         {
                             doc.insertChar(keyEvent.ch, true);
-                            _uniqueWords[_suggestions[_currentSuggestion].word] = INT_MAX;
+                            _uniqueWords.prefer(_suggestions[_currentSuggestion].word);
                             _currentSuggestion = INVALID_POSITION;
                         }
                     }
@@ -2844,64 +3660,401 @@ void Editor::onInput(const Array<InputEvent>& inputEvents)
         }
     }
 
-    if (update)
+    if (update)
+    {
+        if (_currentSuggestion != INVALID_POSITION && !autocomplete)
+            _currentSuggestion = INVALID_POSITION;
+        scheduleUpdate(redrawAll, inputTime);
+    }
+    else if (_updatePending)
+        scheduleUpdate(false, inputTime);
+
+    if (modified && _document != &_commandLine)
+        updateRecentLocations();
+}
+
+void Editor::measureCharSize()
+{
+#ifdef GUI_MODE
+    TextBlock textBlock = _graphics->createTextBlock(_guiFontName,
+        _guiFontSize, STR("w"), { _guiFontSize, _guiFontSize });
+    Size size = textBlock.size();
+
+    _charWidth = size.width;
+    _charHeight = size.height;
+    ASSERT(_charWidth > 0 && _charHeight > 0);
+#endif
+}
+
+void Editor::computeWidthHeight()
+{
+#ifdef GUI_MODE
+    Size size = _graphics->size();
+
+    _width = size.width / _charWidth;
+    _height = size.height / _charHeight;
+
+    _offsetX = (size.width - _width * _charWidth) / 2;
+    _offsetY = (size.height - _height * _charHeight) / 2;
+#endif
+}
+
+void Editor::setDimensions()
+{
+    if (_width < 2)
+        _width = 2;
+
+    if (_height < 2)
+        _height = 2;
+
+    _screen.assign(_width * _height, ScreenCell());
+    _prevScreen.assign(_width * _height, ScreenCell());
+    _dirtyRows.assign(_height, true);
+    _drawnDocument = nullptr;
+
+#ifndef GUI_MODE
+    _emptyRowHash = hashBytes(_screen.values(), _width * static_cast<int>(sizeof(ScreenCell)));
+    _rowHashes.assign(_height, _emptyRowHash);
+    _prevRowHashes.assign(_height, _emptyRowHash);
+#endif
+
+    _commandLine.value.setDimensions(2, _height, _width - 1, 1);
+
+    for (auto doc = _documents.first(); doc; doc = doc->next)
+        doc->value.setDimensions(1, 1, _width, _height - 1);
+}
+
+#ifdef GUI_MODE
+
+Rect Editor::rectFromLineCol(int left, int top, int right, int bottom)
+{
+    return { left * _charWidth + _offsetX, top * _charHeight + _offsetY,
+        right * _charWidth + _offsetX, bottom * _charHeight + _offsetY };
+}
+
+#endif
+
+#ifndef GUI_MODE
+
+int Editor::findScrollOffset(int top, int bottom) const
+{
+    // finds the vertical shift of rows top to bottom from the previous frame that
+    // leaves the most rows matching, positive when the rows moved up
+
+    int rows = bottom - top + 1, dirtyRows = 0;
+    const int* hashes = _rowHashes.values() + top;
+    const int* prevHashes = _prevRowHashes.values() + top;
+
+    for (int j = top; j <= bottom; ++j)
+        dirtyRows += _dirtyRows[j];
+
+    if (dirtyRows < 2)
+        return 0;
+
+    int bestOffset = 0, bestGain = 1;
+
+    for (int offset = 1 - rows; offset < rows; ++offset)
+    {
+        if (offset == 0)
+            continue;
+
+        int gain = 0;
+
+        for (int j = 0; j < rows; ++j)
+        {
+            int shiftedHash = j + offset >= 0 && j + offset < rows ? prevHashes[j + offset] : _emptyRowHash;
+            gain += (hashes[j] == shiftedHash) - (hashes[j] == prevHashes[j]);
+        }
+
+        if (gain > bestGain || (gain == bestGain && bestOffset != 0 && abs(offset) < abs(bestOffset)))
+        {
+            bestOffset = offset;
+            bestGain = gain;
+        }
+    }
+
+    return bestOffset;
+}
+
+void Editor::scrollPrevScreen(int top, int bottom, int offset)
+{
+    // the previous frame as it looks on the console after scrolling rows top to bottom
+
+    ASSERT(offset != 0);
+
+    if (offset > 0)
+    {
+        for (int j = top; j <= bottom; ++j)
+            scrollPrevRow(j, j + offset <= bottom ? j + offset : -1);
+    }
+    else
+    {
+        for (int j = bottom; j >= top; --j)
+            scrollPrevRow(j, j + offset >= top ? j + offset : -1);
+    }
+}
+
+void Editor::scrollPrevRow(int row, int fromRow)
+{
+    // rows that moved no longer match the new frame in the same place
+
+    for (int i = 0; i < _width; ++i)
+        _prevScreen[row * _width + i] = fromRow >= 0 ? _prevScreen[fromRow * _width + i] : ScreenCell();
+
+    _prevRowHashes[row] = fromRow >= 0 ? _prevRowHashes[fromRow] : _emptyRowHash;
+    _dirtyRows[row] = true;
+}
+
+#endif
+
+#if !defined(GUI_MODE) && !defined(PLATFORM_WINDOWS)
+
+// characters that move the terminal cursor exactly one column, after any other
+// character the cursor position is treated as unknown
+
+inline bool charHasUnitWidth(unichar_t ch)
+{
+    return (ch >= 0x20 && ch < 0x7f) || (ch >= 0xa0 && ch < 0x300) || (ch >= 0x370 && ch < 0x1100);
+}
+
+inline int decimalLength(int n)
+{
+    int len = 1;
+
+    while (n >= 10)
+    {
+        n /= 10;
+        ++len;
+    }
+
+    return len;
+}
+
+void appendDecimal(String& str, int n)
+{
+    char_t digits[16];
+    int len = decimalLength(n);
+
+    for (int i = len - 1; i >= 0; --i)
+    {
+        digits[i] = '0' + n % 10;
+        n /= 10;
+    }
+
+    str.append(digits, len);
+}
+
+inline bool cellsDiffer(const ScreenCell& cell, const ScreenCell& prevCell)
+{
+    // the color of an empty cell is not visible
+    return cell.ch != prevCell.ch || (cell.ch && cell.color != prevCell.color);
+}
+
+int Editor::colorCost(int color) const
+{
+    return color >= 0 && color != _outputColor ? _colorSequences[color].length() : 0;
+}
+
+int Editor::forwardCost(int line, int from, int to, int color, bool& rewrite) const
+{
+    // moving the cursor forward on the same line either with a cursor forward
+    // sequence or by writing the cells in between again, whichever is shorter
+
+    ASSERT(from <= to);
+    rewrite = false;
+
+    if (from == to)
+        return colorCost(color);
+
+    int cost = 3 + decimalLength(to - from) + colorCost(color);
+    int rewriteCost = 0, rewriteColor = _outputColor;
+    const ScreenCell* cells = _screen.values() + (line - 1) * _width;
+
+    for (int i = from; i < to && rewriteCost < cost; ++i)
+    {
+        if (!charHasUnitWidth(cells[i - 1].ch))
+            return cost;
+
+        if (cells[i - 1].color != rewriteColor)
+        {
+            rewriteColor = cells[i - 1].color;
+            rewriteCost += _colorSequences[rewriteColor].length();
+        }
+
+        rewriteCost += UTF_CHAR_LENGTH(cells[i - 1].ch);
+    }
+
+    if (color >= 0 && color != rewriteColor)
+        rewriteCost += _colorSequences[color].length();
+
+    if (rewriteCost < cost)
+    {
+        rewrite = true;
+        return rewriteCost;
+    }
+
+    return cost;
+}
+
+void Editor::moveForward(int line, int from, int to, bool rewrite)
+{
+    if (from == to)
+        return;
+
+    if (rewrite)
+    {
+        const ScreenCell* cells = _screen.values() + (line - 1) * _width;
+
+        for (int i = from; i < to; ++i)
+        {
+            setOutputColor(cells[i - 1].color);
+            _output += cells[i - 1].ch;
+        }
+    }
+    else
+    {
+        _output += STR("\x1b[");
+        appendDecimal(_output, to - from);
+        _output += 'C';
+    }
+}
+
+void Editor::moveOutputCursor(int line, int column, int color)
+{
+    // choose the shortest of: absolute position, moving forward or back on the
+    // same line, carriage return or new line followed by moving forward
+
+    enum Move { MOVE_POSITION, MOVE_FORWARD, MOVE_BACK, MOVE_RETURN, MOVE_NEW_LINE };
+
+    if (line == _outputLine && column == _outputColumn)
+        return;
+
+    Move move = MOVE_POSITION;
+    int cost = 4 + decimalLength(line) + decimalLength(column) + colorCost(color), c;
+    bool rewrite = false, r;
+
+    if (line == _outputLine)
+    {
+        if (column > _outputColumn)
+        {
+            c = forwardCost(line, _outputColumn, column, color, r);
+
+            if (c < cost)
+            {
+                move = MOVE_FORWARD;
+                cost = c;
+                rewrite = r;
+            }
+        }
+        else
+        {
+            c = 3 + decimalLength(_outputColumn - column) + colorCost(color);
+
+            if (c < cost)
+            {
+                move = MOVE_BACK;
+                cost = c;
+            }
+
+            c = 1 + forwardCost(line, 1, column, color, r);
+
+            if (c < cost)
+            {
+                move = MOVE_RETURN;
+                cost = c;
+                rewrite = r;
+            }
+        }
+    }
+    else if (line == _outputLine + 1 && _outputLine < _height)
+    {
+        c = 2 + forwardCost(line, 1, column, color, r);
+
+        if (c < cost)
+        {
+            move = MOVE_NEW_LINE;
+            cost = c;
+            rewrite = r;
+        }
+    }
+
+    if (move == MOVE_POSITION)
     {
-        if (_currentSuggestion != INVALID_POSITION && !autocomplete)
-            _currentSuggestion = INVALID_POSITION;
-        updateScreen(redrawAll);
+        _output += STR("\x1b[");
+        appendDecimal(_output, line);
+        _output += ';';
+        appendDecimal(_output, column);
+        _output += 'H';
+    }
+    else if (move == MOVE_FORWARD)
+        moveForward(line, _outputColumn, column, rewrite);
+    else if (move == MOVE_BACK)
+    {
+        _output += STR("\x1b[");
+        appendDecimal(_output, _outputColumn - column);
+        _output += 'D';
+    }
+    else
+    {
+        _output += move == MOVE_RETURN ? STR("\r") : STR("\r\n");
+        moveForward(line, 1, column, rewrite);
     }
 
-    if (modified && _document != &_commandLine)
-        updateRecentLocations();
+    _outputLine = line;
+    _outputColumn = column;
 }
 
-void Editor::measureCharSize()
+void Editor::setOutputColor(int color)
 {
-#ifdef GUI_MODE
-    TextBlock textBlock = _graphics->createTextBlock(_guiFontName,
-        _guiFontSize, STR("w"), { _guiFontSize, _guiFontSize });
-    Size size = textBlock.size();
-
-    _charWidth = size.width;
-    _charHeight = size.height;
-    ASSERT(_charWidth > 0 && _charHeight > 0);
-#endif
+    if (color != _outputColor)
+    {
+        ASSERT(color >= 0 && color < _colorSequences.size());
+        _output += _colorSequences[color];
+        _outputColor = color;
+    }
 }
 
-void Editor::computeWidthHeight()
+void Editor::drawOutputRow(int row, int start, int end, bool redraw)
 {
-#ifdef GUI_MODE
-    Size size = _graphics->size();
+    // draws changed cells between start and end, once the rest of the line is erased
+    // any visible cell after it has to be drawn too
 
-    _width = size.width / _charWidth;
-    _height = size.height / _charHeight;
+    static const ScreenCell emptyCell;
 
-    _offsetX = (size.width - _width * _charWidth) / 2;
-    _offsetY = (size.height - _height * _charHeight) / 2;
-#endif
-}
+    const ScreenCell* cells = &_screen[row * _width];
+    const ScreenCell* prevCells = &_prevScreen[row * _width];
+    bool erased = false;
 
-void Editor::setDimensions()
-{
-    if (_width < 2)
-        _width = 2;
+    for (int i = start; i < _width && (i <= end || erased); ++i)
+    {
+        if (erased ? !cellsDiffer(cells[i], emptyCell) : !redraw && !cellsDiffer(cells[i], prevCells[i]))
+            continue;
 
-    if (_height < 2)
-        _height = 2;
+        if (_output.empty())
+            _output += STR("\x1b[?25l");
 
-    _screen.assign(_width * _height, ScreenCell());
-    _commandLine.value.setDimensions(2, _height, _width - 1, 1);
+        if (cells[i].ch)
+        {
+            moveOutputCursor(row + 1, i + 1, cells[i].color);
+            setOutputColor(cells[i].color);
+            _output += cells[i].ch;
 
-    for (auto doc = _documents.first(); doc; doc = doc->next)
-        doc->value.setDimensions(1, 1, _width, _height - 1);
-}
+            if (charHasUnitWidth(cells[i].ch) && i + 1 < _width)
+                ++_outputColumn;
+            else
+                _outputLine = _outputColumn = -1;
+        }
+        else
+        {
+            moveOutputCursor(row + 1, i + 1, _outputColor < 0 ? cells[i].color : -1);
 
-#ifdef GUI_MODE
+            if (_outputColor < 0)
+                setOutputColor(cells[i].color);
 
-Rect Editor::rectFromLineCol(int left, int top, int right, int bottom)
-{
-    return { left * _charWidth + _offsetX, top * _charHeight + _offsetY,
-        right * _charWidth + _offsetX, bottom * _charHeight + _offsetY };
+            _output += STR("\x1b[K");
+            erased = true;
+        }
+    }
 }
 
 #endif
@@ -2927,17 +4080,42 @@ void Editor::updateScreen(bool redrawAll)
 {
     int line, col;
 
-    _prevScreen = _screen;
+    // the previous frame becomes the new one, only the rows that changed
+    // in the previous frame have to be copied over
+
+    swap(_screen, _prevScreen);
+#ifndef GUI_MODE
+    swap(_rowHashes, _prevRowHashes);
+#endif
+
+    for (int j = 0; j < _height; ++j)
+    {
+        if (_dirtyRows[j])
+        {
+            memcpy(&_screen[j * _width], &_prevScreen[j * _width], _width * sizeof(ScreenCell));
+#ifndef GUI_MODE
+            _rowHashes[j] = _prevRowHashes[j];
+#endif
+            _dirtyRows[j] = false;
+        }
+    }
 
     if (_document)
     {
         if (_document == &_commandLine)
-            _screen[(_height - 1) * _width].ch = ':';
+        {
+            if (_screen[(_height - 1) * _width].ch != ':')
+            {
+                _screen[(_height - 1) * _width].ch = ':';
+                _dirtyRows[_height - 1] = true;
+            }
+        }
         else
             updateStatusLine();
 
         Document& doc = _document->value;
-        doc.draw(_width, _screen, _unicodeLimit16);
+        doc.draw(_width, _screen, _dirtyRows, _unicodeLimit16, _document != _drawnDocument);
+        _drawnDocument = _document;
 
         line = doc.line() - doc.top() + doc.y();
         col = doc.column() - doc.left() + doc.x();
@@ -2945,6 +4123,8 @@ void Editor::updateScreen(bool redrawAll)
     else
     {
         _screen.assign(_width * _height, ScreenCell());
+        _dirtyRows.assign(_height, true);
+        _drawnDocument = nullptr;
         updateStatusLine();
         line = col = 1;
     }
@@ -2952,6 +4132,17 @@ void Editor::updateScreen(bool redrawAll)
 #ifdef GUI_MODE
     _graphics->beginDraw();
 #else
+    for (int j = 0; j < _height; ++j)
+    {
+        if (_dirtyRows[j])
+            _rowHashes[j] = hashBytes(&_screen[j * _width], _width * static_cast<int>(sizeof(ScreenCell)));
+    }
+
+    // rows above the status line that moved up or down as a whole are scrolled
+    // by the console, only the rows that it exposes are drawn again
+
+    int scrollBottom = _height - 2;
+    int scrollOffset = redrawAll || scrollBottom < 1 ? 0 : findScrollOffset(0, scrollBottom);
 
 #ifdef PLATFORM_WINDOWS
     HANDLE handle = GetStdHandle(STD_OUTPUT_HANDLE);
@@ -2965,12 +4156,37 @@ void Editor::updateScreen(bool redrawAll)
     size.X = _width;
     size.Y = _height;
 
+    if (scrollOffset != 0)
+    {
+        SMALL_RECT rect;
+        rect.Top = csbi.srWindow.Top;
+        rect.Left = csbi.srWindow.Left;
+        rect.Bottom = rect.Top + scrollBottom;
+        rect.Right = rect.Left + _width - 1;
+
+        COORD pos;
+        pos.X = rect.Left;
+        pos.Y = rect.Top - scrollOffset;
+
+        CHAR_INFO fill;
+        fill.Char.UnicodeChar = ' ';
+        fill.Attributes = defaultBackground() | defaultForeground();
+
+        rc = ScrollConsoleScreenBuffer(handle, &rect, &rect, pos, &fill);
+        ASSERT(rc);
+
+        scrollPrevScreen(0, scrollBottom, scrollOffset);
+    }
+
     if (!redrawAll)
     {
         int changed = 0;
 
         for (int j = 0; j < _height; ++j)
         {
+            if (!_dirtyRows[j])
+                continue;
+
             int jw = j * _width, start = jw, end = start + _width - 1;
 
             while (start <= end && _screen[start] == _prevScreen[start])
@@ -2986,7 +4202,30 @@ void Editor::updateScreen(bool redrawAll)
         redrawAll = changed > 2;
     }
 #else
-    Console::showCursor(false);
+    // the whole frame is collected in _output and written with a single call,
+    // nothing is written when the frame is the same as the previous one
+
+    ConsoleStatistics statistics = Console::statistics();
+    _output.clear();
+
+    if (scrollOffset != 0)
+    {
+        // scrolled in lines take the current background color
+
+        _output += STR("\x1b[?25l");
+
+        if (_outputColor < 0)
+            setOutputColor(defaultForeground());
+
+        _output += STR("\x1b[1;");
+        appendDecimal(_output, scrollBottom + 1);
+        _output += STR("r\x1b[");
+        appendDecimal(_output, abs(scrollOffset));
+        _output += scrollOffset > 0 ? STR("S\x1b[r") : STR("T\x1b[r");
+
+        _outputLine = _outputColumn = -1;
+        scrollPrevScreen(0, scrollBottom, scrollOffset);
+    }
 #endif
 
 #endif
@@ -3038,32 +4277,10 @@ void Editor::updateScreen(bool redrawAll)
         rc = WriteConsoleOutput(handle, reinterpret_cast<CHAR_INFO*>(_screen.values()), size, { 0, 0 }, &rect);
         ASSERT(rc);
 #else
-        for (int j = 0; j < _height; ++j)
-        {
-            int jw = j * _width, start = jw, end = start + _width;
-            int color = -1;
-
-            _output.clear();
-
-            for (int i = start; i < end; ++i)
-            {
-                if (color != _screen[i].color)
-                {
-                    color = _screen[i].color;
-                    _output.appendFormat(STR("\x1b[0;%dm"), color);
-                }
+        _outputLine = _outputColumn = _outputColor = -1;
 
-                if (_screen[i].ch)
-                    _output += _screen[i].ch;
-                else
-                {
-                    _output += STR("\x1b[K");
-                    break;
-                }
-            }
-
-            Console::write(j + 1, 1, _output);
-        }
+        for (int j = 0; j < _height; ++j)
+            drawOutputRow(j, 0, _width - 1, true);
 #endif
 
 #endif
@@ -3072,10 +4289,10 @@ void Editor::updateScreen(bool redrawAll)
     {
         for (int j = 0; j < _height; ++j)
         {
-            int jw = j * _width, start = jw, end = start + _width - 1;
-            int color = -1;
+            if (!_dirtyRows[j])
+                continue;
 
-            _output.clear();
+            int jw = j * _width, start = jw, end = start + _width - 1;
 
             while (start <= end && _screen[start] == _prevScreen[start])
                 ++start;
@@ -3086,7 +4303,8 @@ void Editor::updateScreen(bool redrawAll)
             if (start <= end)
             {
 #ifdef GUI_MODE
-                int ii = start - jw;
+                int color = -1, ii = start - jw;
+                _output.clear();
 
                 Rect rect = rectFromLineCol(start - jw, j, end - jw + 1, j + 1);
                 _graphics->fillRectangle(rect, GUI_BACKGROUND);
@@ -3127,24 +4345,7 @@ void Editor::updateScreen(bool redrawAll)
                 rc = WriteConsoleOutput(handle, reinterpret_cast<CHAR_INFO*>(_screen.values()), size, pos, &rect);
                 ASSERT(rc);
 #else
-                for (int i = start; i <= end; ++i)
-                {
-                    if (color != _screen[i].color)
-                    {
-                        color = _screen[i].color;
-                        _output.appendFormat(STR("\x1b[0;%dm"), color);
-                    }
-
-                    if (_screen[i].ch)
-                        _output += _screen[i].ch;
-                    else
-                    {
-                        _output += STR("\x1b[K");
-                        break;
-                    }
-                }
-
-                Console::write(j + 1, start - jw + 1, _output);
+                drawOutputRow(j, start - jw, end - jw, false);
 #endif
 
 #endif
@@ -3166,11 +4367,68 @@ void Editor::updateScreen(bool redrawAll)
 #ifdef PLATFORM_WINDOWS
     Console::setCursorPosition(line, col);
 #else
-    Console::setCursorPosition(line, col);
-    Console::showCursor(true);
+    bool drawn = !_output.empty();
+    moveOutputCursor(line, col, -1);
+
+    if (drawn)
+        _output += STR("\x1b[?25h");
+
+    if (!_output.empty())
+        Console::write(_output);
+
+    _frameBytes = Console::statistics().bytes - statistics.bytes;
+    _frameWrites = Console::statistics().writes - statistics.writes;
+    _totalFrameBytes += _frameBytes;
+    ++_frames;
 #endif
 
 #endif
+
+    // time from the input that caused the frame until the frame was drawn
+
+    _frameTime = Timer::ticks();
+
+    if (_updatePending)
+    {
+        int64_t latency = (_frameTime - _inputTime) / 1000;
+        int bucket = 0;
+
+        while (bucket < LATENCY_BUCKETS - 1 && latency >= (1 << bucket))
+            ++bucket;
+
+        ++_latencies[bucket];
+        _updatePending = _redrawPending = false;
+    }
+}
+
+void Editor::scheduleUpdate(bool redrawAll, int64_t inputTime)
+{
+    if (!_updatePending)
+    {
+        _updatePending = true;
+        _inputTime = inputTime;
+    }
+
+    _redrawPending = _redrawPending || redrawAll;
+
+#ifndef GUI_MODE
+    // a frame drawn while more input is waiting would be replaced before anyone sees it,
+    // so it is postponed until the input stops, the next frame is due by the frame rate
+    // limit or the oldest input has waited for too long
+
+    int64_t time = Timer::ticks();
+
+    if (time - _inputTime < MAX_FRAME_DELAY)
+    {
+        int64_t wait = _frameRate > 0 ? _frameTime + 1000000 / _frameRate - time : 0;
+        wait = min(wait, _inputTime + MAX_FRAME_DELAY - time);
+
+        if (Console::waitForInput(wait > 0 ? static_cast<int>((wait + 999) / 1000) : 0))
+            return;
+    }
+#endif
+
+    updateScreen(_redrawPending);
 }
 
 void Editor::updateStatusLine()
@@ -3246,6 +4504,11 @@ void Editor::updateStatusLine()
                 _screen[p++].ch = _status.charAt(i);
         }
     }
+
+    int row = (_height - 1) * _width;
+
+    if (memcmp(&_screen[row], &_prevScreen[row], _width * sizeof(ScreenCell)) != 0)
+        _dirtyRows[_height - 1] = true;
 }
 
 void Editor::showCommandLine()
@@ -3296,6 +4559,16 @@ bool Editor::executeCommand(const String& command)
         _trimWhitespace = false;
         return true;
     }
+    else if (command == STR("mem"))
+    {
+        showMemoryStatistics();
+        return true;
+    }
+    else if (command == STR("perf"))
+    {
+        showFrameStatistics();
+        return true;
+    }
 
     int p = 0;
     unichar_t ch = command.charAt(p);
@@ -3321,7 +4594,8 @@ bool Editor::executeCommand(const String& command)
         if (p < command.length())
         {
             _searchStr = command.substr(p);
-            _document->value.find(_searchStr, _caseSesitive, false);
+            _searcher.assign(_searchStr, _caseSesitive);
+            _document->value.find(_searcher, false);
         }
         else
             throw Exception(STR("invalid command"));
@@ -3361,17 +4635,19 @@ bool Editor::executeCommand(const String& command)
                 _replaceStr = command.substr(q + 1);
             }
 
+            _searcher.assign(_searchStr, _caseSesitive);
+
             if (replaceScope == 'd')
             {
-                _document->value.replaceAll(_searchStr, _replaceStr, _caseSesitive);
+                _document->value.replaceAll(_searcher, _replaceStr);
             }
             else if (replaceScope == 'a')
             {
                 for (auto doc = _documents.first(); doc; doc = doc->next)
-                    doc->value.replaceAll(_searchStr, _replaceStr, _caseSesitive);
+                    doc->value.replaceAll(_searcher, _replaceStr);
             }
             else
-                _document->value.find(_searchStr, _caseSesitive, false);
+                _document->value.find(_searcher, false);
         }
         else
             throw Exception(STR("invalid command"));
@@ -3430,6 +4706,108 @@ bool Editor::executeCommand(const String& command)
     return true;
 }
 
+#ifdef MEMORY_STATISTICS
+
+String formatMemorySize(int64_t bytes)
+{
+    if (bytes >= 1024 * 1024)
+        return String::format(STR("%.1f MB"), bytes / (1024.0 * 1024.0));
+    else if (bytes >= 1024)
+        return String::format(STR("%.1f KB"), bytes / 1024.0);
+    else
+        return String::format(STR("%d B"), static_cast<int>(bytes));
+}
+
+void appendAscii(String& str, const char* chars, int len)
+{
+    for (int i = 0; i < len && chars[i]; ++i)
+        str.append(static_cast<unichar_t>(chars[i]), 1);
+}
+
+#endif
+
+void Editor::showMemoryStatistics()
+{
+#ifdef MEMORY_STATISTICS
+    // totals followed by the sites holding the most memory, as many as fit on the status line
+
+    const int MAX_SITES = 8;
+
+    MemoryStatistics statistics = Memory::statistics();
+    MemorySite sites[MAX_SITES];
+    int numSites = Memory::sites(sites, MAX_SITES);
+
+    _message = String::format(STR("%lld allocations, "), static_cast<long long>(statistics.allocations));
+    _message += formatMemorySize(statistics.bytes);
+    _message += STR(" (peak ");
+    _message += formatMemorySize(statistics.peakBytes);
+    _message += STR(")");
+
+    for (int i = 0; i < numSites; ++i)
+    {
+        const MemorySite& site = sites[i];
+
+        _message += STR(", ");
+
+        // the scope tells which editor operation the container growth belongs to
+        if (site.scope)
+        {
+            appendAscii(_message, site.scope, INT_MAX);
+            _message += STR(": ");
+        }
+
+        appendAscii(_message, site.function, INT_MAX);
+
+        // template functions already include the type in their name
+        if (!strchr(site.function, '<'))
+        {
+            _message += STR("<");
+            appendAscii(_message, site.type, site.typeLength);
+            _message += STR(">");
+        }
+
+        const char* file = site.file;
+        for (const char* p = site.file; *p; ++p)
+        {
+            if (*p == '/' || *p == '\\')
+                file = p + 1;
+        }
+
+        _message += STR(" (");
+        appendAscii(_message, file, INT_MAX);
+        _message += String::format(STR(":%d) "), site.line);
+        _message += formatMemorySize(site.bytes);
+    }
+#else
+    throw Exception(STR("memory statistics are not available, build with MEMORY_STATISTICS=1"));
+#endif
+}
+
+void Editor::showFrameStatistics()
+{
+#if defined(GUI_MODE) || defined(PLATFORM_WINDOWS)
+    _message = STR("input to paint:");
+#else
+    _message = String::format(STR("last frame: %lld bytes, %lld writes, %lld frames: %lld bytes per frame"),
+        static_cast<long long>(_frameBytes), static_cast<long long>(_frameWrites), static_cast<long long>(_frames),
+        static_cast<long long>(_frames > 0 ? _totalFrameBytes / _frames : 0));
+    _message += STR(", input to paint:");
+#endif
+
+    // frames per bucket of input to paint latency, each bucket twice as long as the previous one
+
+    for (int i = 0; i < LATENCY_BUCKETS; ++i)
+    {
+        if (_latencies[i] > 0)
+        {
+            if (i < LATENCY_BUCKETS - 1)
+                _message.appendFormat(STR(" <%d ms %lld"), 1 << i, static_cast<long long>(_latencies[i]));
+            else
+                _message.appendFormat(STR(" >=%d ms %lld"), 1 << (i - 1), static_cast<long long>(_latencies[i]));
+        }
+    }
+}
+
 void Editor::executeProjectCommand(const String& command)
 {
     saveAllDocuments();
@@ -3523,60 +4901,21 @@ bool Editor::moveToPrevRecentLocation()
     return false;
 }
 
-void Editor::findUniqueWords()
+void Editor::updateUniqueWords()
 {
-    Map<String, int> words;
+    if (_projectIndex.ptr())
+        _projectIndex->mergeWords(_uniqueWords);
 
     for (auto doc = _documents.first(); doc; doc = doc->next)
-    {
-        const String& text = doc->value.text();
-        String word;
-
-        for (int p = 0; p < text.length(); p = text.charForward(p))
-        {
-            unichar_t ch = text.charAt(p);
-
-            if (charIsWord(ch))
-                word += ch;
-            else if (!word.empty())
-            {
-                ++words[word];
-                word.clear();
-            }
-        }
-
-        if (!word.empty())
-            ++words[word];
-    }
-
-    auto it = _uniqueWords.constIterator();
-    while (it.moveNext())
-    {
-        if (it.value().value == INT_MAX)
-        {
-            int* value = words.find(it.value().key);
-            if (value)
-                *value = INT_MAX;
-        }
-    }
-
-    swap(words, _uniqueWords);
+        doc->value.mergeWordChanges(_uniqueWords);
 }
 
 void Editor::prepareSuggestions(const String& prefix)
 {
     ASSERT(!prefix.empty());
 
-    _suggestions.clear();
-
-    auto it = _uniqueWords.constIterator();
-    while (it.moveNext())
-    {
-        if (it.value().key.startsWith(prefix))
-            _suggestions.addLast(AutocompleteSuggestion(it.value().key, it.value().value));
-    }
-
-    _suggestions.sort();
+    updateUniqueWords();
+    _uniqueWords.findWords(prefix, MAX_AUTOCOMPLETE_SUGGESTIONS, _suggestions);
 }
 
 bool Editor::completeWord(int next)
@@ -3712,6 +5051,19 @@ void Editor::readConfigFile(const String& filename)
                     _trimWhitespace = value.compare(STR("true"), false) == 0;
                 else if (name == STR("indent_size"))
                     _indentSize = value.toInt();
+                else if (name == STR("undo_limit"))
+                {
+                    // in megabytes, kept small enough for the size in bytes to fit an int
+                    int limit = value.toInt();
+                    if (limit > 0)
+                        _undoLimit = min(limit, MAX_UNDO_LIMIT) * 1024 * 1024;
+                }
+                else if (name == STR("frame_rate"))
+                    _frameRate = value.toInt();
+                else if (name == STR("atomic_save"))
+                    _atomicSave = value.compare(STR("true"), false) == 0;
+                else if (name == STR("index_project"))
+                    _indexProject = value.compare(STR("true"), false) == 0;
                 else if (name == STR("gui_columns"))
                     _width = value.toInt();
                 else if (name == STR("gui_lines"))
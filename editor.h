@@ -4,6 +4,7 @@
 #include <foundation.h>
 #include <application.h>
 #include <file.h>
+#include <highlighter.h>
 
 #ifdef GUI_MODE
 #include <graphics.h>
@@ -24,136 +25,82 @@ struct ScreenCell
     }
 };
 
-// DocumentType
+// EditRecord
 
-enum DocumentType
+struct EditRecord
 {
-    DOCUMENT_TYPE_TEXT,
-    DOCUMENT_TYPE_CPP,
-    DOCUMENT_TYPE_SHELL,
-    DOCUMENT_TYPE_BATCH,
-    DOCUMENT_TYPE_POWERSHELL,
-    DOCUMENT_TYPE_XML,
-    DOCUMENT_TYPE_HTML,
-    DOCUMENT_TYPE_PYTHON,
-    DOCUMENT_TYPE_JAVASCRIPT
-};
-
-// HighlightingType
+    int group;
+    int position;
+    String erased;
+    String inserted;
 
-enum HighlightingType
-{
-    HIGHLIGHTING_TYPE_NONE,
-    HIGHLIGHTING_TYPE_STRING,
-    HIGHLIGHTING_TYPE_NUMBER,
-    HIGHLIGHTING_TYPE_IDENT,
-    HIGHLIGHTING_TYPE_KEYWORD,
-    HIGHLIGHTING_TYPE_TYPE,
-    HIGHLIGHTING_TYPE_SINGLELINE_COMMENT,
-    HIGHLIGHTING_TYPE_MULTILINE_COMMENT,
-    HIGHLIGHTING_TYPE_PREPROCESSOR,
-    HIGHLIGHTING_TYPE_VARIABLE,
-    HIGHLIGHTING_TYPE_VARIABLE_REF,
-    HIGHLIGHTING_TYPE_TAG,
-    HIGHLIGHTING_TYPE_ATTRIBUTE,
-    HIGHLIGHTING_TYPE_ATTRIBUTE_EQUAL,
-    HIGHLIGHTING_TYPE_ATTRIBUTE_VALUE
+    EditRecord(int group, int position, const String& erased, const String& inserted) :
+        group(group), position(position), erased(erased), inserted(inserted)
+    {
+    }
 };
 
-// HighlightingState
-
-struct HighlightingState
-{
-    HighlightingType highlightingType = HIGHLIGHTING_TYPE_NONE;
-    int charsRemaining = 0;
-    bool reset = false;
-    unichar_t startCh = 0, prevCh = 0;
-    String word;
-};
+// DocumentDecoder
 
-// SyntaxHighlighter
+// decodes the text of a large file on a worker thread while the document shows
+// the part that was decoded first
 
-class SyntaxHighlighter
+class DocumentDecoder
 {
 public:
-    SyntaxHighlighter(DocumentType documentType = DOCUMENT_TYPE_TEXT) : _documentType(documentType)
-    {
-    }
+    DocumentDecoder(const String& filename);
 
-    virtual ~SyntaxHighlighter()
-    {
-    }
+    DocumentDecoder(const DocumentDecoder&) = delete;
+    DocumentDecoder& operator=(const DocumentDecoder&) = delete;
 
-    DocumentType documentType() const
+    const FileMapping& mapping() const
     {
-        return _documentType;
+        return _mapping;
     }
 
-    const HighlightingState& highlightingState() const
-    {
-        return _highlightingState;
-    }
-
-    HighlightingState& highlightingState()
-    {
-        return _highlightingState;
-    }
-
-    virtual void highlightChar(const String& text, int pos) = 0;
+    void start();
+    bool finished();
+    String finish(TextEncoding& encoding, bool& bom, bool& crLf);
 
 protected:
-    DocumentType _documentType;
-    HighlightingState _highlightingState;
-};
+    static void decodeProc(void* param);
 
-// CppSyntaxHighlighter
-
-class CppSyntaxHighlighter : public SyntaxHighlighter
-{
-public:
-    CppSyntaxHighlighter();
-    void highlightChar(const String& text, int pos) override;
-
-protected:
-    Set<String> _keywords;
-    Set<String> _types;
-    Set<String> _preprocessor;
-};
-
-// ShellSyntaxHighlighter
-
-class ShellSyntaxHighlighter : public SyntaxHighlighter
-{
-public:
-    ShellSyntaxHighlighter();
-    void highlightChar(const String& text, int pos) override;
+    void decode();
 
 protected:
-    Set<String> _keywords;
-};
+    File _file;
+    FileMapping _mapping;
 
-// XmlSyntaxHighlighter
-
-class XmlSyntaxHighlighter : public SyntaxHighlighter
-{
-public:
-    XmlSyntaxHighlighter() : SyntaxHighlighter(DOCUMENT_TYPE_XML)
-    {
-    }
+    Mutex _mutex;
+    bool _finished;
+    String _text;
+    TextEncoding _encoding;
+    bool _bom;
+    bool _crLf;
+    const char_t* _error;
 
-    void highlightChar(const String& text, int pos) override;
+    // declared last so that the thread is joined before the file is unmapped
+    Thread _thread;
 };
 
 // Document
 
 class Editor;
+class WordIndex;
 
 class Document
 {
 public:
     Document(Editor* editor);
 
-    const String& text() const
+    Document(const Document&) = delete;
+    Document(Document&& other) = default;
+
+    // assigning would replace the edit record pool while the old records are still in it
+    Document& operator=(const Document&) = delete;
+    Document& operator=(Document&& other) = delete;
+
+    const TextBuffer& text() const
     {
         return _text;
     }
@@ -168,6 +115,16 @@ public:
         return _modified;
     }
 
+    bool decoding() const
+    {
+        return _decoder.ptr() != nullptr;
+    }
+
+    const FlatMap<String, int>& words() const
+    {
+        return _words;
+    }
+
     void filename(const String& filename)
     {
         ASSERT(!filename.empty());
@@ -281,24 +238,45 @@ public:
     String autocompletePrefix() const;
     void completeWord(const char_t* suffix);
 
-    bool find(const String& searchStr, bool caseSesitive, bool next);
-    bool replace(const String& searchStr, const String& replaceStr, bool caseSesitive);
-    bool replaceAll(const String& searchStr, const String& replaceStr, bool caseSesitive);
+    bool find(const Searcher& searcher, bool next);
+    bool replace(const Searcher& searcher, const String& replaceStr);
+    bool replaceAll(const Searcher& searcher, const String& replaceStr);
 
-    void open(const String& filename);
+    void open(const String& filename, bool decodeInBackground = false);
+    bool finishDecoding(bool wait);
     void save();
     void clear();
     void trimTrailingWhitespace();
 
+    bool undo();
+    bool redo();
+
+    void mergeWordChanges(WordIndex& words);
+
     void setDimensions(int x, int y, int width, int height);
-    void draw(int screenWidth, Buffer<ScreenCell>& screen, bool unicodeLimit16);
+    void draw(int screenWidth, Buffer<ScreenCell>& screen, Buffer<bool>& dirtyRows, bool unicodeLimit16,
+        bool redraw);
 
 protected:
+    void insertText(int pos, const String& str);
+    void insertText(int pos, const char_t* chars);
+    void insertText(int pos, unichar_t ch, int n = 1);
+    void eraseText(int pos, int len);
+    void replaceText(int pos, const String& str, int len);
+    void replaceText(int pos, const char_t* chars, int len);
+    void invalidateHighlighting(int pos);
+    void indexWords(int pos, int len, int count);
+
+    void startUndoGroup(bool coalesce = false);
+    void recordEdit(int pos, const String& erased, const String& inserted);
+    void clearUndo();
+    void markUnmodified();
+    int lastUndoGroup() const;
+
     void setPositionLineColumn(int pos);
     void positionToLineColumn(int startPos, int startLine, int startColumn, int newPos, int& line, int& column);
 
-    void lineColumnToPosition(int startPos, int startLine, int startColumn, int newLine, int newColumn, int& pos,
-                              int& line, int& column);
+    void lineColumnToPosition(int newLine, int newColumn, int& pos, int& line, int& column);
 
     int findLineStart(int pos) const;
     int findLineEnd(int pos) const;
@@ -310,7 +288,7 @@ protected:
     int findCharsForward(int pos) const;
     int findCharsBack(int pos) const;
 
-    int findPosition(int pos, const String& searchStr, bool caseSesitive, bool next) const;
+    int findPosition(int pos, const Searcher& searcher, bool next) const;
 
     void changeLines(int (Document::*lineOp)(int));
 
@@ -324,7 +302,7 @@ protected:
 protected:
     Editor* _editor;
 
-    String _text;
+    TextBuffer _text;
     int _position;
     bool _modified;
 
@@ -343,11 +321,36 @@ protected:
     int _x, _y;
     int _width, _height;
 
+    // text changes and the state of the last draw, used to skip drawing when
+    // the screen already shows the document
+    int _changes;
+    int _drawnChanges, _drawnTopPosition, _drawnLeft;
+
     int _selection;
     bool _selectionMode;
 
     String _indent;
     HighlightingState _highlightingState;
+    Array<HighlightingState> _highlightingCheckpoints;
+
+    // edit records come from a per document pool, it is declared before the lists
+    // so that it outlives them
+    Unique<List<EditRecord>::Pool> _editRecordPool;
+    List<EditRecord> _undoRecords;
+    List<EditRecord> _redoRecords;
+    int _undoGroup;
+    bool _coalesceUndo;
+    int _undoSize;
+
+    // the text is unmodified when the last applied group is the one applied when it was
+    // opened or saved, -1 if never, an empty history stands for the last dropped group
+    int _savedUndoGroup;
+    int _droppedUndoGroup;
+
+    FlatMap<String, int> _words;
+    FlatMap<String, int> _wordChanges;
+
+    Unique<DocumentDecoder> _decoder;
 };
 
 // RecentLocation
@@ -390,6 +393,132 @@ struct AutocompleteSuggestion
     }
 };
 
+// WordIndex
+
+struct WordIndexNode
+{
+    char_t ch;
+    bool preferred;
+    int count;
+    int best;
+    int parent;
+    int firstChild;
+    int nextSibling;
+};
+
+class WordIndex
+{
+public:
+    WordIndex();
+
+    void add(const String& word, int count);
+    void prefer(const String& word);
+    void clear();
+
+    void findWords(const String& prefix, int maxWords, Array<AutocompleteSuggestion>& words) const;
+
+protected:
+    int findNode(const String& word) const;
+    int findChild(int node, char_t ch) const;
+    int addChild(int node, char_t ch);
+    void removeChild(int node, int child);
+    int rank(int node) const;
+    void update(int node);
+    String word(int node) const;
+
+protected:
+    Array<WordIndexNode> _nodes;
+    Array<int> _freeNodes;
+};
+
+// ProjectIndex
+
+struct ProjectFile
+{
+    String path;
+    int64_t size;
+    int64_t modified;
+    ByteBuffer words;
+};
+
+class ProjectIndex
+{
+public:
+    ProjectIndex(const String& filename);
+
+    ProjectIndex(const ProjectIndex&) = delete;
+    ProjectIndex& operator=(const ProjectIndex&) = delete;
+
+    ~ProjectIndex();
+
+    void start(WordIndex& words);
+    void mergeWords(WordIndex& words);
+
+protected:
+    static void updateProc(void* param);
+
+    void load(FlatMap<String, int>& words);
+    void save(const FlatMap<String, int>& words);
+    void update();
+    void indexDirectory(const String& path, FlatMap<String, int>& fileIndex, Array<ProjectFile>& files);
+    bool cancelled();
+
+protected:
+    String _filename;
+    bool _loaded;
+    Array<ProjectFile> _files;
+    FlatMap<String, int> _wordChanges;
+
+    Mutex _mutex;
+    bool _finished;
+    bool _cancelled;
+    Thread _thread;
+};
+
+// DocumentLoader
+
+enum LoadState
+{
+    LOAD_STATE_PENDING,
+    LOAD_STATE_LOADED,
+    LOAD_STATE_FAILED
+};
+
+class DocumentLoader
+{
+public:
+    DocumentLoader(Editor* editor, const Array<String>& filenames);
+
+    DocumentLoader(const DocumentLoader&) = delete;
+    DocumentLoader& operator=(const DocumentLoader&) = delete;
+
+    ~DocumentLoader();
+
+    bool finished() const
+    {
+        return _nextDocument == _documents.size();
+    }
+
+    void moveDocuments(List<Document>& documents, String& message);
+
+protected:
+    static void loadProc(void* param);
+
+    void load();
+
+protected:
+    Array<String> _filenames;
+    Array<Unique<Document>> _documents;
+    Array<LoadState> _states;
+    Array<String> _errors;
+    int _nextDocument;
+
+    Mutex _mutex;
+    int _nextFile;
+    bool _cancelled;
+    Array<Unique<Thread>> _threads;
+};
+
 // Editor
 
 class Editor : public Application
@@ -414,10 +543,22 @@ public:
         return _indentSize;
     }
 
+    int undoLimit() const
+    {
+        return _undoLimit;
+    }
+
+    bool atomicSave() const
+    {
+        return _atomicSave;
+    }
+
     SyntaxHighlighter* syntaxHighlighter(DocumentType documentType);
 
     void newDocument(const String& filename);
     void openDocument(const String& filename);
+    void addLoadedDocuments();
+    bool finishDecodingDocuments(bool wait);
     void saveDocument();
     void saveAllDocuments();
     void closeDocument();
@@ -439,19 +580,37 @@ protected:
     Rect rectFromLineCol(int left, int top, int right, int bottom);
 #endif
 
+#ifndef GUI_MODE
+    int findScrollOffset(int top, int bottom) const;
+    void scrollPrevScreen(int top, int bottom, int offset);
+    void scrollPrevRow(int row, int fromRow);
+#endif
+
+#if !defined(GUI_MODE) && !defined(PLATFORM_WINDOWS)
+    int colorCost(int color) const;
+    int forwardCost(int line, int from, int to, int color, bool& rewrite) const;
+    void moveForward(int line, int from, int to, bool rewrite);
+    void moveOutputCursor(int line, int column, int color);
+    void setOutputColor(int color);
+    void drawOutputRow(int row, int start, int end, bool redraw);
+#endif
+
     void drawBlockCursor(bool on);
     void updateScreen(bool redrawAll);
+    void scheduleUpdate(bool redrawAll, int64_t inputTime);
     void updateStatusLine();
 
     void showCommandLine();
     bool executeCommand(const String& command);
     void executeProjectCommand(const String& command);
+    void showMemoryStatistics();
+    void showFrameStatistics();
 
     void updateRecentLocations();
     bool moveToNextRecentLocation();
     bool moveToPrevRecentLocation();
 
-    void findUniqueWords();
+    void updateUniqueWords();
     void prepareSuggestions(const String& prefix);
     bool completeWord(int next);
 
@@ -465,6 +624,8 @@ protected:
     ListNode<Document> _commandLine;
     ListNode<Document>* _document;
     ListNode<Document>* _lastDocument;
+    ListNode<Document>* _drawnDocument;
+    Unique<DocumentLoader> _documentLoader;
 
     bool _recordingMacro;
     Array<InputEvent> _macro;
@@ -477,7 +638,28 @@ protected:
 
     Buffer<ScreenCell> _screen;
     Buffer<ScreenCell> _prevScreen;
+    Buffer<bool> _dirtyRows;
+
+#ifndef GUI_MODE
+    Buffer<int> _rowHashes;
+    Buffer<int> _prevRowHashes;
+    int _emptyRowHash;
+#endif
+
     String _output;
+    int64_t _frameBytes, _frameWrites;
+    int64_t _frames, _totalFrameBytes;
+
+    static const int LATENCY_BUCKETS = 9;
+
+    bool _updatePending, _redrawPending;
+    int64_t _inputTime, _frameTime;
+    int64_t _latencies[LATENCY_BUCKETS];
+
+#if !defined(GUI_MODE) && !defined(PLATFORM_WINDOWS)
+    int _outputLine, _outputColumn, _outputColor;
+    Array<String> _colorSequences;
+#endif
 
 #ifdef GUI_MODE
     Unique<Graphics> _graphics;
@@ -488,11 +670,13 @@ protected:
     String _buffer;
     String _searchStr, _replaceStr;
     bool _caseSesitive;
+    Searcher _searcher;
 
     List<RecentLocation> _recentLocations;
     ListNode<RecentLocation>* _recentLocation;
 
-    Map<String, int> _uniqueWords;
+    WordIndex _uniqueWords;
+    Unique<ProjectIndex> _projectIndex;
     Array<AutocompleteSuggestion> _suggestions;
     int _currentSuggestion;
 
@@ -501,6 +685,10 @@ protected:
     bool _brightBackground = true;
     bool _trimWhitespace = true;
     int _indentSize = 4;
+    int _undoLimit = 64 * 1024 * 1024;
+    int _frameRate = 60;
+    bool _atomicSave = false;
+    bool _indexProject = false;
     float _guiFontSize = 13;
     String _guiFontName = STR("Lucida Console");
     bool _startMaximized = false;
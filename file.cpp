@@ -268,6 +268,72 @@ void File::write(int size, const void* data)
         throw Exception(STR("failed to write file"));
 }
 
+void File::writeText(const TextBuffer& text, TextEncoding encoding, bool bom, bool crLf)
+{
+    const int BUFFER_SIZE = 65536;
+
+    ByteBuffer buffer(BUFFER_SIZE);
+    int size = bom ? Unicode::byteOrderMark(encoding, buffer.values()) : 0;
+
+#ifdef CHAR_ENCODING_UTF8
+    if (encoding == TEXT_ENCODING_UTF8 && !crLf)
+    {
+        if (size > 0)
+            write(size, buffer.values());
+
+        int pos = 0, len;
+
+        while (pos < text.length())
+        {
+            const char_t* chars = text.chunk(pos, len);
+            write(len, chars);
+            pos += len;
+        }
+
+        return;
+    }
+#endif
+
+    int pos = 0, len;
+
+    while (pos < text.length())
+    {
+        const char_t* chars = text.chunk(pos, len);
+        const char_t* end = chars + len;
+
+        pos += len;
+
+        while (chars < end)
+        {
+            size += Unicode::charsToBytes(chars, end, encoding, crLf, buffer.values() + size, BUFFER_SIZE - size);
+
+            if (chars < end)
+            {
+                write(size, buffer.values());
+                size = 0;
+            }
+        }
+    }
+
+    if (size > 0)
+        write(size, buffer.values());
+}
+
+void File::flush()
+{
+    if (_handle == INVALID_HANDLE_VALUE)
+        throw Exception(STR("file not open"));
+
+#ifdef PLATFORM_WINDOWS
+    BOOL rc = FlushFileBuffers(_handle);
+    if (!rc)
+#else
+    int rc = fsync(_handle);
+    if (rc != 0)
+#endif
+        throw Exception(STR("failed to flush file"));
+}
+
 bool File::exists(const String& filename)
 {
 #ifdef PLATFORM_WINDOWS
@@ -288,3 +354,251 @@ void File::remove(const String& filename)
 #endif
         throw Exception(STR("failed to delete file"));
 }
+
+void File::replace(const String& filename, const String& newFilename)
+{
+#ifdef PLATFORM_WINDOWS
+    BOOL rc = MoveFileEx(reinterpret_cast<LPCTSTR>(newFilename.chars()), reinterpret_cast<LPCTSTR>(filename.chars()),
+                         MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+    if (!rc)
+#else
+    struct stat st;
+
+    if (stat(filename.chars(), &st) == 0)
+    {
+        // ownership goes first, changing it clears the set-user-ID and set-group-ID bits
+
+        if (chown(newFilename.chars(), st.st_uid, st.st_gid) != 0 ||
+            chmod(newFilename.chars(), st.st_mode & 07777) != 0)
+            throw Exception(STR("failed to replace file"));
+    }
+
+    int rc = rename(newFilename.chars(), filename.chars());
+    if (rc != 0)
+#endif
+        throw Exception(STR("failed to replace file"));
+
+#ifndef PLATFORM_WINDOWS
+    // the new directory entry survives a crash only after the directory is flushed,
+    // some file systems can't flush directories and return EINVAL
+
+    const char_t* chars = filename.chars();
+    const char_t* slash = strrchr(chars, '/');
+    String path = slash ? String(chars, slash > chars ? static_cast<int>(slash - chars) : 1) : String(STR("."));
+
+    int dir = ::open(path.chars(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (dir >= 0)
+    {
+        rc = fsync(dir);
+        int error = errno;
+        ::close(dir);
+
+        if (rc != 0 && error != EINVAL)
+            throw Exception(STR("failed to flush directory"));
+    }
+#endif
+}
+
+bool File::canReplace(const String& filename)
+{
+    // a file with other hard links or one that replace() can't give the same
+    // owner and group has to be written in place
+
+#ifdef PLATFORM_WINDOWS
+    return true;
+#else
+    struct stat st;
+
+    if (stat(filename.chars(), &st) != 0)
+        return errno == ENOENT;
+
+    if (st.st_nlink > 1)
+        return false;
+
+    uid_t uid = geteuid();
+
+    if (uid == 0)
+        return true;
+
+    if (st.st_uid != uid)
+        return false;
+
+    if (st.st_gid == getegid())
+        return true;
+
+    int numGroups = getgroups(0, nullptr);
+    if (numGroups <= 0)
+        return false;
+
+    Buffer<gid_t> groups(numGroups);
+    numGroups = getgroups(numGroups, groups.values());
+
+    for (int i = 0; i < numGroups; ++i)
+    {
+        if (groups[i] == st.st_gid)
+            return true;
+    }
+
+    return false;
+#endif
+}
+
+String File::resolvePath(const String& filename)
+{
+    // a symbolic link is replaced by the file it points to, a file that doesn't exist is kept as is
+
+#ifdef PLATFORM_WINDOWS
+    return filename;
+#else
+    char* path = realpath(filename.chars(), nullptr);
+
+    if (!path)
+        return filename;
+
+    String resolved(static_cast<const char_t*>(path));
+    free(path);
+
+    return resolved;
+#endif
+}
+
+// FileMapping
+
+FileMapping::FileMapping(const File& file) :
+#ifdef PLATFORM_WINDOWS
+    _mapping(nullptr),
+#endif
+    _data(nullptr), _size(file.size())
+{
+    if (_size > 0)
+    {
+#ifdef PLATFORM_WINDOWS
+        _mapping = CreateFileMapping(file._handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!_mapping)
+            throw Exception(STR("failed to map file"));
+
+        _data = reinterpret_cast<const byte_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!_data)
+        {
+            CloseHandle(_mapping);
+            throw Exception(STR("failed to map file"));
+        }
+#else
+        void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, file._handle, 0);
+        if (data == MAP_FAILED)
+            throw Exception(STR("failed to map file"));
+
+        madvise(data, _size, MADV_SEQUENTIAL);
+        _data = reinterpret_cast<const byte_t*>(data);
+#endif
+    }
+}
+
+FileMapping::~FileMapping()
+{
+    try
+    {
+        unmap();
+    }
+    catch (Exception& ex)
+    {
+        reportError(ex.message());
+    }
+    catch (...)
+    {
+        reportError(STR("unknown error"));
+    }
+}
+
+void FileMapping::unmap()
+{
+    if (_data)
+    {
+#ifdef PLATFORM_WINDOWS
+        BOOL rc = UnmapViewOfFile(_data);
+        ASSERT(rc);
+        rc = CloseHandle(_mapping);
+        ASSERT(rc);
+#else
+        int rc = munmap(const_cast<byte_t*>(_data), _size);
+        ASSERT(rc == 0);
+#endif
+        _data = nullptr;
+    }
+}
+
+// Directory
+
+bool Directory::exists(const String& path)
+{
+#ifdef PLATFORM_WINDOWS
+    DWORD attributes = GetFileAttributes(reinterpret_cast<LPCTSTR>(path.chars()));
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+    struct stat st;
+    return stat(path.chars(), &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
+
+Array<DirectoryEntry> Directory::entries(const String& path)
+{
+    Array<DirectoryEntry> entries;
+
+#ifdef PLATFORM_WINDOWS
+    WIN32_FIND_DATA data;
+    String pattern = path + STR("\\*");
+
+    HANDLE handle = FindFirstFile(reinterpret_cast<LPCTSTR>(pattern.chars()), &data);
+    if (handle == INVALID_HANDLE_VALUE)
+        throw Exception(STR("failed to read directory"));
+
+    do
+    {
+        String name(reinterpret_cast<const char_t*>(data.cFileName));
+
+        if (name != STR(".") && name != STR("..") && (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0)
+        {
+            DirectoryEntry entry;
+            entry.name = name;
+            entry.directory = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+            entry.size = (static_cast<int64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+            entry.modified = (static_cast<int64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+                data.ftLastWriteTime.dwLowDateTime;
+            entries.addLast(entry);
+        }
+    }
+    while (FindNextFile(handle, &data));
+
+    FindClose(handle);
+#else
+    DIR* dir = opendir(path.chars());
+    if (!dir)
+        throw Exception(STR("failed to read directory"));
+
+    struct dirent* ent;
+
+    while ((ent = readdir(dir)) != nullptr)
+    {
+        String name(static_cast<const char_t*>(ent->d_name));
+        struct stat st;
+
+        // symbolic links are skipped so that walking a tree can't loop
+
+        if (name != STR(".") && name != STR("..") && lstat((path + STR("/") + name).chars(), &st) == 0 &&
+            (S_ISDIR(st.st_mode) || S_ISREG(st.st_mode)))
+        {
+            DirectoryEntry entry;
+            entry.name = name;
+            entry.directory = S_ISDIR(st.st_mode);
+            entry.size = st.st_size;
+            entry.modified = st.st_mtime;
+            entries.addLast(entry);
+        }
+    }
+
+    closedir(dir);
+#endif
+
+    return entries;
+}
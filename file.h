@@ -28,6 +28,9 @@ enum FilePosition
 
 class File
 {
+public:
+    friend class FileMapping;
+
 public:
     File();
     File(const String& filename, int openMode = FILE_MODE_READ);
@@ -51,10 +54,15 @@ public:
 
     void write(const ByteBuffer& data);
     void write(int size, const void* data);
+    void writeText(const TextBuffer& text, TextEncoding encoding, bool bom, bool crLf);
+    void flush();
 
 public:
     static bool exists(const String& filename);
     static void remove(const String& filename);
+    static void replace(const String& filename, const String& newFilename);
+    static bool canReplace(const String& filename);
+    static String resolvePath(const String& filename);
 
 protected:
 #ifdef PLATFORM_WINDOWS
@@ -64,4 +72,54 @@ protected:
 #endif
 };
 
+// FileMapping
+
+class FileMapping
+{
+public:
+    FileMapping(const File& file);
+
+    FileMapping(const FileMapping&) = delete;
+    FileMapping& operator=(const FileMapping&) = delete;
+
+    ~FileMapping();
+
+    const byte_t* data() const
+    {
+        return _data;
+    }
+
+    int64_t size() const
+    {
+        return _size;
+    }
+
+protected:
+    void unmap();
+
+protected:
+#ifdef PLATFORM_WINDOWS
+    HANDLE _mapping;
+#endif
+    const byte_t* _data;
+    int64_t _size;
+};
+
+// Directory
+
+struct DirectoryEntry
+{
+    String name;
+    bool directory;
+    int64_t size;
+    int64_t modified;
+};
+
+class Directory
+{
+public:
+    static bool exists(const String& path);
+    static Array<DirectoryEntry> entries(const String& path);
+};
+
 #endif
@@ -2,6 +2,10 @@
 #include <file.h>
 #include <console.h>
 
+#ifdef SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
 extern const char_t* APPLICATION_NAME;
 
 // diagnostic messages
@@ -54,6 +58,292 @@ void reportError(const String& message)
     reportError(message.chars());
 }
 
+// Memory
+
+#ifdef MEMORY_STATISTICS
+
+// every block is prefixed with its size and site so that deallocation can be accounted for,
+// the header is 16 bytes to keep the alignment malloc guarantees
+
+const size_t MEMORY_BLOCK_HEADER_SIZE = 16;
+
+struct MemoryBlockHeader
+{
+    size_t size;
+    int site;
+};
+
+// sites live in a fixed open addressing table so that tracking never allocates,
+// when it fills up new sites are counted in the last entry
+
+const int MAX_MEMORY_SITES = 4096;
+const int OTHER_MEMORY_SITE = MAX_MEMORY_SITES;
+
+#ifdef PLATFORM_WINDOWS
+static SRWLOCK memoryStatisticsLock = SRWLOCK_INIT;
+#else
+static pthread_mutex_t memoryStatisticsLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+struct MemorySiteEntry
+{
+    const char* signature;
+    MemorySite site;
+};
+
+static MemoryStatistics memoryStatistics = { 0, 0, 0 };
+static MemorySiteEntry memorySites[MAX_MEMORY_SITES + 1];
+static int numMemorySites = 0;
+static thread_local const char* memoryScope = nullptr;
+
+static void lockMemoryStatistics()
+{
+#ifdef PLATFORM_WINDOWS
+    AcquireSRWLockExclusive(&memoryStatisticsLock);
+#else
+    pthread_mutex_lock(&memoryStatisticsLock);
+#endif
+}
+
+static void unlockMemoryStatistics()
+{
+#ifdef PLATFORM_WINDOWS
+    ReleaseSRWLockExclusive(&memoryStatisticsLock);
+#else
+    pthread_mutex_unlock(&memoryStatisticsLock);
+#endif
+}
+
+static void parseTypeName(const char* signature, const char*& type, int& typeLength)
+{
+    // gcc and clang: "... typeSignature() [with _Type = Type]" or "[_Type = Type]",
+    // Visual C++: "... typeSignature<Type>(void)"
+
+    const char* start = strstr(signature, "_Type = ");
+    const char* end = strrchr(signature, ']');
+
+    if (start && end && end > start)
+        start += 8;
+    else
+    {
+        start = strstr(signature, "typeSignature<");
+        end = strrchr(signature, '(');
+
+        if (start && end && end > start + 15)
+        {
+            start += 14;
+            --end;
+        }
+        else
+        {
+            start = signature;
+            end = signature + strlen(signature);
+        }
+    }
+
+    type = start;
+    typeLength = static_cast<int>(end - start);
+}
+
+static int findMemorySite(const MemoryCaller& caller, const char* type)
+{
+    // called with the lock held
+
+    const char* scope = memoryScope;
+    uint64_t key = reinterpret_cast<uintptr_t>(caller.file) ^ reinterpret_cast<uintptr_t>(caller.function) ^
+        reinterpret_cast<uintptr_t>(type) * 31 ^ reinterpret_cast<uintptr_t>(scope) * 17 ^
+        static_cast<uint64_t>(caller.line) * 0x9e3779b97f4a7c15ull;
+    int index = static_cast<int>((key * 0x9e3779b97f4a7c15ull) >> 52) & (MAX_MEMORY_SITES - 1);
+
+    while (memorySites[index].signature)
+    {
+        const MemorySiteEntry& entry = memorySites[index];
+
+        if (entry.signature == type && entry.site.line == caller.line && entry.site.file == caller.file &&
+            entry.site.function == caller.function && entry.site.scope == scope)
+            return index;
+
+        index = (index + 1) & (MAX_MEMORY_SITES - 1);
+    }
+
+    if (numMemorySites >= MAX_MEMORY_SITES * 3 / 4)
+    {
+        MemorySite& other = memorySites[OTHER_MEMORY_SITE].site;
+        other.function = other.file = other.type = "other";
+        other.typeLength = 5;
+        return OTHER_MEMORY_SITE;
+    }
+
+    MemorySiteEntry& entry = memorySites[index];
+    entry.signature = type;
+    entry.site.function = caller.function;
+    entry.site.file = caller.file;
+    entry.site.line = caller.line;
+    entry.site.scope = scope;
+    parseTypeName(type, entry.site.type, entry.site.typeLength);
+    ++numMemorySites;
+
+    return index;
+}
+
+static void updateMemoryStatistics(int64_t allocations, int64_t bytes)
+{
+    memoryStatistics.allocations += allocations;
+    memoryStatistics.bytes += bytes;
+
+    if (memoryStatistics.bytes > memoryStatistics.peakBytes)
+        memoryStatistics.peakBytes = memoryStatistics.bytes;
+}
+
+void* Memory::trackedAllocate(size_t size, const MemoryCaller& caller, const char* type)
+{
+    byte_t* block = static_cast<byte_t*>(malloc(MEMORY_BLOCK_HEADER_SIZE + size));
+
+    if (!block)
+        return nullptr;
+
+    MemoryBlockHeader* header = reinterpret_cast<MemoryBlockHeader*>(block);
+    header->size = size;
+
+    lockMemoryStatistics();
+
+    updateMemoryStatistics(1, size);
+
+    header->site = findMemorySite(caller, type);
+    MemorySite& site = memorySites[header->site].site;
+    ++site.allocations;
+    site.bytes += size;
+    site.totalBytes += size;
+
+    unlockMemoryStatistics();
+
+    return block + MEMORY_BLOCK_HEADER_SIZE;
+}
+
+void* Memory::trackedReallocate(void* ptr, size_t size, const MemoryCaller& caller, const char* type)
+{
+    if (!ptr)
+        return trackedAllocate(size, caller, type);
+
+    byte_t* block = static_cast<byte_t*>(ptr) - MEMORY_BLOCK_HEADER_SIZE;
+    MemoryBlockHeader* header = reinterpret_cast<MemoryBlockHeader*>(block);
+    size_t prevSize = header->size;
+    int prevSite = header->site;
+
+    block = static_cast<byte_t*>(realloc(block, MEMORY_BLOCK_HEADER_SIZE + size));
+
+    if (!block)
+        return nullptr;
+
+    // the block moves to the site that reallocated it
+
+    header = reinterpret_cast<MemoryBlockHeader*>(block);
+    header->size = size;
+
+    lockMemoryStatistics();
+
+    updateMemoryStatistics(1, static_cast<int64_t>(size) - static_cast<int64_t>(prevSize));
+    memorySites[prevSite].site.bytes -= prevSize;
+
+    header->site = findMemorySite(caller, type);
+    MemorySite& site = memorySites[header->site].site;
+    ++site.allocations;
+    site.bytes += size;
+    site.totalBytes += size;
+
+    unlockMemoryStatistics();
+
+    return block + MEMORY_BLOCK_HEADER_SIZE;
+}
+
+void Memory::trackedDeallocate(void* ptr)
+{
+    if (ptr)
+    {
+        byte_t* block = static_cast<byte_t*>(ptr) - MEMORY_BLOCK_HEADER_SIZE;
+        MemoryBlockHeader* header = reinterpret_cast<MemoryBlockHeader*>(block);
+
+        lockMemoryStatistics();
+        updateMemoryStatistics(0, -static_cast<int64_t>(header->size));
+        memorySites[header->site].site.bytes -= header->size;
+        unlockMemoryStatistics();
+
+        free(block);
+    }
+}
+
+MemoryStatistics Memory::statistics()
+{
+    lockMemoryStatistics();
+    MemoryStatistics statistics = memoryStatistics;
+    unlockMemoryStatistics();
+
+    return statistics;
+}
+
+void Memory::resetPeakBytes()
+{
+    lockMemoryStatistics();
+    memoryStatistics.peakBytes = memoryStatistics.bytes;
+    unlockMemoryStatistics();
+}
+
+Memory::Scope::Scope(const char* name) : _prevName(memoryScope)
+{
+    memoryScope = name;
+}
+
+Memory::Scope::~Scope()
+{
+    memoryScope = _prevName;
+}
+
+int Memory::sites(MemorySite* sites, int maxSites)
+{
+    ASSERT(sites ? maxSites >= 0 : maxSites == 0);
+
+    // selects sites in order of live bytes, ties are broken by the index
+    // so that every pass picks the next site after the previous one
+
+    int numSites = 0;
+    int64_t prevBytes = INT64_MAX;
+    int prevIndex = -1;
+
+    lockMemoryStatistics();
+
+    while (numSites < maxSites)
+    {
+        int best = -1;
+
+        for (int i = 0; i <= MAX_MEMORY_SITES; ++i)
+        {
+            const MemorySite& site = memorySites[i].site;
+
+            if (site.allocations == 0)
+                continue;
+
+            if (site.bytes > prevBytes || (site.bytes == prevBytes && i <= prevIndex))
+                continue;
+
+            if (best < 0 || site.bytes > memorySites[best].site.bytes)
+                best = i;
+        }
+
+        if (best < 0)
+            break;
+
+        sites[numSites++] = memorySites[best].site;
+        prevBytes = memorySites[best].site.bytes;
+        prevIndex = best;
+    }
+
+    unlockMemoryStatistics();
+
+    return numSites;
+}
+
+#endif
+
 // assert macros
 
 void terminate(const char_t* message)
@@ -221,7 +511,9 @@ void formatString(char_t* str, const char_t* format, ...)
 
 void formatAllocStringArgs(char_t** str, const char_t* format, va_list args)
 {
-#ifdef PLATFORM_AIX
+    // vasprintf allocates with malloc which would bypass memory statistics
+
+#if defined(PLATFORM_AIX) || defined(MEMORY_STATISTICS)
     va_list args2;
     va_copy(args2, args);
     int len = vsnprintf(0, 0, format, args2);
@@ -713,7 +1005,7 @@ int64_t Timer::ticks()
     return time.QuadPart * 1000000 / freq.QuadPart;
 #else
     timespec time;
-    clock_gettime(CLOCK_REALTIME, &time);
+    clock_gettime(CLOCK_MONOTONIC, &time);
     return time.tv_sec * 1000000 + time.tv_nsec / 1000;
 #endif
 }
@@ -726,7 +1018,7 @@ String::String(const String& other)
     {
         _length = other._length;
         _capacity = _length + 1;
-        _chars = Memory::allocate<char_t>(_capacity);
+        _chars = allocateChars(_capacity);
         strCopyLen(_chars, other._chars, _length + 1);
     }
     else
@@ -746,7 +1038,7 @@ String::String(const char_t* chars, int len)
         if (_length > 0)
         {
             _capacity = _length + 1;
-            _chars = Memory::allocate<char_t>(_capacity);
+            _chars = allocateChars(_capacity);
             *strCopyLen(_chars, chars, _length) = 0;
         }
         else
@@ -773,7 +1065,7 @@ String::String(unichar_t ch, int n)
     {
         _length = UTF_CHAR_LENGTH(ch) * n;
         _capacity = _length + 1;
-        _chars = Memory::allocate<char_t>(_capacity);
+        _chars = allocateChars(_capacity);
         *strSet(_chars, ch, n) = 0;
     }
     else
@@ -800,11 +1092,27 @@ String::String(char_t* chars)
     }
 }
 
+String::String(char_t* chars, int len, int capacity)
+{
+    ASSERT(chars ? len >= 0 && len < capacity : len == 0 && capacity == 0);
+
+    _length = len;
+    _capacity = capacity;
+    _chars = chars;
+}
+
 String::String(String&& other)
 {
     _length = other._length;
     _capacity = other._capacity;
-    _chars = other._chars;
+
+    if (other._chars == other._buffer)
+    {
+        _chars = _buffer;
+        strCopyLen(_buffer, other._buffer, _length + 1);
+    }
+    else
+        _chars = other._chars;
 
     other._length = 0;
     other._capacity = 0;
@@ -880,13 +1188,23 @@ String String::substr(int pos, int len) const
     }
 }
 
+// building a Searcher costs about as much as scanning this many chars,
+// shorter strings are searched directly
+
+const int MIN_SEARCHER_LENGTH = 1024;
+
 int String::find(const String& str, bool caseSensitive, int pos) const
 {
     ASSERT(pos >= 0 && pos <= _length);
 
     if (_length > 0 && str._length > 0)
     {
-        const char_t* p = caseSensitive ? strFind(_chars + pos, str._chars) : strFindNoCase(_chars + pos, str._chars);
+        const char_t* p;
+
+        if (_length - pos < MIN_SEARCHER_LENGTH)
+            p = caseSensitive ? strFind(_chars + pos, str._chars) : strFindNoCase(_chars + pos, str._chars);
+        else
+            p = Searcher(str, caseSensitive).find(_chars + pos, _chars + _length);
 
         if (p)
             return p - _chars;
@@ -1009,7 +1327,28 @@ void String::ensureCapacity(int capacity)
 
     if (capacity > _capacity)
     {
-        if (_chars)
+        if (capacity <= INLINE_CAPACITY)
+        {
+            if (_chars != _buffer)
+            {
+                if (_chars)
+                {
+                    strCopyLen(_buffer, _chars, _length + 1);
+                    Memory::deallocate(_chars);
+                }
+                else
+                    *_buffer = 0;
+
+                _chars = _buffer;
+            }
+        }
+        else if (_chars == _buffer)
+        {
+            char_t* chars = Memory::allocate<char_t>(capacity);
+            strCopyLen(chars, _buffer, _length + 1);
+            _chars = chars;
+        }
+        else if (_chars)
             _chars = Memory::reallocate(_chars, capacity);
         else
         {
@@ -1029,7 +1368,18 @@ void String::shrinkToLength()
 
         if (_capacity > capacity)
         {
-            _chars = Memory::reallocate(_chars, capacity);
+            if (_chars != _buffer)
+            {
+                if (capacity <= INLINE_CAPACITY)
+                {
+                    strCopyLen(_buffer, _chars, capacity);
+                    Memory::deallocate(_chars);
+                    _chars = _buffer;
+                }
+                else
+                    _chars = Memory::reallocate(_chars, capacity);
+            }
+
             _capacity = capacity;
         }
     }
@@ -1663,7 +2013,8 @@ void String::clear()
 
 void String::reset()
 {
-    Memory::deallocate(_chars);
+    if (_chars != _buffer)
+        Memory::deallocate(_chars);
 
     _length = 0;
     _capacity = 0;
@@ -1673,6 +2024,13 @@ void String::reset()
 char_t* String::release()
 {
     char_t* chars = _chars;
+
+    // the caller owns the returned chars, so in place strings are copied to the heap
+    if (chars == _buffer)
+    {
+        chars = Memory::allocate<char_t>(_length + 1);
+        strCopyLen(chars, _buffer, _length + 1);
+    }
     _length = 0;
     _capacity = 0;
     _chars = nullptr;
@@ -1778,44 +2136,45 @@ String String::from(bool value)
 
 String String::from(int value)
 {
-    char_t* chars;
-    formatAllocString(&chars, STR("%d"), value);
-    return String(chars);
+    // integers always fit, so they're formatted without a temporary allocation
+    char_t chars[32];
+    formatString(chars, STR("%d"), value);
+    return String(static_cast<const char_t*>(chars));
 }
 
 String String::from(unsigned value)
 {
-    char_t* chars;
-    formatAllocString(&chars, STR("%u"), value);
-    return String(chars);
+    char_t chars[32];
+    formatString(chars, STR("%u"), value);
+    return String(static_cast<const char_t*>(chars));
 }
 
 String String::from(long value)
 {
-    char_t* chars;
-    formatAllocString(&chars, STR("%ld"), value);
-    return String(chars);
+    char_t chars[32];
+    formatString(chars, STR("%ld"), value);
+    return String(static_cast<const char_t*>(chars));
 }
 
 String String::from(unsigned long value)
 {
-    char_t* chars;
-    formatAllocString(&chars, STR("%lu"), value);
-    return String(chars);
+    char_t chars[32];
+    formatString(chars, STR("%lu"), value);
+    return String(static_cast<const char_t*>(chars));
 }
 
 String String::from(long long value)
 {
-    char_t* chars;
-    formatAllocString(&chars, STR("%lld"), value);
-    return String(chars);
+    char_t chars[32];
+    formatString(chars, STR("%lld"), value);
+    return String(static_cast<const char_t*>(chars));
 }
 
 String String::from(unsigned long long value)
 {
-    char_t* chars;
-    formatAllocString(&chars, STR("%llu"), value);
-    return String(chars);
+    char_t chars[32];
+    formatString(chars, STR("%llu"), value);
+    return String(static_cast<const char_t*>(chars));
 }
 
 String String::from(float value, int precision)
@@ -1898,146 +2257,1190 @@ bool ConstStringIterator::movePrev()
     }
 }
 
-// Unicode
+// Searcher
 
-String Unicode::bytesToString(const ByteBuffer& bytes, TextEncoding& encoding, bool& bom, bool& crLf)
+static const byte_t CASE_FOLD_TABLE[256] =
 {
-    return bytesToString(bytes.size(), bytes.values(), encoding, bom, crLf);
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+    0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f,
+    0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f,
+    0x40, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f,
+    0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x5b, 0x5c, 0x5d, 0x5e, 0x5f,
+    0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f,
+    0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x7b, 0x7c, 0x7d, 0x7e, 0x7f,
+    0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+    0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f,
+    0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xab, 0xac, 0xad, 0xae, 0xaf,
+    0xb0, 0xb1, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xbb, 0xbc, 0xbd, 0xbe, 0xbf,
+    0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf,
+    0xd0, 0xd1, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xdb, 0xdc, 0xdd, 0xde, 0xdf,
+    0xe0, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xeb, 0xec, 0xed, 0xee, 0xef,
+    0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff
+};
+
+Searcher::Searcher() : _caseSensitive(true)
+{
+    for (int i = 0; i < 256; ++i)
+        _skip[i] = 1;
 }
 
-String Unicode::bytesToString(int size, const byte_t* bytes, TextEncoding& encoding, bool& bom, bool& crLf)
+Searcher::Searcher(const String& pattern, bool caseSensitive)
 {
-    ASSERT(bytes ? size >= 0 : size == 0);
+    assign(pattern, caseSensitive);
+}
 
-    int bomOffset = 0;
+void Searcher::assign(const String& pattern, bool caseSensitive)
+{
+    _pattern = pattern;
+    _caseSensitive = caseSensitive;
 
-    if (size >= 2 && bytes[0] == 0xfe && bytes[1] == 0xff)
-    {
-        encoding = TEXT_ENCODING_UTF16_BE;
-        bom = true;
-        bomOffset = 2;
-    }
-    else if (size >= 2 && bytes[0] == 0xff && bytes[1] == 0xfe)
-    {
-        encoding = TEXT_ENCODING_UTF16_LE;
-        bom = true;
-        bomOffset = 2;
-    }
-    else if (size >= 3 && bytes[0] == 0xef && bytes[1] == 0xbb && bytes[2] == 0xbf)
-    {
-        encoding = TEXT_ENCODING_UTF8;
-        bom = true;
-        bomOffset = 3;
-    }
-    else
-    {
-        encoding = TEXT_ENCODING_UTF8;
-        bom = false;
+    int len = _pattern.length();
+    _folded = Buffer<char_t>(len);
 
-        if (size % 2 == 0)
-        {
-            const byte_t* p =  bytes;
-            const byte_t* e = p + size;
-            int le = 0, be = 0;
+    for (int i = 0; i < len; ++i)
+        _folded[i] = caseSensitive ? _pattern.chars()[i] : foldCase(_pattern.chars()[i]);
 
-            while (p < e)
-            {
-                if (*p++ == 0)
-                    ++be;
+    for (int i = 0; i < 256; ++i)
+        _skip[i] = len > 0 ? len : 1;
 
-                if (*p++ == 0)
-                    ++le;
-            }
+    for (int i = 0; i < len - 1; ++i)
+        _skip[skipIndex(_folded[i])] = len - 1 - i;
+}
 
-            if (le > be)
-                encoding = TEXT_ENCODING_UTF16_LE;
-            else if (be > le)
-                encoding = TEXT_ENCODING_UTF16_BE;
-        }
-    }
+void Searcher::clear()
+{
+    assign(String());
+}
 
-    if (encoding != TEXT_ENCODING_UTF8 && size % 2 != 0)
-        throw Exception(STR("text in UTF-16 encoding has odd number of bytes"));
+const char_t* Searcher::find(const char_t* start, const char_t* end) const
+{
+    ASSERT(start ? end >= start : end == start);
 
-    const byte_t* p = bytes + bomOffset;
-    const byte_t* e = bytes + size;
-    int len = 0;
-    unichar_t ch;
+    int len = _folded.size();
+    if (len == 0 || end - start < len)
+        return nullptr;
 
-    while (p < e)
-    {
-        if (encoding == TEXT_ENCODING_UTF8)
-            p += utf8CharToUnicode(reinterpret_cast<const char*>(p), ch);
-        else
-        {
-#ifdef ARCH_LITTLE_ENDIAN
-            if (encoding == TEXT_ENCODING_UTF16_BE)
-#else
-            if (encoding == TEXT_ENCODING_UTF16_LE)
-#endif
-                p += utf16CharToUnicodeSwapBytes(reinterpret_cast<const char16_t*>(p), ch) * 2;
-            else
-                p += utf16CharToUnicode(reinterpret_cast<const char16_t*>(p), ch) * 2;
-        }
+    const char_t* pattern = _folded.values();
+    const char_t* last = end - len;
+    const char_t* p = start;
 
-        if (ch >= 0x20 || ch == '\n' || ch == '\t')
-            len += UTF_CHAR_LENGTH(ch);
-    }
+#ifdef CHAR_ENCODING_UTF8
+    if (_caseSensitive && len == 1)
+        return static_cast<const char_t*>(memchr(start, pattern[0], end - start));
 
-    String str;
-    str.ensureCapacity(len + 1);
+#ifdef SIMD_SSE2
+    // match the first and the last chars of the pattern at 16 positions at once
+    // and compare the rest only for candidates
 
-    p = bytes + bomOffset;
-    crLf = false;
+    const __m128i first = _mm_set1_epi8(pattern[0]);
+    const __m128i firstOther = _mm_set1_epi8(_caseSensitive ? pattern[0] : otherCase(pattern[0]));
+    const __m128i lastChar = _mm_set1_epi8(pattern[len - 1]);
+    const __m128i lastCharOther = _mm_set1_epi8(_caseSensitive ? pattern[len - 1] : otherCase(pattern[len - 1]));
 
-    while (p < e)
+    for (; p + 16 <= last + 1; p += 16)
     {
-        if (encoding == TEXT_ENCODING_UTF8)
-            p += utf8CharToUnicode(reinterpret_cast<const char*>(p), ch);
-        else
-        {
-#ifdef ARCH_LITTLE_ENDIAN
-            if (encoding == TEXT_ENCODING_UTF16_BE)
-#else
-            if (encoding == TEXT_ENCODING_UTF16_LE)
-#endif
-                p += utf16CharToUnicodeSwapBytes(reinterpret_cast<const char16_t*>(p), ch) * 2;
-            else
-                p += utf16CharToUnicode(reinterpret_cast<const char16_t*>(p), ch) * 2;
-        }
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + len - 1));
 
-        if (ch >= 0x20)
-            str += ch;
-        else
+        __m128i firstEq = _mm_or_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(a, firstOther));
+        __m128i lastEq = _mm_or_si128(_mm_cmpeq_epi8(b, lastChar), _mm_cmpeq_epi8(b, lastCharOther));
+
+        for (int mask = _mm_movemask_epi8(_mm_and_si128(firstEq, lastEq)), i = 0; mask != 0; mask >>= 1, ++i)
         {
-            if (ch == '\r')
-                crLf = true;
-            else if (ch == '\n' || ch == '\t')
-                str += ch;
+            if ((mask & 1) != 0 && matchAt(p + i))
+                return p + i;
         }
     }
+#endif
+#endif
 
-    ASSERT(str.length() == len);
-    return str;
+    // Boyer-Moore-Horspool
+
+    while (p <= last)
+    {
+        char_t ch = _caseSensitive ? p[len - 1] : foldCase(p[len - 1]);
+
+        if (ch == pattern[len - 1] && matchAt(p))
+            return p;
+
+        p += _skip[skipIndex(ch)];
+    }
+
+    return nullptr;
 }
 
-ByteBuffer Unicode::stringToBytes(const String& str, TextEncoding encoding, bool bom, bool crLf)
+bool Searcher::matchAt(const char_t* chars) const
 {
-    const char_t* p = str.chars();
-    const char_t* e = p + str.length();
-    int len = bom ? (encoding == TEXT_ENCODING_UTF8 ? 3 : 2) : 0;
-    unichar_t ch;
+    const char_t* pattern = _folded.values();
+    int len = _folded.size();
 
-    while (p < e)
+    if (_caseSensitive)
+        return memcmp(chars, pattern, len * sizeof(char_t)) == 0;
+
+    for (int i = 0; i < len; ++i)
     {
-        p += UTF_CHAR_TO_UNICODE(p, ch);
+        if (foldCase(chars[i]) != pattern[i])
+            return false;
+    }
 
-        if (encoding == TEXT_ENCODING_UTF8)
-        {
-            if (ch == '\n' && crLf)
-                ++len;
-            len += utf8CharLength(ch);
-        }
+    return true;
+}
+
+char_t Searcher::foldCase(char_t ch)
+{
+#ifdef CHAR_ENCODING_UTF8
+    return CASE_FOLD_TABLE[static_cast<byte_t>(ch)];
+#else
+    if (ch < 0x80)
+        return CASE_FOLD_TABLE[ch];
+    else if (ch >= 0xd800 && ch < 0xe000)
+        return ch;
+    else
+        return static_cast<char_t>(charToLower(ch));
+#endif
+}
+
+char_t Searcher::otherCase(char_t ch)
+{
+    return ch >= 'a' && ch <= 'z' ? ch - ('a' - 'A') : ch;
+}
+
+// ConstTextBufferIterator
+
+unichar_t ConstTextBufferIterator::value() const
+{
+    ASSERT(_pos >= 0);
+    return _text.charAt(_pos);
+}
+
+bool ConstTextBufferIterator::moveNext()
+{
+    _pos = _pos < 0 ? 0 : _text.charForward(_pos);
+
+    if (_pos < _text.length())
+        return true;
+    else
+    {
+        _pos = INVALID_POSITION;
+        return false;
+    }
+}
+
+bool ConstTextBufferIterator::movePrev()
+{
+    if (_pos < 0)
+        _pos = _text.length();
+
+    if (_pos > 0)
+    {
+        _pos = _text.charBack(_pos);
+        return true;
+    }
+    else
+    {
+        _pos = INVALID_POSITION;
+        return false;
+    }
+}
+
+// TextBuffer
+
+const int MIN_GAP_SIZE = 4096;
+const int MAX_GAP_SIZE = 64 * 1024 * 1024;
+
+// the gap grows by a sixteenth of the size within bounds, doubling would make a large
+// text take twice its memory on the first insert
+
+int gapCapacity(int size, int len)
+{
+    int64_t capacity = static_cast<int64_t>(size) + len + min(max(size / 16, MIN_GAP_SIZE), MAX_GAP_SIZE);
+
+    if (capacity >= INT_MAX)
+        throw OutOfMemoryException();
+
+    return static_cast<int>(capacity);
+}
+
+TextBuffer::TextBuffer(const TextBuffer& other)
+{
+    int len = other.length();
+
+    if (len > 0)
+    {
+        _capacity = len;
+        _gapStart = _gapEnd = len;
+        _chars = Memory::allocate<char_t>(_capacity + 1);
+
+        strCopyLen(_chars, other._chars, other._gapStart);
+        strCopyLen(_chars + other._gapStart, other._chars + other._gapEnd, other._capacity - other._gapEnd);
+    }
+    else
+    {
+        _capacity = 0;
+        _gapStart = _gapEnd = 0;
+        _chars = nullptr;
+    }
+
+    _lineCapacity = other.lineCount() - 1;
+    _lineGapStart = _lineGapEnd = _lineCapacity;
+    _lineEnds = Memory::allocate<int>(_lineCapacity);
+
+    for (int i = 0; i < _lineCapacity; ++i)
+        _lineEnds[i] = other.lineEndAt(i);
+}
+
+TextBuffer::TextBuffer(const String& str)
+{
+    int len = str.length();
+
+    if (len > 0)
+    {
+        _capacity = len;
+        _gapStart = _gapEnd = len;
+        _chars = Memory::allocate<char_t>(_capacity + 1);
+        strCopyLen(_chars, str.chars(), len);
+    }
+    else
+    {
+        _capacity = 0;
+        _gapStart = _gapEnd = 0;
+        _chars = nullptr;
+    }
+
+    _lineCapacity = 0;
+    _lineGapStart = _lineGapEnd = 0;
+    _lineEnds = nullptr;
+
+    indexLines();
+}
+
+TextBuffer::TextBuffer(TextBuffer&& other)
+{
+    _capacity = other._capacity;
+    _gapStart = other._gapStart;
+    _gapEnd = other._gapEnd;
+    _chars = other._chars;
+    _lineCapacity = other._lineCapacity;
+    _lineGapStart = other._lineGapStart;
+    _lineGapEnd = other._lineGapEnd;
+    _lineEnds = other._lineEnds;
+
+    other._capacity = 0;
+    other._gapStart = other._gapEnd = 0;
+    other._chars = nullptr;
+    other._lineCapacity = 0;
+    other._lineGapStart = other._lineGapEnd = 0;
+    other._lineEnds = nullptr;
+}
+
+const char_t* TextBuffer::chars() const
+{
+    if (_chars)
+    {
+        int len = length();
+        moveGap(len);
+        _chars[len] = 0;
+
+        return _chars;
+    }
+
+    return STR("");
+}
+
+int TextBuffer::charForward(int pos, int n) const
+{
+    ASSERT(pos >= 0 && pos <= length());
+    ASSERT(n >= 0);
+
+    int len = length();
+    unichar_t ch;
+
+    while (pos < len && n > 0)
+    {
+        pos += UTF_CHAR_TO_UNICODE(charPointer(pos), ch);
+        --n;
+    }
+
+    return pos;
+}
+
+int TextBuffer::charBack(int pos, int n) const
+{
+    ASSERT(pos >= 0 && pos <= length());
+    ASSERT(n >= 0);
+
+    int gap = _gapEnd - _gapStart;
+
+    while (pos > 0 && n > 0)
+    {
+        if (pos <= _gapStart)
+            pos = UTF_CHAR_BACK(_chars + pos) - _chars;
+        else
+            pos = UTF_CHAR_BACK(_chars + pos + gap) - _chars - gap;
+
+        --n;
+    }
+
+    return pos;
+}
+
+int TextBuffer::lineStart(int line) const
+{
+    ASSERT(line > 0 && line <= lineCount());
+    return line > 1 ? lineEndAt(line - 2) + 1 : 0;
+}
+
+int TextBuffer::lineEnd(int line) const
+{
+    ASSERT(line > 0 && line <= lineCount());
+    return line < lineCount() ? lineEndAt(line - 1) : length();
+}
+
+int TextBuffer::lineAt(int pos) const
+{
+    ASSERT(pos >= 0 && pos <= length());
+
+    int low = 0, high = lineCount() - 1;
+
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+
+        if (lineEndAt(middle) < pos)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low + 1;
+}
+
+String TextBuffer::substr(int pos, int len) const
+{
+    ASSERT(pos >= 0 && pos <= length());
+
+    if (len < 0)
+        len = length() - pos;
+    else
+        ASSERT(pos + len >= 0 && pos + len <= length());
+
+    if (len > 0)
+    {
+        if (pos + len <= _gapStart || pos >= _gapStart)
+            return String(charPointer(pos), len);
+
+        String str;
+        str.ensureCapacity(len + 1);
+        str.append(_chars + pos, _gapStart - pos);
+        str.append(_chars + _gapEnd, pos + len - _gapStart);
+
+        return str;
+    }
+
+    return String();
+}
+
+int TextBuffer::find(const String& str, bool caseSensitive, int pos) const
+{
+    ASSERT(pos >= 0 && pos <= length());
+    return find(Searcher(str, caseSensitive), pos);
+}
+
+int TextBuffer::find(const Searcher& searcher, int pos, int end) const
+{
+    if (end < 0)
+        end = length();
+
+    ASSERT(pos >= 0 && pos <= end && end <= length());
+
+    int len = searcher.pattern().length();
+    if (len == 0 || end - pos < len)
+        return INVALID_POSITION;
+
+    if (pos < _gapStart)
+    {
+        const char_t* p = searcher.find(_chars + pos, _chars + min(end, _gapStart));
+        if (p)
+            return p - _chars;
+
+        if (end <= _gapStart)
+            return INVALID_POSITION;
+
+        // matches crossing the gap
+
+        int start = max(pos, _gapStart - len + 1);
+        String window = substr(start, min(end, _gapStart + len - 1) - start);
+
+        p = searcher.find(window.chars(), window.chars() + window.length());
+        if (p)
+            return start + (p - window.chars());
+
+        pos = _gapStart;
+    }
+
+    const char_t* chars = _chars + (_gapEnd - _gapStart);
+    const char_t* p = searcher.find(chars + pos, chars + end);
+
+    return p ? p - chars : INVALID_POSITION;
+}
+
+bool TextBuffer::startsWith(const char_t* chars, bool caseSensitive) const
+{
+    if (chars)
+    {
+        int len = strLen(chars);
+        if (len > 0 && len <= length())
+        {
+            return caseSensitive ? strCompareLen(this->chars(), chars, len) == 0 :
+                                   strCompareLenNoCase(this->chars(), chars, len) == 0;
+        }
+    }
+
+    return false;
+}
+
+void TextBuffer::ensureCapacity(int capacity)
+{
+    ASSERT(capacity >= 0);
+
+    if (capacity > _capacity)
+    {
+        int tail = _capacity - _gapEnd;
+
+        _chars = Memory::reallocate(_chars, capacity + 1);
+        strMove(_chars + capacity - tail, _chars + _gapEnd, tail);
+
+        _gapEnd = capacity - tail;
+        _capacity = capacity;
+    }
+}
+
+void TextBuffer::assign(const String& str)
+{
+    clear();
+    insert(0, str);
+}
+
+void TextBuffer::assign(String&& str)
+{
+    int len = str.length();
+
+    if (len > 0)
+    {
+        Memory::deallocate(_chars);
+
+        _capacity = len;
+        _gapStart = _gapEnd = len;
+        _chars = str.release();
+
+        indexLines();
+    }
+    else
+        clear();
+}
+
+void TextBuffer::insert(int pos, const String& str)
+{
+    insert(pos, str.chars(), str.length());
+}
+
+void TextBuffer::insert(int pos, const char_t* chars, int len)
+{
+    ASSERT(pos >= 0 && pos <= length());
+
+    if (chars && *chars)
+    {
+        if (len < 0)
+            len = strLen(chars);
+
+        strCopyLen(insertGap(pos, len), chars, len);
+        addLineEnds(pos, len);
+    }
+    else
+        ASSERT(len <= 0);
+}
+
+void TextBuffer::insert(int pos, unichar_t ch, int n)
+{
+    ASSERT(pos >= 0 && pos <= length());
+    ASSERT(ch != 0);
+    ASSERT(n >= 0);
+
+    if (n > 0)
+    {
+        int len = UTF_CHAR_LENGTH(ch) * n;
+
+        strSet(insertGap(pos, len), ch, n);
+        addLineEnds(pos, len);
+    }
+}
+
+void TextBuffer::erase(int pos, int len)
+{
+    ASSERT(pos >= 0 && pos <= length());
+
+    if (len < 0)
+        len = length() - pos;
+    else
+        ASSERT(pos + len >= 0 && pos + len <= length());
+
+    if (len > 0)
+    {
+        removeLineEnds(pos, len);
+        moveGap(pos);
+        _gapEnd += len;
+    }
+}
+
+void TextBuffer::replace(int pos, const String& str, int len)
+{
+    erase(pos, len);
+    insert(pos, str);
+}
+
+void TextBuffer::replace(int pos, const char_t* chars, int len)
+{
+    erase(pos, len);
+    insert(pos, chars);
+}
+
+void TextBuffer::replaceString(const String& searchStr, const String& replaceStr, bool caseSensitive)
+{
+    replaceString(Searcher(searchStr, caseSensitive), replaceStr);
+}
+
+void TextBuffer::replaceString(const Searcher& searcher, const String& replaceStr)
+{
+    if (length() > 0 && !searcher.empty())
+    {
+        const char_t* chars = this->chars();
+        const char_t* end = chars + length();
+        const char_t* from = chars;
+        const char_t* found;
+        String str;
+
+        while ((found = searcher.find(from, end)) != nullptr)
+        {
+            str.append(from, found - from);
+            str.append(replaceStr);
+            from = found + searcher.pattern().length();
+        }
+
+        if (from > chars)
+        {
+            str.append(from, end - from);
+            assign(static_cast<String&&>(str));
+        }
+    }
+}
+
+void TextBuffer::clear()
+{
+    _gapStart = 0;
+    _gapEnd = _capacity;
+    _lineGapStart = 0;
+    _lineGapEnd = _lineCapacity;
+}
+
+char_t* TextBuffer::insertGap(int pos, int len)
+{
+    ASSERT(len >= 0);
+
+    if (_gapEnd - _gapStart < len)
+        ensureCapacity(gapCapacity(length(), len));
+
+    moveLineGap(pos);
+    moveGap(pos);
+    _gapStart += len;
+
+    return _chars + pos;
+}
+
+void TextBuffer::moveGap(int pos) const
+{
+    if (pos < _gapStart)
+    {
+        int len = _gapStart - pos;
+        strMove(_chars + _gapEnd - len, _chars + pos, len);
+
+        _gapStart -= len;
+        _gapEnd -= len;
+    }
+    else if (pos > _gapStart)
+    {
+        int len = pos - _gapStart;
+        strMove(_chars + _gapStart, _chars + _gapEnd, len);
+
+        _gapStart += len;
+        _gapEnd += len;
+    }
+}
+
+void TextBuffer::addLineEnds(int pos, int len)
+{
+    ASSERT(pos + len <= _gapStart);
+
+    for (int i = pos; i < pos + len; ++i)
+    {
+        if (_chars[i] == '\n')
+        {
+            if (_lineGapStart == _lineGapEnd)
+            {
+                int capacity = gapCapacity(_lineCapacity, 1);
+                int tail = _lineCapacity - _lineGapEnd;
+
+                _lineEnds = Memory::reallocate(_lineEnds, capacity);
+                memmove(_lineEnds + capacity - tail, _lineEnds + _lineGapEnd, tail * sizeof(int));
+
+                _lineGapEnd = capacity - tail;
+                _lineCapacity = capacity;
+            }
+
+            _lineEnds[_lineGapStart++] = i;
+        }
+    }
+}
+
+void TextBuffer::removeLineEnds(int pos, int len)
+{
+    moveLineGap(pos);
+
+    int end = length() - pos - len;
+
+    while (_lineGapEnd < _lineCapacity && _lineEnds[_lineGapEnd] > end)
+        ++_lineGapEnd;
+}
+
+void TextBuffer::moveLineGap(int pos)
+{
+    int len = length();
+
+    while (_lineGapStart > 0 && _lineEnds[_lineGapStart - 1] >= pos)
+        _lineEnds[--_lineGapEnd] = len - _lineEnds[--_lineGapStart];
+
+    while (_lineGapEnd < _lineCapacity && len - _lineEnds[_lineGapEnd] < pos)
+        _lineEnds[_lineGapStart++] = len - _lineEnds[_lineGapEnd++];
+}
+
+void TextBuffer::indexLines()
+{
+    _lineGapStart = 0;
+    _lineGapEnd = _lineCapacity;
+
+    moveGap(length());
+    addLineEnds(0, length());
+}
+
+// Unicode
+
+const int UTF16_DETECTION_SAMPLE_SIZE = 65536;
+const int MIN_TEXT_DECODE_CHUNK_SIZE = 4 * 1024 * 1024;
+const unichar_t REPLACEMENT_CHAR = 0xfffd;
+
+int textAsciiLength(const byte_t* bytes, int size)
+{
+    int i = 0;
+
+#ifdef SIMD_SSE2
+    const __m128i space = _mm_set1_epi8(0x20);
+    const __m128i newLine = _mm_set1_epi8('\n');
+    const __m128i tab = _mm_set1_epi8('\t');
+
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i));
+        __m128i control = _mm_cmplt_epi8(v, space);
+        __m128i allowed = _mm_or_si128(_mm_cmpeq_epi8(v, newLine), _mm_cmpeq_epi8(v, tab));
+
+        if (_mm_movemask_epi8(_mm_andnot_si128(allowed, control)) != 0)
+            break;
+    }
+#endif
+
+    for (; i < size; ++i)
+    {
+        byte_t b = bytes[i];
+
+        if (b >= 0x80 || (b < 0x20 && b != '\n' && b != '\t'))
+            break;
+    }
+
+    return i;
+}
+
+int utf8SequenceLength(byte_t b)
+{
+    return b < 0x80 ? 1 : (b < 0xe0 ? 2 : (b < 0xf0 ? 3 : 4));
+}
+
+bool textNeedsByteSwap(TextEncoding encoding)
+{
+#ifdef ARCH_LITTLE_ENDIAN
+    return encoding == TEXT_ENCODING_UTF16_BE;
+#else
+    return encoding == TEXT_ENCODING_UTF16_LE;
+#endif
+}
+
+// a sequence cut off by the end of the input decodes to a replacement character
+
+int decodeUtf8Char(const byte_t* p, const byte_t* e, unichar_t& ch)
+{
+    ASSERT(p < e);
+
+    if (e - p < utf8SequenceLength(*p))
+    {
+        ch = REPLACEMENT_CHAR;
+        return static_cast<int>(e - p);
+    }
+
+    return utf8CharToUnicode(reinterpret_cast<const char*>(p), ch);
+}
+
+int decodeUtf16Char(const byte_t* p, const byte_t* e, bool swap, unichar_t& ch)
+{
+    ASSERT(p + 2 <= e);
+
+    const char16_t* in = reinterpret_cast<const char16_t*>(p);
+
+    if (e - p < 4 && ((swap ? swapBytes(*in) : *in) & 0xfc00) == 0xd800)
+    {
+        ch = REPLACEMENT_CHAR;
+        return 2;
+    }
+
+    return (swap ? utf16CharToUnicodeSwapBytes(in, ch) : utf16CharToUnicode(in, ch)) * 2;
+}
+
+// decoded UTF-8 never takes more code units than bytes except for a replacement character
+// at the end, UTF-16 is counted
+
+int64_t decodedTextCapacity(const byte_t* p, const byte_t* e, TextEncoding encoding)
+{
+    int64_t len = 0;
+
+    if (encoding == TEXT_ENCODING_UTF8)
+        len = (e - p) + UTF_CHAR_LENGTH(REPLACEMENT_CHAR);
+    else
+    {
+        bool swap = textNeedsByteSwap(encoding);
+        unichar_t ch;
+
+        while (p < e)
+        {
+            p += decodeUtf16Char(p, e, swap, ch);
+
+            if (ch >= 0x20 || ch == '\n' || ch == '\t')
+                len += UTF_CHAR_LENGTH(ch);
+        }
+    }
+
+    return len;
+}
+
+// returns the number of code units written, chars must hold decodedTextCapacity() of them
+
+int decodeText(const byte_t* p, const byte_t* e, TextEncoding encoding, char_t* chars, bool& crLf)
+{
+    bool swap = textNeedsByteSwap(encoding);
+    char_t* out = chars;
+    unichar_t ch;
+
+    crLf = false;
+
+    while (p < e)
+    {
+        if (encoding == TEXT_ENCODING_UTF8)
+        {
+            int n = textAsciiLength(p, static_cast<int>(e - p));
+
+#ifdef CHAR_ENCODING_UTF8
+            memcpy(out, p, n);
+#else
+            for (int i = 0; i < n; ++i)
+                out[i] = p[i];
+#endif
+            out += n;
+            p += n;
+
+            if (p == e)
+                break;
+
+            p += decodeUtf8Char(p, e, ch);
+        }
+        else
+            p += decodeUtf16Char(p, e, swap, ch);
+
+        if (ch >= 0x20 || ch == '\n' || ch == '\t')
+            out += UNICODE_CHAR_TO_UTF(ch, out);
+        else if (ch == '\r')
+            crLf = true;
+    }
+
+    return static_cast<int>(out - chars);
+}
+
+// a character starts at the returned position wherever decoding began before it,
+// UTF-8 needs no sequence from the three bytes before it to reach past it
+
+const byte_t* utf8ChunkEnd(const byte_t* start, const byte_t* pos)
+{
+    for (; pos > start; --pos)
+    {
+        int i = 1;
+
+        while (i <= 3 && i <= pos - start && utf8SequenceLength(pos[-i]) <= i)
+            ++i;
+
+        if (i > 3 || i > pos - start)
+            return pos;
+    }
+
+    return start;
+}
+
+// UTF-16 needs the code unit before it not to be a high surrogate
+
+const byte_t* utf16ChunkEnd(const byte_t* start, const byte_t* pos, TextEncoding encoding)
+{
+    bool swap = textNeedsByteSwap(encoding);
+
+    for (pos = start + ((pos - start) & ~1); pos > start; pos -= 2)
+    {
+        char16_t unit = *reinterpret_cast<const char16_t*>(pos - 2);
+
+        if (((swap ? swapBytes(unit) : unit) & 0xfc00) != 0xd800)
+            return pos;
+    }
+
+    return start;
+}
+
+struct TextDetection
+{
+    const byte_t* bytes;
+    int size;
+    TextEncoding encoding;
+    bool bom;
+    int bomOffset;
+};
+
+void detectTextEncoding(void* param)
+{
+    TextDetection* detection = static_cast<TextDetection*>(param);
+    const byte_t* bytes = detection->bytes;
+    int size = detection->size;
+
+    detection->encoding = TEXT_ENCODING_UTF8;
+    detection->bom = false;
+    detection->bomOffset = 0;
+
+    if (size >= 2 && bytes[0] == 0xfe && bytes[1] == 0xff)
+    {
+        detection->encoding = TEXT_ENCODING_UTF16_BE;
+        detection->bom = true;
+        detection->bomOffset = 2;
+    }
+    else if (size >= 2 && bytes[0] == 0xff && bytes[1] == 0xfe)
+    {
+        detection->encoding = TEXT_ENCODING_UTF16_LE;
+        detection->bom = true;
+        detection->bomOffset = 2;
+    }
+    else if (size >= 3 && bytes[0] == 0xef && bytes[1] == 0xbb && bytes[2] == 0xbf)
+    {
+        detection->bom = true;
+        detection->bomOffset = 3;
+    }
+    else if (size % 2 == 0)
+    {
+        const byte_t* p =  bytes;
+        const byte_t* e = p + min(size, UTF16_DETECTION_SAMPLE_SIZE);
+        int le = 0, be = 0;
+
+        while (p < e)
+        {
+            if (*p++ == 0)
+                ++be;
+
+            if (*p++ == 0)
+                ++le;
+        }
+
+        if (le > be)
+            detection->encoding = TEXT_ENCODING_UTF16_LE;
+        else if (be > le)
+            detection->encoding = TEXT_ENCODING_UTF16_BE;
+    }
+}
+
+struct TextDecodeChunk
+{
+    const byte_t* start;
+    const byte_t* end;
+    TextEncoding encoding;
+    char_t* chars;
+    int64_t capacity;
+    int length;
+    bool crLf;
+    void (*func)(void*);
+    bool failed;
+};
+
+struct TextSplit
+{
+    const byte_t* start;
+    const byte_t* end;
+    TextEncoding encoding;
+    bool partial;
+    Array<TextDecodeChunk>* chunks;
+};
+
+// chunks are split where a character starts no matter where decoding began,
+// so the result is the same as decoding in one go
+
+void splitText(void* param)
+{
+    TextSplit* split = static_cast<TextSplit*>(param);
+    Array<TextDecodeChunk>& chunks = *split->chunks;
+    int numChunks = chunks.size();
+    const byte_t* start = split->start;
+
+    if (split->partial)
+        split->end = split->encoding == TEXT_ENCODING_UTF8 ? utf8ChunkEnd(start, split->end) :
+                                                             utf16ChunkEnd(start, split->end, split->encoding);
+
+    for (int i = 0; i < numChunks; ++i)
+    {
+        const byte_t* end = split->end;
+
+        if (i < numChunks - 1)
+        {
+            end = split->start + (split->end - split->start) / numChunks * (i + 1);
+            end = split->encoding == TEXT_ENCODING_UTF8 ? utf8ChunkEnd(start, end) :
+                                                          utf16ChunkEnd(start, end, split->encoding);
+        }
+
+        chunks[i].start = start;
+        chunks[i].end = end;
+        chunks[i].encoding = split->encoding;
+        chunks[i].chars = nullptr;
+        chunks[i].capacity = 0;
+        chunks[i].length = 0;
+        chunks[i].crLf = false;
+        chunks[i].failed = false;
+
+        start = end;
+    }
+}
+
+void countTextChunk(void* param)
+{
+    TextDecodeChunk* chunk = static_cast<TextDecodeChunk*>(param);
+    chunk->capacity = decodedTextCapacity(chunk->start, chunk->end, chunk->encoding);
+}
+
+void decodeTextChunk(void* param)
+{
+    TextDecodeChunk* chunk = static_cast<TextDecodeChunk*>(param);
+    chunk->length = decodeText(chunk->start, chunk->end, chunk->encoding, chunk->chars, chunk->crLf);
+}
+
+void runTextChunk(void* param)
+{
+    TextDecodeChunk* chunk = static_cast<TextDecodeChunk*>(param);
+    chunk->failed = !guardedRead(chunk->func, chunk);
+}
+
+// the first chunk runs on the calling thread, the others on a thread each, throws
+// if reading the text failed
+
+void runTextChunks(void (*func)(void*), Array<TextDecodeChunk>& chunks)
+{
+    for (int i = 0; i < chunks.size(); ++i)
+        chunks[i].func = func;
+
+    {
+        Array<Unique<Thread>> threads;
+
+        for (int i = 1; i < chunks.size(); ++i)
+        {
+            threads.addLast(createUnique<Thread>());
+            threads.last()->start(runTextChunk, &chunks[i]);
+        }
+
+        runTextChunk(&chunks[0]);
+    }
+
+    for (int i = 0; i < chunks.size(); ++i)
+    {
+        if (chunks[i].failed)
+            throw Exception(STR("failed to read text"));
+    }
+}
+
+int asciiLength(const char* chars, int len, bool stopAtNewLine)
+{
+    int i = 0;
+
+#ifdef SIMD_SSE2
+    const __m128i newLine = _mm_set1_epi8(stopAtNewLine ? '\n' : 0);
+
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(chars + i));
+
+        if (_mm_movemask_epi8(_mm_or_si128(v, _mm_cmpeq_epi8(v, newLine))) != 0)
+            break;
+    }
+#endif
+
+    for (; i < len; ++i)
+    {
+        char ch = chars[i];
+
+        if ((ch & 0x80) != 0 || (ch == '\n' && stopAtNewLine))
+            break;
+    }
+
+    return i;
+}
+
+int asciiLength(const char16_t* chars, int len, bool stopAtNewLine)
+{
+    int i = 0;
+
+    for (; i < len; ++i)
+    {
+        char16_t ch = chars[i];
+
+        if (ch >= 0x80 || (ch == '\n' && stopAtNewLine))
+            break;
+    }
+
+    return i;
+}
+
+String Unicode::bytesToString(const ByteBuffer& bytes, TextEncoding& encoding, bool& bom, bool& crLf)
+{
+    return bytesToString(bytes.size(), bytes.values(), encoding, bom, crLf);
+}
+
+String Unicode::bytesToString(int size, const byte_t* bytes, TextEncoding& encoding, bool& bom, bool& crLf, int limit)
+{
+    ASSERT(bytes ? size >= 0 : size == 0);
+    ASSERT(limit >= 0);
+
+    // the bytes may come from a file mapping, every read of them is guarded
+
+    TextDetection detection = { bytes, size, TEXT_ENCODING_UTF8, false, 0 };
+
+    if (!guardedRead(detectTextEncoding, &detection))
+        throw Exception(STR("failed to read text"));
+
+    encoding = detection.encoding;
+    bom = detection.bom;
+
+    if (encoding != TEXT_ENCODING_UTF8 && size % 2 != 0)
+        throw Exception(STR("text in UTF-16 encoding has odd number of bytes"));
+
+    // large text is decoded in chunks on worker threads, each chunk writes at the sum
+    // of the capacities before it and the gaps are closed after
+
+    const byte_t* p = bytes + detection.bomOffset;
+    const byte_t* e = bytes + size;
+    bool partial = e - p > limit;
+
+    if (partial)
+        e = p + limit;
+
+    int numChunks = max(min(Thread::processorCount(), static_cast<int>(e - p) / MIN_TEXT_DECODE_CHUNK_SIZE), 1);
+
+    Array<TextDecodeChunk> chunks(numChunks);
+    TextSplit split = { p, e, encoding, partial, &chunks };
+
+    if (!guardedRead(splitText, &split))
+        throw Exception(STR("failed to read text"));
+
+    if (encoding == TEXT_ENCODING_UTF8)
+    {
+        for (int i = 0; i < numChunks; ++i)
+            chunks[i].capacity = decodedTextCapacity(chunks[i].start, chunks[i].end, encoding);
+    }
+    else
+        runTextChunks(countTextChunk, chunks);
+
+    int64_t capacity = 1;
+
+    for (int i = 0; i < numChunks; ++i)
+        capacity += chunks[i].capacity;
+
+    if (capacity > INT_MAX)
+        throw OutOfMemoryException();
+
+    Buffer<char_t> chars(static_cast<int>(capacity));
+    char_t* out = chars.values();
+
+    for (int i = 0; i < numChunks; ++i)
+    {
+        chunks[i].chars = out;
+        out += chunks[i].capacity;
+    }
+
+    runTextChunks(decodeTextChunk, chunks);
+
+    int len = 0;
+    crLf = false;
+
+    for (int i = 0; i < numChunks; ++i)
+    {
+        if (chunks[i].chars != chars.values() + len)
+            memmove(chars.values() + len, chunks[i].chars, chunks[i].length * sizeof(char_t));
+
+        len += chunks[i].length;
+        crLf = crLf || chunks[i].crLf;
+    }
+
+    chars[len] = 0;
+
+    return String::acquire(chars.release(), len, static_cast<int>(capacity));
+}
+
+ByteBuffer Unicode::stringToBytes(const String& str, TextEncoding encoding, bool bom, bool crLf)
+{
+    return stringToBytes(str.length(), str.chars(), encoding, bom, crLf);
+}
+
+ByteBuffer Unicode::stringToBytes(int length, const char_t* chars, TextEncoding encoding, bool bom, bool crLf)
+{
+    ASSERT(chars ? length >= 0 : length == 0);
+
+    const char_t* p = chars;
+    const char_t* e = p + length;
+    int len = bom ? (encoding == TEXT_ENCODING_UTF8 ? 3 : 2) : 0;
+    unichar_t ch;
+
+    while (p < e)
+    {
+        if (encoding == TEXT_ENCODING_UTF8)
+        {
+            int n = asciiLength(p, e - p, crLf);
+            p += n;
+            len += n;
+
+            if (p == e)
+                break;
+        }
+
+        p += UTF_CHAR_TO_UNICODE(p, ch);
+
+        if (encoding == TEXT_ENCODING_UTF8)
+        {
+            if (ch == '\n' && crLf)
+                ++len;
+            len += utf8CharLength(ch);
+        }
         else
         {
             if (ch == '\n' && crLf)
@@ -2046,51 +3449,98 @@ ByteBuffer Unicode::stringToBytes(const String& str, TextEncoding encoding, bool
         }
     }
 
-    p = str.chars();
-
     ByteBuffer bytes;
     bytes.resize(len);
+
+    int i = bom ? byteOrderMark(encoding, bytes.values()) : 0;
+    p = chars;
+    i += charsToBytes(p, e, encoding, crLf, bytes.values() + i, len - i);
+
+    ASSERT(p == e && i == len);
+    return bytes;
+}
+
+int Unicode::byteOrderMark(TextEncoding encoding, byte_t* bytes)
+{
+    ASSERT(bytes);
+
+    if (encoding == TEXT_ENCODING_UTF8)
+    {
+        bytes[0] = 0xef;
+        bytes[1] = 0xbb;
+        bytes[2] = 0xbf;
+        return 3;
+    }
+    else if (encoding == TEXT_ENCODING_UTF16_LE)
+    {
+        bytes[0] = 0xff;
+        bytes[1] = 0xfe;
+        return 2;
+    }
+    else
+    {
+        bytes[0] = 0xfe;
+        bytes[1] = 0xff;
+        return 2;
+    }
+}
+
+int Unicode::charsToBytes(const char_t*& chars, const char_t* end, TextEncoding encoding, bool crLf,
+                          byte_t* bytes, int size)
+{
+    ASSERT(chars ? end >= chars : end == chars);
+    ASSERT(bytes ? size >= 0 : size == 0);
+
+    const char_t* p = chars;
     int i = 0;
+    unichar_t ch;
 
-    if (bom)
+    while (p < end)
     {
         if (encoding == TEXT_ENCODING_UTF8)
         {
-            bytes[i++] = 0xef;
-            bytes[i++] = 0xbb;
-            bytes[i++] = 0xbf;
-        }
-        else
-        {
-            char16_t bomch = 0xfeff;
-            bytes[i++] = *(reinterpret_cast<byte_t*>(&bomch));
-            bytes[i++] = *(reinterpret_cast<byte_t*>(&bomch) + 1);
+            int n = asciiLength(p, min(static_cast<int>(end - p), size - i), crLf);
+#ifdef CHAR_ENCODING_UTF8
+            memcpy(bytes + i, p, n);
+#else
+            for (int j = 0; j < n; ++j)
+                bytes[i + j] = p[j];
+#endif
+            p += n;
+            i += n;
+
+            if (p == end)
+                break;
         }
-    }
 
-    while (p < e)
-    {
+        const char_t* q = p;
         p += UTF_CHAR_TO_UNICODE(p, ch);
 
+        byte_t s[8];
+        int n = 0;
+
         if (ch == '\n' && crLf)
         {
             if (encoding == TEXT_ENCODING_UTF8)
-                bytes[i++] = '\r';
+                s[n++] = '\r';
             else
             {
                 char16_t lfch = '\r';
-                bytes[i++] = *(reinterpret_cast<byte_t*>(&lfch));
-                bytes[i++] = *(reinterpret_cast<byte_t*>(&lfch) + 1);
+                s[n++] = *(reinterpret_cast<byte_t*>(&lfch));
+                s[n++] = *(reinterpret_cast<byte_t*>(&lfch) + 1);
             }
         }
 
-        byte_t s[4];
-        int n;
-
         if (encoding == TEXT_ENCODING_UTF8)
-            n = unicodeCharToUtf8(ch, reinterpret_cast<char*>(s));
+            n += unicodeCharToUtf8(ch, reinterpret_cast<char*>(s + n));
         else
-            n = unicodeCharToUtf16(ch, reinterpret_cast<char16_t*>(s)) * 2;
+            n += unicodeCharToUtf16(ch, reinterpret_cast<char16_t*>(s + n)) * 2;
+
+        if (i + n > size)
+        {
+            p = q;
+            break;
+        }
 
         for (int j = 0; j < n; ++j)
             bytes[i++] = s[j];
@@ -2098,12 +3548,280 @@ ByteBuffer Unicode::stringToBytes(const String& str, TextEncoding encoding, bool
 
 #ifdef ARCH_LITTLE_ENDIAN
     if (encoding == TEXT_ENCODING_UTF16_BE)
-        swapBytes(reinterpret_cast<uint16_t*>(bytes.values()), bytes.size() / 2);
+        swapBytes(reinterpret_cast<uint16_t*>(bytes), i / 2);
 #else
     if (encoding == TEXT_ENCODING_UTF16_LE)
-        swapBytes(reinterpret_cast<uint16_t*>(bytes.values()), bytes.size() / 2);
+        swapBytes(reinterpret_cast<uint16_t*>(bytes), i / 2);
 #endif
 
-    ASSERT(bytes.size() == len);
-    return bytes;
+    chars = p;
+    return i;
+}
+
+// MemoryPool
+
+MemoryPool::MemoryPool(int blockSize, int blockAlignment, int blocksPerChunk, bool arena) :
+    _blocksPerChunk(blocksPerChunk), _arena(arena), _numBlocks(0), _numChunks(0),
+    _chunks(nullptr), _freeBlocks(nullptr), _next(nullptr), _end(nullptr)
+{
+    ASSERT(blockSize > 0);
+    ASSERT(blockAlignment > 0 && (blockAlignment & (blockAlignment - 1)) == 0);
+    ASSERT(blockAlignment <= static_cast<int>(alignof(max_align_t)));
+    ASSERT(blocksPerChunk > 0);
+
+    // free blocks store the next pointer in place
+
+    if (blockAlignment < static_cast<int>(alignof(FreeBlock)))
+        blockAlignment = alignof(FreeBlock);
+
+    if (blockSize < static_cast<int>(sizeof(FreeBlock)))
+        blockSize = sizeof(FreeBlock);
+
+    _blockSize = (blockSize + blockAlignment - 1) & ~(blockAlignment - 1);
+    _chunkHeaderSize = (sizeof(Chunk) + blockAlignment - 1) & ~(blockAlignment - 1);
+}
+
+MemoryPool::~MemoryPool()
+{
+    release();
+}
+
+void MemoryPool::release()
+{
+    while (_chunks)
+    {
+        Chunk* chunk = _chunks;
+        _chunks = chunk->next;
+        Memory::deallocate(chunk);
+    }
+
+    _numBlocks = 0;
+    _numChunks = 0;
+    _freeBlocks = nullptr;
+    _next = _end = nullptr;
+}
+
+void MemoryPool::allocateChunk()
+{
+    byte_t* ptr = Memory::allocate<byte_t>(_chunkHeaderSize + _blockSize * _blocksPerChunk);
+
+    Chunk* chunk = reinterpret_cast<Chunk*>(ptr);
+    chunk->next = _chunks;
+    _chunks = chunk;
+    ++_numChunks;
+
+    _next = ptr + _chunkHeaderSize;
+    _end = _next + _blockSize * _blocksPerChunk;
+}
+
+// Mutex
+
+Mutex::Mutex()
+{
+#ifdef PLATFORM_WINDOWS
+    InitializeCriticalSection(&_mutex);
+#else
+    int rc = pthread_mutex_init(&_mutex, nullptr);
+    ASSERT(rc == 0);
+#endif
+}
+
+Mutex::~Mutex()
+{
+#ifdef PLATFORM_WINDOWS
+    DeleteCriticalSection(&_mutex);
+#else
+    pthread_mutex_destroy(&_mutex);
+#endif
+}
+
+void Mutex::lock()
+{
+#ifdef PLATFORM_WINDOWS
+    EnterCriticalSection(&_mutex);
+#else
+    int rc = pthread_mutex_lock(&_mutex);
+    ASSERT(rc == 0);
+#endif
+}
+
+void Mutex::unlock()
+{
+#ifdef PLATFORM_WINDOWS
+    LeaveCriticalSection(&_mutex);
+#else
+    int rc = pthread_mutex_unlock(&_mutex);
+    ASSERT(rc == 0);
+#endif
+}
+
+// Thread
+
+Thread::Thread() : _func(nullptr), _param(nullptr), _started(false)
+{
+#ifdef PLATFORM_WINDOWS
+    _handle = nullptr;
+#endif
+}
+
+Thread::~Thread()
+{
+    try
+    {
+        join();
+    }
+    catch (Exception& ex)
+    {
+        reportError(ex.message());
+    }
+    catch (...)
+    {
+        reportError(STR("unknown error"));
+    }
+}
+
+void Thread::start(void (*func)(void*), void* param)
+{
+    ASSERT(func);
+
+    if (_started)
+        throw Exception(STR("thread already started"));
+
+    _func = func;
+    _param = param;
+
+#ifdef PLATFORM_WINDOWS
+    _handle = CreateThread(nullptr, 0, threadProc, this, 0, nullptr);
+    if (!_handle)
+#else
+    if (pthread_create(&_thread, nullptr, threadProc, this) != 0)
+#endif
+        throw Exception(STR("failed to start thread"));
+
+    _started = true;
+}
+
+void Thread::join()
+{
+    if (_started)
+    {
+#ifdef PLATFORM_WINDOWS
+        DWORD rc = WaitForSingleObject(_handle, INFINITE);
+        ASSERT(rc == WAIT_OBJECT_0);
+        CloseHandle(_handle);
+        _handle = nullptr;
+#else
+        int rc = pthread_join(_thread, nullptr);
+        ASSERT(rc == 0);
+#endif
+        _started = false;
+    }
+}
+
+int Thread::processorCount()
+{
+#ifdef PLATFORM_WINDOWS
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return max(static_cast<int>(info.dwNumberOfProcessors), 1);
+#else
+    return max(static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN)), 1);
+#endif
+}
+
+#ifdef PLATFORM_WINDOWS
+DWORD WINAPI Thread::threadProc(LPVOID param)
+#else
+void* Thread::threadProc(void* param)
+#endif
+{
+    Thread* thread = static_cast<Thread*>(param);
+
+    try
+    {
+        thread->_func(thread->_param);
+    }
+    catch (Exception& ex)
+    {
+        reportError(ex.message());
+    }
+    catch (...)
+    {
+        reportError(STR("unknown error"));
+    }
+
+#ifdef PLATFORM_WINDOWS
+    return 0;
+#else
+    return nullptr;
+#endif
+}
+
+// read faults
+
+#ifndef PLATFORM_WINDOWS
+
+static thread_local sigjmp_buf* readFaultJump = nullptr;
+static volatile sig_atomic_t readFaultHandlerInstalled = 0;
+static struct sigaction previousSigbusAction;
+
+extern "C" void onSIGBUS(int sig, siginfo_t* info, void* context)
+{
+    sigjmp_buf* jump = readFaultJump;
+
+    if (jump)
+        siglongjmp(*jump, 1);
+
+    // not a guarded read, the access is retried with the previous action
+
+    sigaction(SIGBUS, &previousSigbusAction, nullptr);
+    readFaultHandlerInstalled = 0;
+}
+
+#endif
+
+bool guardedRead(void (*func)(void*), void* param)
+{
+    ASSERT(func);
+
+#ifdef PLATFORM_WINDOWS
+    // Windows doesn't let a mapped file be truncated
+
+    func(param);
+    return true;
+#else
+    sigjmp_buf jump;
+    sigjmp_buf* volatile outerJump = readFaultJump;
+
+    if (sigsetjmp(jump, 1) != 0)
+    {
+        readFaultJump = outerJump;
+        return false;
+    }
+
+    readFaultJump = &jump;
+    func(param);
+    readFaultJump = outerJump;
+
+    return true;
+#endif
+}
+
+void installReadFaultHandler()
+{
+#ifndef PLATFORM_WINDOWS
+    if (!readFaultHandlerInstalled)
+    {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_sigaction = onSIGBUS;
+        action.sa_flags = SA_SIGINFO;
+        sigemptyset(&action.sa_mask);
+
+        int rc = sigaction(SIGBUS, &action, &previousSigbusAction);
+        ASSERT(rc == 0);
+
+        readFaultHandlerInstalled = 1;
+    }
+#endif
 }
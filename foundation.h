@@ -3,6 +3,7 @@
 
 #include <new>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -48,6 +49,12 @@
 
 #endif
 
+// SIMD instructions
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2
+#endif
+
 // platform
 
 #if defined(_WIN32)
@@ -154,12 +161,17 @@
 
 #include <termios.h>
 #include <unistd.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <poll.h>
 #include <signal.h>
+#include <setjmp.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <dirent.h>
+#include <pthread.h>
 
 #endif
 
@@ -457,14 +469,97 @@ inline int hash(double val)
     return hash(*h, *(h + 1));
 }
 
+// 64x64 bit multiplication folded into 64 bits
+
+inline uint64_t hashMultiply(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = static_cast<__uint128_t>(a) * b;
+    return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+#elif defined(COMPILER_VISUAL_CPP) && defined(_M_X64)
+    uint64_t hi, lo = UnsignedMultiply128(a, b, &hi);
+    return lo ^ hi;
+#else
+    uint64_t aHi = a >> 32, aLo = static_cast<uint32_t>(a), bHi = b >> 32, bLo = static_cast<uint32_t>(b);
+    uint64_t mid1 = aHi * bLo, mid2 = aLo * bHi, lo = aLo * bLo;
+    uint64_t t = lo + (mid1 << 32);
+    uint64_t carry = t < lo;
+    lo = t + (mid2 << 32);
+    carry += lo < t;
+    return lo ^ (aHi * bHi + (mid1 >> 32) + (mid2 >> 32) + carry);
+#endif
+}
+
+inline uint64_t hashRead64(const byte_t* p)
+{
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint64_t hashRead32(const byte_t* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// wyhash style hash, reads 8 bytes at a time and handles short keys without a loop
+
+inline int hashBytes(const void* data, int size)
+{
+    ASSERT(size >= 0);
+
+    const uint64_t SECRET0 = 0xa0761d6478bd642full;
+    const uint64_t SECRET1 = 0xe7037ed1a0b428dbull;
+
+    const byte_t* p = static_cast<const byte_t*>(data);
+    uint64_t seed = SECRET0;
+    uint64_t a, b;
+
+    if (size <= 16)
+    {
+        if (size >= 4)
+        {
+            int offset = (size >> 3) << 2;
+            a = (hashRead32(p) << 32) | hashRead32(p + offset);
+            b = (hashRead32(p + size - 4) << 32) | hashRead32(p + size - 4 - offset);
+        }
+        else if (size > 0)
+        {
+            a = (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[size >> 1]) << 8) | p[size - 1];
+            b = 0;
+        }
+        else
+            a = b = 0;
+    }
+    else
+    {
+        int i = size;
+
+        while (i > 16)
+        {
+            seed = hashMultiply(hashRead64(p) ^ SECRET1, hashRead64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+
+        a = hashRead64(p + i - 16);
+        b = hashRead64(p + i - 8);
+    }
+
+    uint64_t h = hashMultiply(SECRET1 ^ static_cast<uint64_t>(size), hashMultiply(a ^ SECRET1, b ^ seed));
+    return static_cast<int>(static_cast<uint32_t>(h ^ (h >> 32)));
+}
+
 inline int hash(const char_t* val)
 {
-    int h = 0;
+    const char_t* end = val;
 
-    while (*val)
-        h = 33 * h + *val++;
+    while (*end)
+        ++end;
 
-    return h;
+    return hashBytes(val, static_cast<int>((end - val) * sizeof(char_t)));
 }
 
 inline int hash(const void* val)
@@ -476,7 +571,7 @@ inline int hash(const void* val)
 template<typename _Type1, typename _Type2>
 inline int hash(const _Type1& val1, const _Type2& val2)
 {
-    return 33 * hash(val1) + hash(val2);
+    return static_cast<int>(33u * static_cast<unsigned>(hash(val1)) + static_cast<unsigned>(hash(val2)));
 }
 
 // Timer
@@ -545,13 +640,164 @@ inline void swapBytes(uint64_t* values, int len)
 
 #define ALLOCATE_STACK(type, size) reinterpret_cast<type*>(alloca(sizeof(type) * (size)))
 
+#ifdef MEMORY_STATISTICS
+
+struct MemoryStatistics
+{
+    int64_t allocations;
+    int64_t bytes;
+    int64_t peakBytes;
+};
+
+// function, file and line of the code that called Memory::allocate/reallocate, filled in
+// by the compiler through a default argument
+
+struct MemoryCaller
+{
+    const char* function;
+    const char* file;
+    int line;
+
+#if defined(COMPILER_GCC) || (defined(COMPILER_CLANG) && COMPILER_VERSION >= 900) || \
+    (defined(COMPILER_VISUAL_CPP) && COMPILER_VERSION >= 1926)
+    static MemoryCaller current(const char* function = __builtin_FUNCTION(), const char* file = __builtin_FILE(),
+        int line = __builtin_LINE())
+    {
+        MemoryCaller caller = { function, file, line };
+        return caller;
+    }
+#else
+    static MemoryCaller current()
+    {
+        MemoryCaller caller = { "", "", 0 };
+        return caller;
+    }
+#endif
+};
+
+// allocations made from one caller for one type within one scope
+
+struct MemorySite
+{
+    const char* function;
+    const char* file;
+    int line;
+    const char* type; // not null terminated
+    int typeLength;
+    const char* scope; // null outside of any Memory::Scope
+    int64_t allocations;
+    int64_t bytes;
+    int64_t totalBytes;
+};
+
+#define MEMORY_CALLER_PARAMETER , const MemoryCaller& caller = MemoryCaller::current()
+#define MEMORY_CALLER_ARGUMENT , caller
+#define MEMORY_SITE_ARGUMENTS(type) , caller, Memory::typeSignature<type>()
+
+#else
+
+#define MEMORY_CALLER_PARAMETER
+#define MEMORY_CALLER_ARGUMENT
+#define MEMORY_SITE_ARGUMENTS(type)
+
+#endif
+
 namespace Memory
 {
 
+#ifdef MEMORY_STATISTICS
+
+// the type name is extracted from the signature when a site is first seen
+
+template<typename _Type>
+inline const char* typeSignature()
+{
+#if defined(COMPILER_VISUAL_CPP)
+    return __FUNCSIG__;
+#elif defined(COMPILER_GCC) || defined(COMPILER_CLANG) || defined(COMPILER_INTEL_CPP)
+    return __PRETTY_FUNCTION__;
+#else
+    return "";
+#endif
+}
+
+void* trackedAllocate(size_t size, const MemoryCaller& caller, const char* type);
+void* trackedReallocate(void* ptr, size_t size, const MemoryCaller& caller, const char* type);
+void trackedDeallocate(void* ptr);
+
+MemoryStatistics statistics();
+void resetPeakBytes();
+
+// copies up to maxSites sites with the most live bytes, returns the number of sites copied
+int sites(MemorySite* sites, int maxSites);
+
+inline void* rawAllocate(size_t size, const MemoryCaller& caller, const char* type)
+{
+    return trackedAllocate(size, caller, type);
+}
+
+inline void* rawReallocate(void* ptr, size_t size, const MemoryCaller& caller, const char* type)
+{
+    return trackedReallocate(ptr, size, caller, type);
+}
+
+inline void rawDeallocate(void* ptr)
+{
+    trackedDeallocate(ptr);
+}
+
+#else
+
+inline void* rawAllocate(size_t size)
+{
+    return malloc(size);
+}
+
+inline void* rawReallocate(void* ptr, size_t size)
+{
+    return realloc(ptr, size);
+}
+
+inline void rawDeallocate(void* ptr)
+{
+    free(ptr);
+}
+
+#endif
+
+// names the operation that allocations on the current thread are made for, so that memory
+// allocated by containers on behalf of different callers is counted at different sites,
+// scopes nest and the innermost one is recorded
+
+class Scope
+{
+public:
+#ifdef MEMORY_STATISTICS
+    explicit Scope(const char* name);
+    ~Scope();
+#else
+    explicit Scope(const char*)
+    {
+    }
+#endif
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+#ifdef MEMORY_STATISTICS
+protected:
+    const char* _prevName;
+#endif
+};
+
 template<typename _Type>
+#ifdef MEMORY_STATISTICS
+inline _Type* allocate(const MemoryCaller& caller = MemoryCaller::current())
+#else
 inline _Type* allocate()
+#endif
 {
-    _Type* ptr = static_cast<_Type*>(malloc(sizeof(_Type)));
+    _Type* ptr = static_cast<_Type*>(rawAllocate(sizeof(_Type) MEMORY_SITE_ARGUMENTS(_Type)));
 
     if (ptr)
         return ptr;
@@ -560,13 +806,13 @@ inline _Type* allocate()
 }
 
 template<typename _Type>
-inline _Type* allocate(int size)
+inline _Type* allocate(int size MEMORY_CALLER_PARAMETER)
 {
     ASSERT(size >= 0);
 
     if (size > 0)
     {
-        _Type* ptr = static_cast<_Type*>(malloc(sizeof(_Type) * size));
+        _Type* ptr = static_cast<_Type*>(rawAllocate(sizeof(_Type) * size MEMORY_SITE_ARGUMENTS(_Type)));
 
         if (ptr)
             return ptr;
@@ -578,13 +824,13 @@ inline _Type* allocate(int size)
 }
 
 template<typename _Type>
-inline _Type* reallocate(_Type* ptr, int size)
+inline _Type* reallocate(_Type* ptr, int size MEMORY_CALLER_PARAMETER)
 {
     ASSERT(size >= 0);
 
     if (size > 0)
     {
-        ptr = static_cast<_Type*>(realloc(ptr, sizeof(_Type) * size));
+        ptr = static_cast<_Type*>(rawReallocate(ptr, sizeof(_Type) * size MEMORY_SITE_ARGUMENTS(_Type)));
 
         if (!ptr)
             throw OutOfMemoryException();
@@ -593,14 +839,14 @@ inline _Type* reallocate(_Type* ptr, int size)
     }
     else
     {
-        free(ptr);
+        rawDeallocate(ptr);
         return nullptr;
     }
 }
 
 inline void deallocate(void* ptr)
 {
-    free(ptr);
+    rawDeallocate(ptr);
 }
 
 template<typename _Type, typename... _Args>
@@ -695,12 +941,12 @@ inline _Type* createArrayFill(int size, int capacity, _Args&&... args)
 }
 
 template<typename _Type>
-inline _Type* createArrayCopy(int size, int capacity, const _Type* values)
+inline _Type* createArrayCopy(int size, int capacity, const _Type* values MEMORY_CALLER_PARAMETER)
 {
     ASSERT(values ? size >= 0 : size == 0);
     ASSERT(capacity >= 0 && size <= capacity);
 
-    _Type* ptr = allocate<_Type>(capacity);
+    _Type* ptr = allocate<_Type>(capacity MEMORY_CALLER_ARGUMENT);
     int i = 0;
 
     try
@@ -718,12 +964,12 @@ inline _Type* createArrayCopy(int size, int capacity, const _Type* values)
 }
 
 template<typename _Type>
-inline _Type* createArrayMove(int size, int capacity, _Type* values)
+inline _Type* createArrayMove(int size, int capacity, _Type* values MEMORY_CALLER_PARAMETER)
 {
     ASSERT(values ? size >= 0 : size == 0);
     ASSERT(capacity >= 0 && size <= capacity);
 
-    _Type* ptr = allocate<_Type>(capacity);
+    _Type* ptr = allocate<_Type>(capacity MEMORY_CALLER_ARGUMENT);
     int i = 0;
 
     try
@@ -1371,6 +1617,9 @@ public:
     friend class ConstStringIterator;
     typedef ConstStringIterator ConstIterator;
 
+    // strings with capacity up to this many chars including the terminator are stored in place
+    static const int INLINE_CAPACITY = 16;
+
 public:
     String() : _length(0), _capacity(0), _chars(nullptr)
     {
@@ -1384,7 +1633,8 @@ public:
 
     ~String()
     {
-        Memory::deallocate(_chars);
+        if (_chars != _buffer)
+            Memory::deallocate(_chars);
     }
 
     String& operator=(const String& other)
@@ -1522,13 +1772,19 @@ public:
         return String(chars);
     }
 
+    static String acquire(char_t* chars, int len, int capacity)
+    {
+        return String(chars, len, capacity);
+    }
+
     char_t* release();
 
     template<typename... _Args>
     static String concat(_Args&&... args)
     {
-        char_t* chars = concatInternal(0, args...);
-        return String(chars);
+        String str;
+        concatInternal(str, 0, args...);
+        return str;
     }
 
     // conversion from string
@@ -1561,73 +1817,84 @@ public:
 
     friend void swap(String& left, String& right)
     {
+        bool leftInline = left._chars == left._buffer;
+        bool rightInline = right._chars == right._buffer;
+
+        if (leftInline || rightInline)
+        {
+            char_t buffer[INLINE_CAPACITY];
+            memcpy(buffer, left._buffer, sizeof(buffer));
+            memcpy(left._buffer, right._buffer, sizeof(buffer));
+            memcpy(right._buffer, buffer, sizeof(buffer));
+        }
+
         swap(left._length, right._length);
         swap(left._capacity, right._capacity);
         swap(left._chars, right._chars);
+
+        if (rightInline)
+            left._chars = left._buffer;
+
+        if (leftInline)
+            right._chars = right._buffer;
     }
 
     friend int hash(const String& val)
     {
-        return hash(val.chars());
+        return hashBytes(val.chars(), static_cast<int>(val._length * sizeof(char_t)));
     }
 
 protected:
     explicit String(char_t* chars);
+    String(char_t* chars, int len, int capacity);
 
     template<typename... _Args>
-    static char_t* concatInternal(int totalLen, const char_t* chars, _Args&&... args)
+    static void concatInternal(String& destStr, int totalLen, const char_t* chars, _Args&&... args)
     {
         int len = strLen(chars);
-        char_t* destChars = concatInternal(totalLen + len, args...);
-        strCopyLen(destChars + totalLen, chars, len);
-        return destChars;
+        concatInternal(destStr, totalLen + len, args...);
+        strCopyLen(destStr._chars + totalLen, chars, len);
     }
 
-    static char_t* concatInternal(int totalLen, const char_t* chars)
+    static void concatInternal(String& destStr, int totalLen, const char_t* chars)
     {
         int len = strLen(chars);
-        char_t* destChars = Memory::allocate<char_t>(totalLen + len + 1);
-        destChars[totalLen + len] = 0;
-        strCopyLen(destChars + totalLen, chars, len);
-        return destChars;
+        destStr.allocateConcat(totalLen + len);
+        strCopyLen(destStr._chars + totalLen, chars, len);
     }
 
     template<typename... _Args>
-    static char_t* concatInternal(int totalLen, const String& str, _Args&&... args)
+    static void concatInternal(String& destStr, int totalLen, const String& str, _Args&&... args)
     {
-        if (str._chars)
-        {
-            int len = strLen(str._chars);
-            char_t* destChars = concatInternal(totalLen + len, args...);
-            strCopyLen(destChars + totalLen, str._chars, len);
-            return destChars;
-        }
-        else
-            return concatInternal(totalLen, args...);
+        concatInternal(destStr, totalLen + str._length, args...);
+        strCopyLen(destStr._chars + totalLen, str.chars(), str._length);
     }
 
-    static char_t* concatInternal(int totalLen, const String& str)
+    static void concatInternal(String& destStr, int totalLen, const String& str)
     {
-        if (str._chars)
-        {
-            int len = strLen(str._chars);
-            char_t* destChars = Memory::allocate<char_t>(totalLen + len + 1);
-            destChars[totalLen + len] = 0;
-            strCopyLen(destChars + totalLen, str._chars, len);
-            return destChars;
-        }
-        else
-        {
-            char_t* destChars = Memory::allocate<char_t>(totalLen + 1);
-            destChars[totalLen] = 0;
-            return destChars;
-        }
+        destStr.allocateConcat(totalLen + str._length);
+        strCopyLen(destStr._chars + totalLen, str.chars(), str._length);
+    }
+
+    char_t* allocateChars(int capacity)
+    {
+        return capacity <= INLINE_CAPACITY ? _buffer : Memory::allocate<char_t>(capacity);
+    }
+
+    void allocateConcat(int len)
+    {
+        ensureCapacity(len + 1);
+        _length = len;
+        _chars[len] = 0;
     }
 
 protected:
     int _length;
     int _capacity;
+
+    // points to _buffer for short strings, so the object can't be moved with memcpy
     char_t* _chars;
+    char_t _buffer[INLINE_CAPACITY];
 };
 
 // string concatenation
@@ -1793,154 +2060,383 @@ int utf16StringLength(const char16_t* str);
 
 #endif
 
-// Unicode
-
-enum TextEncoding
-{
-    TEXT_ENCODING_UTF8,
-    TEXT_ENCODING_UTF16_LE,
-    TEXT_ENCODING_UTF16_BE
-};
-
-struct Unicode
-{
-    static String bytesToString(const ByteBuffer& bytes, TextEncoding& encoding, bool& bom, bool& crLf);
-    static String bytesToString(int size, const byte_t* bytes, TextEncoding& encoding, bool& bom, bool& crLf);
-    static ByteBuffer stringToBytes(const String& str, TextEncoding encoding, bool bom, bool crLf);
-};
-
-// ArrayIterator
-
-template<typename _Type>
-class Array;
+// Searcher
 
-template<typename _Type>
-class ArrayIterator
+class Searcher
 {
 public:
-    ArrayIterator(Array<_Type>& array) : _array(array), _index(-1)
-    {
-    }
+    Searcher();
+    Searcher(const String& pattern, bool caseSensitive = true);
 
-    _Type& value()
+    const String& pattern() const
     {
-        ASSERT(_index >= 0);
-        return _array._values[_index];
+        return _pattern;
     }
 
-    bool moveNext()
+    bool caseSensitive() const
     {
-        if (++_index < _array._size)
-            return true;
-
-        _index = -1;
-        return false;
+        return _caseSensitive;
     }
 
-    bool movePrev()
+    bool empty() const
     {
-        if (_index < 0)
-            _index = _array._size;
+        return _pattern.empty();
+    }
 
-        if (--_index >= 0)
-            return true;
+    void assign(const String& pattern, bool caseSensitive = true);
+    void clear();
 
-        _index = -1;
-        return false;
-    }
+    const char_t* find(const char_t* start, const char_t* end) const;
 
-    void reset()
+protected:
+    static int skipIndex(char_t ch)
     {
-        _index = -1;
+        return static_cast<int>(ch) & 0xff;
     }
 
+    bool matchAt(const char_t* chars) const;
+
+    static char_t foldCase(char_t ch);
+    static char_t otherCase(char_t ch);
+
 protected:
-    Array<_Type>& _array;
-    int _index;
+    String _pattern;
+    Buffer<char_t> _folded;
+    bool _caseSensitive;
+    int _skip[256];
 };
 
-// ConstArrayIterator
+// ConstTextBufferIterator
 
-template<typename _Type>
-class ConstArrayIterator
+class TextBuffer;
+
+class ConstTextBufferIterator
 {
 public:
-    ConstArrayIterator(const Array<_Type>& array) : _array(array), _index(-1)
-    {
-    }
-
-    const _Type& value() const
+    ConstTextBufferIterator(const TextBuffer& text) : _text(text), _pos(INVALID_POSITION)
     {
-        ASSERT(_index >= 0);
-        return _array._values[_index];
     }
 
-    bool moveNext()
-    {
-        if (++_index < _array._size)
-            return true;
-
-        _index = -1;
-        return false;
-    }
+    unichar_t value() const;
+    bool moveNext();
+    bool movePrev();
 
-    bool movePrev()
+    int position() const
     {
-        if (_index < 0)
-            _index = _array._size;
-
-        if (--_index >= 0)
-            return true;
-
-        _index = -1;
-        return false;
+        return _pos;
     }
 
     void reset()
     {
-        _index = -1;
+        _pos = INVALID_POSITION;
     }
 
-protected:
-    const Array<_Type>& _array;
-    int _index;
+private:
+    const TextBuffer& _text;
+    int _pos;
 };
 
-// Array
+// TextBuffer
 
-template<typename _Type>
-class Array
+class TextBuffer
 {
 public:
-    template<typename>
-    friend class ArrayIterator;
-
-    template<typename>
-    friend class ConstArrayIterator;
-
-    typedef ArrayIterator<_Type> Iterator;
-    typedef ConstArrayIterator<_Type> ConstIterator;
+    friend class ConstTextBufferIterator;
+    typedef ConstTextBufferIterator ConstIterator;
 
 public:
-    Array() : _size(0), _capacity(0), _values(nullptr)
+    TextBuffer() :
+        _capacity(0), _gapStart(0), _gapEnd(0), _chars(nullptr), _lineCapacity(0), _lineGapStart(0), _lineGapEnd(0),
+        _lineEnds(nullptr)
     {
     }
 
-    Array(int size)
-    {
-        ASSERT(size >= 0);
+    TextBuffer(const TextBuffer& other);
+    TextBuffer(const String& str);
+    TextBuffer(TextBuffer&& other);
 
-        _size = size;
-        _capacity = size;
-        _values = Memory::createArrayFill<_Type>(size, size);
+    ~TextBuffer()
+    {
+        Memory::deallocate(_chars);
+        Memory::deallocate(_lineEnds);
     }
 
-    Array(int size, const _Type& value)
+    TextBuffer& operator=(const TextBuffer& other)
     {
-        ASSERT(size >= 0);
+        TextBuffer tmp(other);
+        swap(*this, tmp);
+        return *this;
+    }
 
-        _size = size;
-        _capacity = size;
+    TextBuffer& operator=(TextBuffer&& other)
+    {
+        TextBuffer tmp(static_cast<TextBuffer&&>(other));
+        swap(*this, tmp);
+        return *this;
+    }
+
+    int length() const
+    {
+        return _capacity - (_gapEnd - _gapStart);
+    }
+
+    bool empty() const
+    {
+        return length() == 0;
+    }
+
+    const char_t* chars() const;
+
+    const char_t* chunk(int pos, int& len) const
+    {
+        ASSERT(pos >= 0 && pos <= length());
+        len = pos < _gapStart ? _gapStart - pos : length() - pos;
+        return charPointer(pos);
+    }
+
+    ConstIterator constIterator() const
+    {
+        return ConstIterator(*this);
+    }
+
+    unichar_t charAt(int pos) const
+    {
+        ASSERT(pos >= 0 && pos <= length());
+        return pos < length() ? UTF_CHAR_AT(charPointer(pos)) : 0;
+    }
+
+    int charForward(int pos, int n = 1) const;
+    int charBack(int pos, int n = 1) const;
+
+    int lineCount() const
+    {
+        return _lineCapacity - (_lineGapEnd - _lineGapStart) + 1;
+    }
+
+    int lineStart(int line) const;
+    int lineEnd(int line) const;
+    int lineAt(int pos) const;
+
+    String substr(int pos, int len = -1) const;
+
+    int find(const String& str, bool caseSensitive = true, int pos = 0) const;
+    int find(const Searcher& searcher, int pos = 0, int end = -1) const;
+    bool startsWith(const char_t* chars, bool caseSensitive = true) const;
+
+    void ensureCapacity(int capacity);
+
+    void assign(const String& str);
+    void assign(String&& str);
+
+    void insert(int pos, const String& str);
+    void insert(int pos, const char_t* chars, int len = -1);
+    void insert(int pos, unichar_t ch, int n = 1);
+
+    void erase(int pos, int len = -1);
+
+    void replace(int pos, const String& str, int len = -1);
+    void replace(int pos, const char_t* chars, int len = -1);
+    void replaceString(const String& searchStr, const String& replaceStr, bool caseSensitive = true);
+    void replaceString(const Searcher& searcher, const String& replaceStr);
+
+    void clear();
+
+    friend void swap(TextBuffer& left, TextBuffer& right)
+    {
+        swap(left._capacity, right._capacity);
+        swap(left._gapStart, right._gapStart);
+        swap(left._gapEnd, right._gapEnd);
+        swap(left._chars, right._chars);
+        swap(left._lineCapacity, right._lineCapacity);
+        swap(left._lineGapStart, right._lineGapStart);
+        swap(left._lineGapEnd, right._lineGapEnd);
+        swap(left._lineEnds, right._lineEnds);
+    }
+
+protected:
+    const char_t* charPointer(int pos) const
+    {
+        return _chars + (pos < _gapStart ? pos : pos + _gapEnd - _gapStart);
+    }
+
+    int lineEndAt(int index) const
+    {
+        return index < _lineGapStart ? _lineEnds[index] : length() - _lineEnds[index + _lineGapEnd - _lineGapStart];
+    }
+
+    char_t* insertGap(int pos, int len);
+    void moveGap(int pos) const;
+
+    void addLineEnds(int pos, int len);
+    void removeLineEnds(int pos, int len);
+    void moveLineGap(int pos);
+    void indexLines();
+
+protected:
+    int _capacity;
+    mutable int _gapStart, _gapEnd;
+    char_t* _chars;
+
+    int _lineCapacity;
+    int _lineGapStart, _lineGapEnd;
+    int* _lineEnds;
+};
+
+// Unicode
+
+enum TextEncoding
+{
+    TEXT_ENCODING_UTF8,
+    TEXT_ENCODING_UTF16_LE,
+    TEXT_ENCODING_UTF16_BE
+};
+
+struct Unicode
+{
+    static String bytesToString(const ByteBuffer& bytes, TextEncoding& encoding, bool& bom, bool& crLf);
+    // only the first limit bytes after the BOM are decoded, cut back to where a character starts
+    static String bytesToString(int size, const byte_t* bytes, TextEncoding& encoding, bool& bom, bool& crLf,
+                                int limit = INT_MAX);
+    static ByteBuffer stringToBytes(const String& str, TextEncoding encoding, bool bom, bool crLf);
+    static ByteBuffer stringToBytes(int length, const char_t* chars, TextEncoding encoding, bool bom, bool crLf);
+
+    static int byteOrderMark(TextEncoding encoding, byte_t* bytes);
+    static int charsToBytes(const char_t*& chars, const char_t* end, TextEncoding encoding, bool crLf,
+                            byte_t* bytes, int size);
+};
+
+// ArrayIterator
+
+template<typename _Type>
+class Array;
+
+template<typename _Type>
+class ArrayIterator
+{
+public:
+    ArrayIterator(Array<_Type>& array) : _array(array), _index(-1)
+    {
+    }
+
+    _Type& value()
+    {
+        ASSERT(_index >= 0);
+        return _array._values[_index];
+    }
+
+    bool moveNext()
+    {
+        if (++_index < _array._size)
+            return true;
+
+        _index = -1;
+        return false;
+    }
+
+    bool movePrev()
+    {
+        if (_index < 0)
+            _index = _array._size;
+
+        if (--_index >= 0)
+            return true;
+
+        _index = -1;
+        return false;
+    }
+
+    void reset()
+    {
+        _index = -1;
+    }
+
+protected:
+    Array<_Type>& _array;
+    int _index;
+};
+
+// ConstArrayIterator
+
+template<typename _Type>
+class ConstArrayIterator
+{
+public:
+    ConstArrayIterator(const Array<_Type>& array) : _array(array), _index(-1)
+    {
+    }
+
+    const _Type& value() const
+    {
+        ASSERT(_index >= 0);
+        return _array._values[_index];
+    }
+
+    bool moveNext()
+    {
+        if (++_index < _array._size)
+            return true;
+
+        _index = -1;
+        return false;
+    }
+
+    bool movePrev()
+    {
+        if (_index < 0)
+            _index = _array._size;
+
+        if (--_index >= 0)
+            return true;
+
+        _index = -1;
+        return false;
+    }
+
+    void reset()
+    {
+        _index = -1;
+    }
+
+protected:
+    const Array<_Type>& _array;
+    int _index;
+};
+
+// Array
+
+template<typename _Type>
+class Array
+{
+public:
+    template<typename>
+    friend class ArrayIterator;
+
+    template<typename>
+    friend class ConstArrayIterator;
+
+    typedef ArrayIterator<_Type> Iterator;
+    typedef ConstArrayIterator<_Type> ConstIterator;
+
+public:
+    Array() : _size(0), _capacity(0), _values(nullptr)
+    {
+    }
+
+    Array(int size)
+    {
+        ASSERT(size >= 0);
+
+        _size = size;
+        _capacity = size;
+        _values = Memory::createArrayFill<_Type>(size, size);
+    }
+
+    Array(int size, const _Type& value)
+    {
+        ASSERT(size >= 0);
+
+        _size = size;
+        _capacity = size;
         _values = Memory::createArrayFill<_Type>(size, size, value);
     }
 
@@ -2354,55 +2850,185 @@ protected:
     _Type* _values;
 };
 
-// ListNode
+// MemoryPool
 
-template<typename _Type>
-struct ListNode
+// fixed size blocks carved from chunks of blocksPerChunk blocks, freed blocks are reused from a
+// free list and chunks go back to the heap all at once in release() or the destructor, in arena
+// mode freed blocks aren't reused which suits containers thrown away together with their pool,
+// not thread safe
+
+const int DEFAULT_BLOCKS_PER_CHUNK = 64;
+
+class MemoryPool
 {
-    _Type value;
-    ListNode<_Type>* prev;
-    ListNode<_Type>* next;
+public:
+    MemoryPool(int blockSize, int blockAlignment, int blocksPerChunk = DEFAULT_BLOCKS_PER_CHUNK, bool arena = false);
 
-    ListNode(const _Type& value, ListNode<_Type>* prev, ListNode<_Type>* next) : value(value), prev(prev), next(next)
+    MemoryPool(const MemoryPool&) = delete;
+    MemoryPool& operator=(const MemoryPool&) = delete;
+
+    ~MemoryPool();
+
+    int blockSize() const
     {
+        return _blockSize;
     }
 
-    ListNode(_Type&& value, ListNode<_Type>* prev, ListNode<_Type>* next) :
-        value(static_cast<_Type&&>(value)), prev(prev), next(next)
+    int blocksPerChunk() const
     {
+        return _blocksPerChunk;
     }
-};
-
-// ListIterator
-
-template<typename _Type>
-class List;
 
-template<typename _Type>
-class ListIterator
-{
-public:
-    ListIterator(List<_Type>& list) : _list(list), _node(nullptr)
+    bool arena() const
     {
+        return _arena;
     }
 
-    _Type& value()
+    int numBlocks() const
     {
-        ASSERT(_node);
-        return _node->value;
+        return _numBlocks;
     }
 
-    bool moveNext()
+    int numChunks() const
     {
-        if (_node)
-            _node = _node->next;
-        else
-            _node = _list.first();
-
-        return _node != nullptr;
+        return _numChunks;
     }
 
-    bool movePrev()
+    void* allocate()
+    {
+        if (_freeBlocks)
+        {
+            FreeBlock* block = _freeBlocks;
+            _freeBlocks = block->next;
+            ++_numBlocks;
+            return block;
+        }
+
+        if (_next == _end)
+            allocateChunk();
+
+        byte_t* block = _next;
+        _next += _blockSize;
+        ++_numBlocks;
+        return block;
+    }
+
+    void deallocate(void* block)
+    {
+        if (block)
+        {
+            ASSERT(_numBlocks > 0);
+            --_numBlocks;
+
+            if (!_arena)
+            {
+                FreeBlock* freeBlock = static_cast<FreeBlock*>(block);
+                freeBlock->next = _freeBlocks;
+                _freeBlocks = freeBlock;
+            }
+        }
+    }
+
+    void release();
+
+protected:
+    struct Chunk
+    {
+        Chunk* next;
+    };
+
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    void allocateChunk();
+
+protected:
+    int _blockSize;
+    int _blocksPerChunk;
+    int _chunkHeaderSize;
+    bool _arena;
+    int _numBlocks;
+    int _numChunks;
+    Chunk* _chunks;
+    FreeBlock* _freeBlocks;
+    byte_t* _next;
+    byte_t* _end;
+};
+
+// NodePool
+
+template<typename _Node>
+class NodePool : public MemoryPool
+{
+public:
+    NodePool(int blocksPerChunk = DEFAULT_BLOCKS_PER_CHUNK, bool arena = false) :
+        MemoryPool(sizeof(_Node), alignof(_Node), blocksPerChunk, arena)
+    {
+    }
+
+    _Node* allocate()
+    {
+        return static_cast<_Node*>(MemoryPool::allocate());
+    }
+};
+
+// ListNode
+
+template<typename _Type>
+struct ListNode
+{
+    _Type value;
+    ListNode<_Type>* prev;
+    ListNode<_Type>* next;
+
+    ListNode(const _Type& value, ListNode<_Type>* prev, ListNode<_Type>* next) : value(value), prev(prev), next(next)
+    {
+    }
+
+    ListNode(_Type&& value, ListNode<_Type>* prev, ListNode<_Type>* next) :
+        value(static_cast<_Type&&>(value)), prev(prev), next(next)
+    {
+    }
+
+    template<typename... _Args>
+    ListNode(ListNode<_Type>* prev, ListNode<_Type>* next, _Args&&... args) :
+        value(static_cast<_Args&&>(args)...), prev(prev), next(next)
+    {
+    }
+};
+
+// ListIterator
+
+template<typename _Type>
+class List;
+
+template<typename _Type>
+class ListIterator
+{
+public:
+    ListIterator(List<_Type>& list) : _list(list), _node(nullptr)
+    {
+    }
+
+    _Type& value()
+    {
+        ASSERT(_node);
+        return _node->value;
+    }
+
+    bool moveNext()
+    {
+        if (_node)
+            _node = _node->next;
+        else
+            _node = _list.first();
+
+        return _node != nullptr;
+    }
+
+    bool movePrev()
     {
         if (_node)
             _node = _node->prev;
@@ -2482,13 +3108,18 @@ public:
 
     typedef ListIterator<_Type> Iterator;
     typedef ConstListIterator<_Type> ConstIterator;
+    typedef NodePool<ListNode<_Type>> Pool;
 
 public:
-    List() : _first(nullptr), _last(nullptr)
+    List() : _first(nullptr), _last(nullptr), _pool(nullptr)
+    {
+    }
+
+    List(Pool* pool) : _first(nullptr), _last(nullptr), _pool(pool)
     {
     }
 
-    List(int size) : _first(nullptr), _last(nullptr)
+    List(int size) : _first(nullptr), _last(nullptr), _pool(nullptr)
     {
         ASSERT(size >= 0);
 
@@ -2504,7 +3135,7 @@ public:
         }
     }
 
-    List(int size, const _Type& value) : _first(nullptr), _last(nullptr)
+    List(int size, const _Type& value) : _first(nullptr), _last(nullptr), _pool(nullptr)
     {
         ASSERT(size >= 0);
 
@@ -2520,7 +3151,7 @@ public:
         }
     }
 
-    List(int size, const _Type* values) : _first(nullptr), _last(nullptr)
+    List(int size, const _Type* values) : _first(nullptr), _last(nullptr), _pool(nullptr)
     {
         ASSERT(values ? size >= 0 : size == 0);
 
@@ -2536,7 +3167,7 @@ public:
         }
     }
 
-    List(const List<_Type>& other) : _first(nullptr), _last(nullptr)
+    List(const List<_Type>& other) : _first(nullptr), _last(nullptr), _pool(nullptr)
     {
         try
         {
@@ -2554,6 +3185,7 @@ public:
     {
         _first = other._first;
         _last = other._last;
+        _pool = other._pool;
         other._first = nullptr;
         other._last = nullptr;
     }
@@ -2611,6 +3243,17 @@ public:
         return _last;
     }
 
+    Pool* pool() const
+    {
+        return _pool;
+    }
+
+    void pool(Pool* pool)
+    {
+        ASSERT(!_first);
+        _pool = pool;
+    }
+
     Iterator iterator()
     {
         return Iterator(*this);
@@ -2641,13 +3284,23 @@ public:
 
     void assign(int size, const _Type& value)
     {
-        List<_Type> tmp(size, value);
+        ASSERT(size >= 0);
+
+        List<_Type> tmp(_pool);
+        for (int i = 0; i < size; ++i)
+            tmp.addLast(value);
+
         swap(*this, tmp);
     }
 
     void assign(int size, const _Type* values)
     {
-        List<_Type> tmp(size, values);
+        ASSERT(values ? size >= 0 : size == 0);
+
+        List<_Type> tmp(_pool);
+        for (int i = 0; i < size; ++i)
+            tmp.addLast(values[i]);
+
         swap(*this, tmp);
     }
 
@@ -2669,7 +3322,7 @@ public:
         else
             _last = nullptr;
 
-        Memory::destroy(node);
+        destroyListNode(node);
     }
 
     void removeLast()
@@ -2684,7 +3337,7 @@ public:
         else
             _first = nullptr;
 
-        Memory::destroy(node);
+        destroyListNode(node);
     }
 
     void addFirst(const _Type& value)
@@ -2747,6 +3400,34 @@ public:
         }
     }
 
+    template<typename... _Args>
+    ListNode<_Type>* emplaceFirst(_Args&&... args)
+    {
+        auto node = emplaceListNode(nullptr, _first, static_cast<_Args&&>(args)...);
+
+        if (_first)
+            _first->prev = node;
+        else
+            _last = node;
+
+        _first = node;
+        return node;
+    }
+
+    template<typename... _Args>
+    ListNode<_Type>* emplaceLast(_Args&&... args)
+    {
+        auto node = emplaceListNode(_last, nullptr, static_cast<_Args&&>(args)...);
+
+        if (_last)
+            _last->next = node;
+        else
+            _first = node;
+
+        _last = node;
+        return node;
+    }
+
     ListNode<_Type>* insertBefore(ListNode<_Type>* pos, const _Type& value)
     {
         ASSERT(pos);
@@ -2821,7 +3502,7 @@ public:
         else
             _last = pos->prev;
 
-        Memory::destroy(pos);
+        destroyListNode(pos);
     }
 
     void clear()
@@ -2834,12 +3515,13 @@ public:
     {
         swap(left._first, right._first);
         swap(left._last, right._last);
+        swap(left._pool, right._pool);
     }
 
 protected:
     ListNode<_Type>* createListNode(const _Type& value, ListNode<_Type>* prev, ListNode<_Type>* next)
     {
-        auto ptr = Memory::allocate<ListNode<_Type>>();
+        auto ptr = allocateListNode();
 
         try
         {
@@ -2847,7 +3529,7 @@ protected:
         }
         catch (...)
         {
-            Memory::deallocate(ptr);
+            deallocateListNode(ptr);
             throw;
         }
 
@@ -2856,7 +3538,7 @@ protected:
 
     ListNode<_Type>* createListNode(_Type&& value, ListNode<_Type>* prev, ListNode<_Type>* next)
     {
-        auto ptr = Memory::allocate<ListNode<_Type>>();
+        auto ptr = allocateListNode();
 
         try
         {
@@ -2864,26 +3546,67 @@ protected:
         }
         catch (...)
         {
-            Memory::deallocate(ptr);
+            deallocateListNode(ptr);
+            throw;
+        }
+
+        return ptr;
+    }
+
+    template<typename... _Args>
+    ListNode<_Type>* emplaceListNode(ListNode<_Type>* prev, ListNode<_Type>* next, _Args&&... args)
+    {
+        auto ptr = allocateListNode();
+
+        try
+        {
+            ::new (ptr) ListNode<_Type>(prev, next, static_cast<_Args&&>(args)...);
+        }
+        catch (...)
+        {
+            deallocateListNode(ptr);
             throw;
         }
 
         return ptr;
     }
 
+    ListNode<_Type>* allocateListNode()
+    {
+        if (_pool)
+            return _pool->allocate();
+        else
+            return Memory::allocate<ListNode<_Type>>();
+    }
+
+    void deallocateListNode(ListNode<_Type>* node)
+    {
+        if (_pool)
+            _pool->deallocate(node);
+        else
+            Memory::deallocate(node);
+    }
+
+    void destroyListNode(ListNode<_Type>* node)
+    {
+        Memory::destruct(node);
+        deallocateListNode(node);
+    }
+
     void destroyNodes()
     {
         for (auto node = _first; node;)
         {
             auto n = node;
             node = node->next;
-            Memory::destroy(n);
+            destroyListNode(n);
         }
     }
 
 protected:
     ListNode<_Type>* _first;
     ListNode<_Type>* _last;
+    Pool* _pool;
 };
 
 // KeyValue
@@ -3065,15 +3788,24 @@ public:
 
     typedef MapIterator<_Key, _Value> Iterator;
     typedef ConstMapIterator<_Key, _Value> ConstIterator;
+    typedef typename List<KeyValue<_Key, _Value>>::Pool Pool;
 
 public:
-    Map(int numBuckets = 0) : _keyValues(numBuckets), _size(0), _maxLoadFactor(0.75f)
+    Map(int numBuckets = 0) : _keyValues(numBuckets), _size(0), _maxLoadFactor(0.75f), _pool(nullptr)
     {
         ASSERT(numBuckets >= 0);
     }
 
+    Map(Pool* pool, int numBuckets = 0) : _keyValues(numBuckets), _size(0), _maxLoadFactor(0.75f), _pool(pool)
+    {
+        ASSERT(numBuckets >= 0);
+
+        for (int i = 0; i < _keyValues.size(); ++i)
+            _keyValues[i].pool(pool);
+    }
+
     Map(const Map<_Key, _Value>& other) :
-        _keyValues(other._keyValues), _size(other._size), _maxLoadFactor(other._maxLoadFactor)
+        _keyValues(other._keyValues), _size(other._size), _maxLoadFactor(other._maxLoadFactor), _pool(nullptr)
     {
     }
 
@@ -3082,6 +3814,7 @@ public:
         _size = other._size;
         other._size = 0;
         _maxLoadFactor = other._maxLoadFactor;
+        _pool = other._pool;
     }
 
     _Value& operator[](const _Key& key)
@@ -3143,6 +3876,11 @@ public:
         _maxLoadFactor = loadFactor;
     }
 
+    Pool* pool() const
+    {
+        return _pool;
+    }
+
     Iterator iterator()
     {
         return Iterator(*this);
@@ -3309,7 +4047,7 @@ public:
     {
         ASSERT(numBuckets >= 0);
 
-        Map<_Key, _Value> tmp(numBuckets);
+        Map<_Key, _Value> tmp(_pool, numBuckets);
 
         for (int i = 0; i < _keyValues.size(); ++i)
         {
@@ -3324,6 +4062,7 @@ public:
     {
         swap(left._keyValues, right._keyValues);
         swap(left._size, right._size);
+        swap(left._pool, right._pool);
     }
 
 protected:
@@ -3347,6 +4086,7 @@ protected:
     Array<List<KeyValue<_Key, _Value>>> _keyValues;
     int _size;
     float _maxLoadFactor;
+    Pool* _pool;
 };
 
 // ConstSetIterator
@@ -3426,14 +4166,24 @@ public:
     friend class ConstSetIterator;
 
     typedef ConstSetIterator<_Type> ConstIterator;
+    typedef typename List<_Type>::Pool Pool;
 
 public:
-    Set(int numBuckets = 0) : _values(numBuckets), _size(0), _maxLoadFactor(0.75f)
+    Set(int numBuckets = 0) : _values(numBuckets), _size(0), _maxLoadFactor(0.75f), _pool(nullptr)
+    {
+        ASSERT(numBuckets >= 0);
+    }
+
+    Set(Pool* pool, int numBuckets = 0) : _values(numBuckets), _size(0), _maxLoadFactor(0.75f), _pool(pool)
     {
         ASSERT(numBuckets >= 0);
+
+        for (int i = 0; i < _values.size(); ++i)
+            _values[i].pool(pool);
     }
 
-    Set(const Set<_Type>& other) : _values(other._values), _size(other._size), _maxLoadFactor(other._maxLoadFactor)
+    Set(const Set<_Type>& other) :
+        _values(other._values), _size(other._size), _maxLoadFactor(other._maxLoadFactor), _pool(nullptr)
     {
     }
 
@@ -3442,6 +4192,7 @@ public:
         _size = other._size;
         other._size = 0;
         _maxLoadFactor = other._maxLoadFactor;
+        _pool = other._pool;
     }
 
     Set<_Type>& operator=(const Set<_Type>& other)
@@ -3493,14 +4244,22 @@ public:
         _maxLoadFactor = loadFactor;
     }
 
-    bool contains(const _Type& value) const
+    Pool* pool() const
     {
-        auto& bucket = getBucket(value);
+        return _pool;
+    }
 
-        for (auto node = bucket.first(); node; node = node->next)
+    bool contains(const _Type& value) const
+    {
+        if (!_values.empty())
         {
-            if (node->value == value)
-                return true;
+            auto& bucket = getBucket(value);
+
+            for (auto node = bucket.first(); node; node = node->next)
+            {
+                if (node->value == value)
+                    return true;
+            }
         }
 
         return false;
@@ -3566,15 +4325,18 @@ public:
 
     bool remove(const _Type& value)
     {
-        auto& bucket = getBucket(value);
-
-        for (auto node = bucket.first(); node; node = node->next)
+        if (!_values.empty())
         {
-            if (node->value == value)
+            auto& bucket = getBucket(value);
+
+            for (auto node = bucket.first(); node; node = node->next)
             {
-                bucket.remove(node);
-                --_size;
-                return true;
+                if (node->value == value)
+                {
+                    bucket.remove(node);
+                    --_size;
+                    return true;
+                }
             }
         }
 
@@ -3591,7 +4353,7 @@ public:
     {
         ASSERT(numBuckets >= 0);
 
-        Set<_Type> tmp(numBuckets);
+        Set<_Type> tmp(_pool, numBuckets);
 
         for (int i = 0; i < _values.size(); ++i)
         {
@@ -3606,6 +4368,7 @@ public:
     {
         swap(left._values, right._values);
         swap(left._size, right._size);
+        swap(left._pool, right._pool);
     }
 
 protected:
@@ -3629,6 +4392,996 @@ protected:
     Array<List<_Type>> _values;
     int _size;
     float _maxLoadFactor;
+    Pool* _pool;
+};
+
+// flatHash
+
+inline uint32_t flatHash(int h)
+{
+    uint32_t value = static_cast<uint32_t>(h) * 0x9e3779b1u;
+
+    // zero marks an empty slot so the top bit is always set, bucket index uses low bits
+    return (value ^ (value >> 16)) | 0x80000000u;
+}
+
+// FlatBucket
+
+template<typename _Type>
+struct FlatBucket
+{
+    // zero for an empty bucket, the value is constructed only when the bucket is used
+    uint32_t hash;
+    alignas(_Type) char storage[sizeof(_Type)];
+
+    _Type* ptr()
+    {
+        return reinterpret_cast<_Type*>(storage);
+    }
+
+    _Type& value()
+    {
+        return *reinterpret_cast<_Type*>(storage);
+    }
+
+    const _Type& value() const
+    {
+        return *reinterpret_cast<const _Type*>(storage);
+    }
+};
+
+// FlatMapIterator
+
+template<typename _Key, typename _Value>
+class FlatMap;
+
+template<typename _Key, typename _Value>
+class FlatMapIterator
+{
+public:
+    FlatMapIterator(FlatMap<_Key, _Value>& map) : _map(map), _index(-1)
+    {
+    }
+
+    KeyValue<_Key, _Value>& value()
+    {
+        ASSERT(_index >= 0);
+        return _map._buckets[_index].value();
+    }
+
+    bool moveNext()
+    {
+        for (++_index; _index < _map._numBuckets; ++_index)
+        {
+            if (_map._buckets[_index].hash)
+                return true;
+        }
+
+        _index = -1;
+        return false;
+    }
+
+    void reset()
+    {
+        _index = -1;
+    }
+
+protected:
+    FlatMap<_Key, _Value>& _map;
+    int _index;
 };
 
+// ConstFlatMapIterator
+
+template<typename _Key, typename _Value>
+class ConstFlatMapIterator
+{
+public:
+    ConstFlatMapIterator(const FlatMap<_Key, _Value>& map) : _map(map), _index(-1)
+    {
+    }
+
+    const KeyValue<_Key, _Value>& value() const
+    {
+        ASSERT(_index >= 0);
+        return _map._buckets[_index].value();
+    }
+
+    bool moveNext()
+    {
+        for (++_index; _index < _map._numBuckets; ++_index)
+        {
+            if (_map._buckets[_index].hash)
+                return true;
+        }
+
+        _index = -1;
+        return false;
+    }
+
+    void reset()
+    {
+        _index = -1;
+    }
+
+protected:
+    const FlatMap<_Key, _Value>& _map;
+    int _index;
+};
+
+// FlatMap
+
+// open addressing with robin hood linear probing, entries are kept next to their hashes in a
+// power of two number of buckets and removal shifts the following entries back instead of
+// leaving tombstones, adding or removing entries invalidates pointers to values
+
+template<typename _Key, typename _Value>
+class FlatMap
+{
+public:
+    template<typename, typename>
+    friend class FlatMapIterator;
+
+    template<typename, typename>
+    friend class ConstFlatMapIterator;
+
+    typedef FlatMapIterator<_Key, _Value> Iterator;
+    typedef ConstFlatMapIterator<_Key, _Value> ConstIterator;
+
+public:
+    FlatMap(int numBuckets = 0) :
+        _buckets(nullptr), _numBuckets(0), _size(0), _maxLoadFactor(0.875f)
+    {
+        ASSERT(numBuckets >= 0);
+
+        if (numBuckets > 0)
+            allocateBuckets(roundNumBuckets(numBuckets));
+    }
+
+    FlatMap(const FlatMap<_Key, _Value>& other) :
+        _buckets(nullptr), _numBuckets(0), _size(0), _maxLoadFactor(other._maxLoadFactor)
+    {
+        if (other._numBuckets > 0)
+        {
+            allocateBuckets(other._numBuckets);
+
+            for (int i = 0; i < _numBuckets; ++i)
+            {
+                if (other._buckets[i].hash)
+                {
+                    Memory::construct(_buckets[i].ptr(), other._buckets[i].value());
+                    _buckets[i].hash = other._buckets[i].hash;
+                    ++_size;
+                }
+            }
+        }
+    }
+
+    FlatMap(FlatMap<_Key, _Value>&& other) :
+        _buckets(other._buckets), _numBuckets(other._numBuckets),
+        _size(other._size), _maxLoadFactor(other._maxLoadFactor)
+    {
+        other._buckets = nullptr;
+        other._numBuckets = 0;
+        other._size = 0;
+    }
+
+    ~FlatMap()
+    {
+        destroyBuckets();
+    }
+
+    _Value& operator[](const _Key& key)
+    {
+        return value(key);
+    }
+
+    _Value& operator[](_Key&& key)
+    {
+        return value(static_cast<_Key&&>(key));
+    }
+
+    const _Value& operator[](const _Key& key) const
+    {
+        return value(key);
+    }
+
+    FlatMap<_Key, _Value>& operator=(const FlatMap<_Key, _Value>& other)
+    {
+        assign(other);
+        return *this;
+    }
+
+    FlatMap<_Key, _Value>& operator=(FlatMap<_Key, _Value>&& other)
+    {
+        FlatMap<_Key, _Value> tmp(static_cast<FlatMap<_Key, _Value>&&>(other));
+        swap(*this, tmp);
+        return *this;
+    }
+
+    int size() const
+    {
+        return _size;
+    }
+
+    int numBuckets() const
+    {
+        return _numBuckets;
+    }
+
+    bool empty() const
+    {
+        return _size == 0;
+    }
+
+    float loadFactor() const
+    {
+        return static_cast<float>(_size) / _numBuckets;
+    }
+
+    float maxLoadFactor() const
+    {
+        return _maxLoadFactor;
+    }
+
+    void maxLoadFactor(float loadFactor)
+    {
+        ASSERT(loadFactor > 0 && loadFactor < 1);
+        _maxLoadFactor = loadFactor;
+    }
+
+    Iterator iterator()
+    {
+        return Iterator(*this);
+    }
+
+    ConstIterator constIterator() const
+    {
+        return ConstIterator(*this);
+    }
+
+    _Value& value(const _Key& key)
+    {
+        uint32_t h = flatHash(hash(key));
+        int index = findIndex(key, h);
+
+        if (index < 0)
+        {
+            index = insertBucket(h);
+            constructBucket(index, key);
+        }
+
+        return _buckets[index].value().value;
+    }
+
+    _Value& value(_Key&& key)
+    {
+        uint32_t h = flatHash(hash(key));
+        int index = findIndex(key, h);
+
+        if (index < 0)
+        {
+            index = insertBucket(h);
+            constructBucket(index, static_cast<_Key&&>(key));
+        }
+
+        return _buckets[index].value().value;
+    }
+
+    const _Value& value(const _Key& key) const
+    {
+        const _Value* value = find(key);
+        if (value)
+            return *value;
+        else
+            throw Exception(STR("not found"));
+    }
+
+    _Value* find(const _Key& key)
+    {
+        int index = findIndex(key, flatHash(hash(key)));
+        return index >= 0 ? &_buckets[index].value().value : nullptr;
+    }
+
+    const _Value* find(const _Key& key) const
+    {
+        int index = findIndex(key, flatHash(hash(key)));
+        return index >= 0 ? &_buckets[index].value().value : nullptr;
+    }
+
+    void assign(const FlatMap<_Key, _Value>& other)
+    {
+        FlatMap<_Key, _Value> tmp(other);
+        swap(*this, tmp);
+    }
+
+    void add(const _Key& key, const _Value& value)
+    {
+        uint32_t h = flatHash(hash(key));
+        int index = findIndex(key, h);
+
+        if (index >= 0)
+            _buckets[index].value().value = value;
+        else
+        {
+            index = insertBucket(h);
+            constructBucket(index, key, value);
+        }
+    }
+
+    void add(_Key&& key, _Value&& value)
+    {
+        uint32_t h = flatHash(hash(key));
+        int index = findIndex(key, h);
+
+        if (index >= 0)
+            _buckets[index].value().value = static_cast<_Value&&>(value);
+        else
+        {
+            index = insertBucket(h);
+            constructBucket(index, static_cast<_Key&&>(key), static_cast<_Value&&>(value));
+        }
+    }
+
+    bool remove(const _Key& key)
+    {
+        int index = findIndex(key, flatHash(hash(key)));
+
+        if (index >= 0)
+        {
+            Memory::destruct(_buckets[index].ptr());
+            removeBucket(index);
+            return true;
+        }
+
+        return false;
+    }
+
+    void clear()
+    {
+        destroyBuckets();
+        _buckets = nullptr;
+        _numBuckets = 0;
+        _size = 0;
+    }
+
+    void rehash(int numBuckets)
+    {
+        ASSERT(numBuckets >= 0);
+
+        int minBuckets = _size > 0 ? static_cast<int>(_size / _maxLoadFactor) + 1 : 0;
+        numBuckets = roundNumBuckets(numBuckets > minBuckets ? numBuckets : minBuckets);
+
+        if (numBuckets == _numBuckets)
+            return;
+
+        FlatMap<_Key, _Value> tmp;
+        tmp._maxLoadFactor = _maxLoadFactor;
+        tmp.allocateBuckets(numBuckets);
+
+        for (int i = 0; i < _numBuckets; ++i)
+        {
+            if (_buckets[i].hash)
+            {
+                int index = tmp.insertBucket(_buckets[i].hash);
+                Memory::construct(tmp._buckets[index].ptr(), static_cast<KeyValue<_Key, _Value>&&>(_buckets[i].value()));
+            }
+        }
+
+        swap(*this, tmp);
+    }
+
+    friend void swap(FlatMap<_Key, _Value>& left, FlatMap<_Key, _Value>& right)
+    {
+        swap(left._buckets, right._buckets);
+        swap(left._numBuckets, right._numBuckets);
+        swap(left._size, right._size);
+        swap(left._maxLoadFactor, right._maxLoadFactor);
+    }
+
+protected:
+    static int roundNumBuckets(int numBuckets)
+    {
+        if (numBuckets == 0)
+            return 0;
+
+        int result = 8;
+
+        while (result < numBuckets)
+            result *= 2;
+
+        return result;
+    }
+
+    int distance(int index) const
+    {
+        return static_cast<int>((static_cast<uint32_t>(index) - _buckets[index].hash) & (_numBuckets - 1));
+    }
+
+    int findIndex(const _Key& key, uint32_t h) const
+    {
+        if (_size == 0)
+            return -1;
+
+        int mask = _numBuckets - 1;
+
+        for (int index = h & mask, dist = 0; ; index = (index + 1) & mask, ++dist)
+        {
+            uint32_t bucketHash = _buckets[index].hash;
+
+            if (bucketHash == h && _buckets[index].value().key == key)
+                return index;
+
+            // entries of a cluster are ordered by home bucket, the key can't be further
+            if (!bucketHash || static_cast<int>((index - bucketHash) & mask) < dist)
+                return -1;
+        }
+    }
+
+    // reserves a bucket for a new entry with the specified hash, the caller constructs the entry
+    int insertBucket(uint32_t h)
+    {
+        if (_size + 1 > _numBuckets * _maxLoadFactor)
+            rehash(_numBuckets > 0 ? _numBuckets * 2 : 8);
+
+        int mask = _numBuckets - 1;
+        int index = h & mask;
+
+        for (int dist = 0; _buckets[index].hash && distance(index) >= dist; ++dist)
+            index = (index + 1) & mask;
+
+        // shift the rest of the cluster one bucket forward
+        int last = index;
+
+        while (_buckets[last].hash)
+            last = (last + 1) & mask;
+
+        for (; last != index; last = (last - 1) & mask)
+        {
+            int prev = (last - 1) & mask;
+            Memory::construct(_buckets[last].ptr(), static_cast<KeyValue<_Key, _Value>&&>(_buckets[prev].value()));
+            Memory::destruct(_buckets[prev].ptr());
+            _buckets[last].hash = _buckets[prev].hash;
+        }
+
+        _buckets[index].hash = h;
+        ++_size;
+
+        return index;
+    }
+
+    template<typename... _Args>
+    void constructBucket(int index, _Args&&... args)
+    {
+        try
+        {
+            Memory::construct(_buckets[index].ptr(), static_cast<_Args&&>(args)...);
+        }
+        catch (...)
+        {
+            removeBucket(index);
+            throw;
+        }
+    }
+
+    // frees a bucket whose entry was already destructed
+    void removeBucket(int index)
+    {
+        int mask = _numBuckets - 1;
+        int next = (index + 1) & mask;
+
+        while (_buckets[next].hash && distance(next) > 0)
+        {
+            Memory::construct(_buckets[index].ptr(), static_cast<KeyValue<_Key, _Value>&&>(_buckets[next].value()));
+            Memory::destruct(_buckets[next].ptr());
+            _buckets[index].hash = _buckets[next].hash;
+            index = next;
+            next = (next + 1) & mask;
+        }
+
+        _buckets[index].hash = 0;
+        --_size;
+    }
+
+    void allocateBuckets(int numBuckets)
+    {
+        ASSERT(!_buckets && numBuckets > 0);
+
+        _buckets = Memory::allocate<FlatBucket<KeyValue<_Key, _Value>>>(numBuckets);
+
+        for (int i = 0; i < numBuckets; ++i)
+            _buckets[i].hash = 0;
+
+        _numBuckets = numBuckets;
+    }
+
+    void destroyBuckets()
+    {
+        for (int i = 0; i < _numBuckets; ++i)
+        {
+            if (_buckets[i].hash)
+                Memory::destruct(_buckets[i].ptr());
+        }
+
+        Memory::deallocate(_buckets);
+    }
+
+protected:
+    FlatBucket<KeyValue<_Key, _Value>>* _buckets;
+    int _numBuckets;
+    int _size;
+    float _maxLoadFactor;
+};
+
+// ConstFlatSetIterator
+
+template<typename _Type>
+class FlatSet;
+
+template<typename _Type>
+class ConstFlatSetIterator
+{
+public:
+    ConstFlatSetIterator(const FlatSet<_Type>& set) : _set(set), _index(-1)
+    {
+    }
+
+    const _Type& value() const
+    {
+        ASSERT(_index >= 0);
+        return _set._buckets[_index].value();
+    }
+
+    bool moveNext()
+    {
+        for (++_index; _index < _set._numBuckets; ++_index)
+        {
+            if (_set._buckets[_index].hash)
+                return true;
+        }
+
+        _index = -1;
+        return false;
+    }
+
+    void reset()
+    {
+        _index = -1;
+    }
+
+protected:
+    const FlatSet<_Type>& _set;
+    int _index;
+};
+
+// FlatSet
+
+// open addressing counterpart of Set, see FlatMap
+
+template<typename _Type>
+class FlatSet
+{
+public:
+    template<typename>
+    friend class ConstFlatSetIterator;
+
+    typedef ConstFlatSetIterator<_Type> ConstIterator;
+
+public:
+    FlatSet(int numBuckets = 0) :
+        _buckets(nullptr), _numBuckets(0), _size(0), _maxLoadFactor(0.875f)
+    {
+        ASSERT(numBuckets >= 0);
+
+        if (numBuckets > 0)
+            allocateBuckets(roundNumBuckets(numBuckets));
+    }
+
+    FlatSet(const FlatSet<_Type>& other) :
+        _buckets(nullptr), _numBuckets(0), _size(0), _maxLoadFactor(other._maxLoadFactor)
+    {
+        if (other._numBuckets > 0)
+        {
+            allocateBuckets(other._numBuckets);
+
+            for (int i = 0; i < _numBuckets; ++i)
+            {
+                if (other._buckets[i].hash)
+                {
+                    Memory::construct(_buckets[i].ptr(), other._buckets[i].value());
+                    _buckets[i].hash = other._buckets[i].hash;
+                    ++_size;
+                }
+            }
+        }
+    }
+
+    FlatSet(FlatSet<_Type>&& other) :
+        _buckets(other._buckets), _numBuckets(other._numBuckets),
+        _size(other._size), _maxLoadFactor(other._maxLoadFactor)
+    {
+        other._buckets = nullptr;
+        other._numBuckets = 0;
+        other._size = 0;
+    }
+
+    ~FlatSet()
+    {
+        destroyBuckets();
+    }
+
+    FlatSet<_Type>& operator=(const FlatSet<_Type>& other)
+    {
+        assign(other);
+        return *this;
+    }
+
+    FlatSet<_Type>& operator=(FlatSet<_Type>&& other)
+    {
+        FlatSet<_Type> tmp(static_cast<FlatSet<_Type>&&>(other));
+        swap(*this, tmp);
+        return *this;
+    }
+
+    int size() const
+    {
+        return _size;
+    }
+
+    int numBuckets() const
+    {
+        return _numBuckets;
+    }
+
+    bool empty() const
+    {
+        return _size == 0;
+    }
+
+    ConstIterator constIterator() const
+    {
+        return ConstIterator(*this);
+    }
+
+    float loadFactor() const
+    {
+        return static_cast<float>(_size) / _numBuckets;
+    }
+
+    float maxLoadFactor() const
+    {
+        return _maxLoadFactor;
+    }
+
+    void maxLoadFactor(float loadFactor)
+    {
+        ASSERT(loadFactor > 0 && loadFactor < 1);
+        _maxLoadFactor = loadFactor;
+    }
+
+    bool contains(const _Type& value) const
+    {
+        return findIndex(value, flatHash(hash(value))) >= 0;
+    }
+
+    void assign(const FlatSet<_Type>& other)
+    {
+        FlatSet<_Type> tmp(other);
+        swap(*this, tmp);
+    }
+
+    void add(const _Type& value)
+    {
+        uint32_t h = flatHash(hash(value));
+
+        if (findIndex(value, h) < 0)
+            constructBucket(insertBucket(h), value);
+    }
+
+    void add(_Type&& value)
+    {
+        uint32_t h = flatHash(hash(value));
+
+        if (findIndex(value, h) < 0)
+            constructBucket(insertBucket(h), static_cast<_Type&&>(value));
+    }
+
+    _Type remove()
+    {
+        for (int i = 0; i < _numBuckets; ++i)
+        {
+            if (_buckets[i].hash)
+            {
+                _Type value = static_cast<_Type&&>(_buckets[i].value());
+                Memory::destruct(_buckets[i].ptr());
+                removeBucket(i);
+                return value;
+            }
+        }
+
+        throw Exception(STR("set is empty"));
+    }
+
+    bool remove(const _Type& value)
+    {
+        int index = findIndex(value, flatHash(hash(value)));
+
+        if (index >= 0)
+        {
+            Memory::destruct(_buckets[index].ptr());
+            removeBucket(index);
+            return true;
+        }
+
+        return false;
+    }
+
+    void clear()
+    {
+        destroyBuckets();
+        _buckets = nullptr;
+        _numBuckets = 0;
+        _size = 0;
+    }
+
+    void rehash(int numBuckets)
+    {
+        ASSERT(numBuckets >= 0);
+
+        int minBuckets = _size > 0 ? static_cast<int>(_size / _maxLoadFactor) + 1 : 0;
+        numBuckets = roundNumBuckets(numBuckets > minBuckets ? numBuckets : minBuckets);
+
+        if (numBuckets == _numBuckets)
+            return;
+
+        FlatSet<_Type> tmp;
+        tmp._maxLoadFactor = _maxLoadFactor;
+        tmp.allocateBuckets(numBuckets);
+
+        for (int i = 0; i < _numBuckets; ++i)
+        {
+            if (_buckets[i].hash)
+            {
+                int index = tmp.insertBucket(_buckets[i].hash);
+                Memory::construct(tmp._buckets[index].ptr(), static_cast<_Type&&>(_buckets[i].value()));
+            }
+        }
+
+        swap(*this, tmp);
+    }
+
+    friend void swap(FlatSet<_Type>& left, FlatSet<_Type>& right)
+    {
+        swap(left._buckets, right._buckets);
+        swap(left._numBuckets, right._numBuckets);
+        swap(left._size, right._size);
+        swap(left._maxLoadFactor, right._maxLoadFactor);
+    }
+
+protected:
+    static int roundNumBuckets(int numBuckets)
+    {
+        if (numBuckets == 0)
+            return 0;
+
+        int result = 8;
+
+        while (result < numBuckets)
+            result *= 2;
+
+        return result;
+    }
+
+    int distance(int index) const
+    {
+        return static_cast<int>((static_cast<uint32_t>(index) - _buckets[index].hash) & (_numBuckets - 1));
+    }
+
+    int findIndex(const _Type& value, uint32_t h) const
+    {
+        if (_size == 0)
+            return -1;
+
+        int mask = _numBuckets - 1;
+
+        for (int index = h & mask, dist = 0; ; index = (index + 1) & mask, ++dist)
+        {
+            uint32_t bucketHash = _buckets[index].hash;
+
+            if (bucketHash == h && _buckets[index].value() == value)
+                return index;
+
+            // entries of a cluster are ordered by home bucket, the key can't be further
+            if (!bucketHash || static_cast<int>((index - bucketHash) & mask) < dist)
+                return -1;
+        }
+    }
+
+    int insertBucket(uint32_t h)
+    {
+        if (_size + 1 > _numBuckets * _maxLoadFactor)
+            rehash(_numBuckets > 0 ? _numBuckets * 2 : 8);
+
+        int mask = _numBuckets - 1;
+        int index = h & mask;
+
+        for (int dist = 0; _buckets[index].hash && distance(index) >= dist; ++dist)
+            index = (index + 1) & mask;
+
+        int last = index;
+
+        while (_buckets[last].hash)
+            last = (last + 1) & mask;
+
+        for (; last != index; last = (last - 1) & mask)
+        {
+            int prev = (last - 1) & mask;
+            Memory::construct(_buckets[last].ptr(), static_cast<_Type&&>(_buckets[prev].value()));
+            Memory::destruct(_buckets[prev].ptr());
+            _buckets[last].hash = _buckets[prev].hash;
+        }
+
+        _buckets[index].hash = h;
+        ++_size;
+
+        return index;
+    }
+
+    template<typename... _Args>
+    void constructBucket(int index, _Args&&... args)
+    {
+        try
+        {
+            Memory::construct(_buckets[index].ptr(), static_cast<_Args&&>(args)...);
+        }
+        catch (...)
+        {
+            removeBucket(index);
+            throw;
+        }
+    }
+
+    void removeBucket(int index)
+    {
+        int mask = _numBuckets - 1;
+        int next = (index + 1) & mask;
+
+        while (_buckets[next].hash && distance(next) > 0)
+        {
+            Memory::construct(_buckets[index].ptr(), static_cast<_Type&&>(_buckets[next].value()));
+            Memory::destruct(_buckets[next].ptr());
+            _buckets[index].hash = _buckets[next].hash;
+            index = next;
+            next = (next + 1) & mask;
+        }
+
+        _buckets[index].hash = 0;
+        --_size;
+    }
+
+    void allocateBuckets(int numBuckets)
+    {
+        ASSERT(!_buckets && numBuckets > 0);
+
+        _buckets = Memory::allocate<FlatBucket<_Type>>(numBuckets);
+
+        for (int i = 0; i < numBuckets; ++i)
+            _buckets[i].hash = 0;
+
+        _numBuckets = numBuckets;
+    }
+
+    void destroyBuckets()
+    {
+        for (int i = 0; i < _numBuckets; ++i)
+        {
+            if (_buckets[i].hash)
+                Memory::destruct(_buckets[i].ptr());
+        }
+
+        Memory::deallocate(_buckets);
+    }
+
+protected:
+    FlatBucket<_Type>* _buckets;
+    int _numBuckets;
+    int _size;
+    float _maxLoadFactor;
+};
+
+// Mutex
+
+class Mutex
+{
+public:
+    Mutex();
+
+    Mutex(const Mutex&) = delete;
+    Mutex& operator=(const Mutex&) = delete;
+
+    ~Mutex();
+
+    void lock();
+    void unlock();
+
+protected:
+#ifdef PLATFORM_WINDOWS
+    CRITICAL_SECTION _mutex;
+#else
+    pthread_mutex_t _mutex;
+#endif
+};
+
+// MutexLock
+
+class MutexLock
+{
+public:
+    MutexLock(Mutex& mutex) : _mutex(mutex)
+    {
+        _mutex.lock();
+    }
+
+    MutexLock(const MutexLock&) = delete;
+    MutexLock& operator=(const MutexLock&) = delete;
+
+    ~MutexLock()
+    {
+        _mutex.unlock();
+    }
+
+protected:
+    Mutex& _mutex;
+};
+
+// Thread
+
+class Thread
+{
+public:
+    Thread();
+
+    Thread(const Thread&) = delete;
+    Thread& operator=(const Thread&) = delete;
+
+    ~Thread();
+
+    bool started() const
+    {
+        return _started;
+    }
+
+    void start(void (*func)(void*), void* param = nullptr);
+    void join();
+
+    static int processorCount();
+
+protected:
+#ifdef PLATFORM_WINDOWS
+    static DWORD WINAPI threadProc(LPVOID param);
+#else
+    static void* threadProc(void* param);
+#endif
+
+protected:
+    void (*_func)(void*);
+    void* _param;
+    bool _started;
+
+#ifdef PLATFORM_WINDOWS
+    HANDLE _handle;
+#else
+    pthread_t _thread;
+#endif
+};
+
+// read faults
+
+// runs func and returns false if a read fault stopped it, which is how reading a mapped file
+// fails when another process truncates it, func must not leave anything to destruct
+bool guardedRead(void (*func)(void*), void* param);
+
+// installs the handler that lets guardedRead() stop func, called once at startup
+void installReadFaultHandler();
+
 #endif
@@ -0,0 +1,701 @@
+#include <highlighter.h>
+
+enum CharClass
+{
+    CHAR_CLASS_WORD = 1,
+    CHAR_CLASS_DIGIT = 2,
+    CHAR_CLASS_NUMBER = 4
+};
+
+const uint8_t CHAR_CLASSES[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 0, 4, 4, 0,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 0, 0, 0, 0, 0, 0,
+    0, 5, 5, 5, 5, 5, 5, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 5, 1, 1, 0, 0, 0, 0, 1,
+    0, 5, 5, 5, 5, 5, 5, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 5, 1, 1, 0, 0, 0, 0, 0
+};
+
+inline bool charHasClass(unichar_t ch, uint8_t charClass)
+{
+    return ch < 128 ? (CHAR_CLASSES[ch] & charClass) != 0 :
+        (charClass & CHAR_CLASS_WORD) != 0 && charIsAlphaNum(ch);
+}
+
+// KeywordTable
+
+KeywordTable::KeywordTable()
+{
+    for (int i = 0; i < TABLE_SIZE; ++i)
+    {
+        _entries[i].keyword = nullptr;
+        _entries[i].len = 0;
+        _entries[i].highlightingType = HIGHLIGHTING_TYPE_NONE;
+    }
+}
+
+void KeywordTable::add(const char_t* keyword, HighlightingType highlightingType)
+{
+    ASSERT(keyword);
+
+    int len = strLen(keyword);
+    ASSERT(len > 0 && len <= MAX_KEYWORD_LENGTH);
+
+    int i = hash(keyword, len) & (TABLE_SIZE - 1);
+
+    while (_entries[i].keyword)
+    {
+        ASSERT(!(_entries[i].len == len && strCompareLen(_entries[i].keyword, keyword, len) == 0));
+        i = (i + 1) & (TABLE_SIZE - 1);
+    }
+
+    _entries[i].keyword = keyword;
+    _entries[i].len = len;
+    _entries[i].highlightingType = highlightingType;
+}
+
+HighlightingType KeywordTable::find(const char_t* word, int len) const
+{
+    ASSERT(word);
+    ASSERT(len >= 0);
+
+    if (len == 0 || len > MAX_KEYWORD_LENGTH)
+        return HIGHLIGHTING_TYPE_NONE;
+
+    int i = hash(word, len) & (TABLE_SIZE - 1);
+
+    while (_entries[i].keyword)
+    {
+        if (_entries[i].len == len && strCompareLen(_entries[i].keyword, word, len) == 0)
+            return _entries[i].highlightingType;
+
+        i = (i + 1) & (TABLE_SIZE - 1);
+    }
+
+    return HIGHLIGHTING_TYPE_NONE;
+}
+
+uint32_t KeywordTable::hash(const char_t* word, int len)
+{
+    return static_cast<uint32_t>(hashBytes(word, static_cast<int>(len * sizeof(char_t))));
+}
+
+// CppSyntaxHighlighter
+
+CppSyntaxHighlighter::CppSyntaxHighlighter() : SyntaxHighlighter(DOCUMENT_TYPE_CPP)
+{
+    _keywords.add(STR("alignas"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("alignof"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("and"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("and_eq"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("asm"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("atomic_cancel"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("atomic_commit"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("atomic_noexcept"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("bitand"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("bitor"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("break"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("case"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("catch"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("class"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("compl"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("concept"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("const_cast"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("continue"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("co_await"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("co_return"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("co_yield"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("decltype"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("default"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("delete"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("do"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("dynamic_cast"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("else"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("enum"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("explicit"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("export"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("extern"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("false"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("for"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("friend"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("goto"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("if"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("import"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("inline"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("module"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("mutable"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("namespace"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("new"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("noexcept"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("not"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("not_eq"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("nullptr"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("operator"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("or"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("or_eq"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("private"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("protected"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("public"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("register"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("reflexpr"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("reinterpret_cast"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("requires"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("return"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("sizeof"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("static"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("static_assert"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("static_cast"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("struct"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("switch"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("synchronized"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("template"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("this"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("thread_local"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("throw"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("true"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("try"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("typedef"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("typeid"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("typename"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("union"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("using"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("virtual"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("while"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("xor"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("xor_eq"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("override"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("final"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("transaction_safe"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("transaction_safe_dynamic"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("_Pragma"), HIGHLIGHTING_TYPE_KEYWORD);
+
+    _keywords.add(STR("auto"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("bool"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("byte"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("char"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("char16_t"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("char32_t"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("const"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("constexpr"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("double"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("float"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("int"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("long"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("short"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("signed"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("unsigned"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("void"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("volatile"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("wchar_t"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("int8_t"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("int16_t"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("int32_t"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("int64_t"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("uint8_t"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("uint16_t"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("uint32_t"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("uint64_t"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("intptr_t"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("uintptr_t"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("intmax_t"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("uintmax_t"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("size_t"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("ptrdiff_t"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("nullptr_t"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("max_align_t"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("unichar_t"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("char_t"), HIGHLIGHTING_TYPE_TYPE);
+    _keywords.add(STR("byte_t"), HIGHLIGHTING_TYPE_TYPE);
+
+    _preprocessor.add(STR("if"), HIGHLIGHTING_TYPE_PREPROCESSOR);
+    _preprocessor.add(STR("elif"), HIGHLIGHTING_TYPE_PREPROCESSOR);
+    _preprocessor.add(STR("else"), HIGHLIGHTING_TYPE_PREPROCESSOR);
+    _preprocessor.add(STR("endif"), HIGHLIGHTING_TYPE_PREPROCESSOR);
+    _preprocessor.add(STR("defined"), HIGHLIGHTING_TYPE_PREPROCESSOR);
+    _preprocessor.add(STR("ifdef"), HIGHLIGHTING_TYPE_PREPROCESSOR);
+    _preprocessor.add(STR("ifndef"), HIGHLIGHTING_TYPE_PREPROCESSOR);
+    _preprocessor.add(STR("define"), HIGHLIGHTING_TYPE_PREPROCESSOR);
+    _preprocessor.add(STR("undef"), HIGHLIGHTING_TYPE_PREPROCESSOR);
+    _preprocessor.add(STR("include"), HIGHLIGHTING_TYPE_PREPROCESSOR);
+    _preprocessor.add(STR("line"), HIGHLIGHTING_TYPE_PREPROCESSOR);
+    _preprocessor.add(STR("error"), HIGHLIGHTING_TYPE_PREPROCESSOR);
+    _preprocessor.add(STR("pragma"), HIGHLIGHTING_TYPE_PREPROCESSOR);
+}
+
+void CppSyntaxHighlighter::highlightChar(const TextBuffer& text, int pos)
+{
+    if (_highlightingState.charsRemaining > 0)
+    {
+        --_highlightingState.charsRemaining;
+        if (_highlightingState.charsRemaining > 0)
+            return;
+
+        if (_highlightingState.reset)
+            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_NONE;
+    }
+
+    unichar_t ch = text.charAt(pos);
+
+    if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_STRING)
+    {
+        if (_highlightingState.prevCh == '\\')
+            _highlightingState.prevCh = 0;
+        else if (ch == _highlightingState.startCh)
+        {
+            _highlightingState.charsRemaining = 1;
+            _highlightingState.reset = true;
+        }
+        else if (ch == '\\')
+            _highlightingState.prevCh = ch;
+
+        return;
+    }
+    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_NUMBER)
+    {
+        if (!charHasClass(ch, CHAR_CLASS_NUMBER))
+            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_NONE;
+        else
+            return;
+    }
+    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_SINGLELINE_COMMENT)
+    {
+        if (ch == '\n')
+        {
+            _highlightingState.charsRemaining = 1;
+            _highlightingState.reset = true;
+        }
+
+        return;
+    }
+    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_MULTILINE_COMMENT)
+    {
+        if (ch == '*')
+        {
+            pos = text.charForward(pos);
+
+            if (pos < text.length())
+            {
+                if (text.charAt(pos) == '/')
+                {
+                    _highlightingState.charsRemaining = 2;
+                    _highlightingState.reset = true;
+                }
+            }
+        }
+
+        return;
+    }
+    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_PREPROCESSOR)
+    {
+        if (ch == '\n')
+        {
+            if (_highlightingState.prevCh != '\\')
+            {
+                _highlightingState.charsRemaining = 1;
+                _highlightingState.reset = true;
+            }
+
+            _highlightingState.prevCh = 0;
+        }
+        else if (ch == '\\')
+            _highlightingState.prevCh = ch;
+
+        return;
+    }
+
+    if (ch == '"' || ch == '\'')
+    {
+        _highlightingState.startCh = ch;
+        _highlightingState.highlightingType = HIGHLIGHTING_TYPE_STRING;
+    }
+    else if (charHasClass(ch, CHAR_CLASS_DIGIT))
+    {
+        _highlightingState.highlightingType = HIGHLIGHTING_TYPE_NUMBER;
+    }
+    else if (charHasClass(ch, CHAR_CLASS_WORD))
+    {
+        char_t word[KeywordTable::MAX_KEYWORD_LENGTH + 1];
+        int len = 0, n = 0;
+
+        do
+        {
+            if (ch < 128 && len < KeywordTable::MAX_KEYWORD_LENGTH + 1)
+                word[len++] = static_cast<char_t>(ch);
+
+            ++n;
+            pos = text.charForward(pos);
+
+            if (pos < text.length())
+                ch = text.charAt(pos);
+            else
+                break;
+        } while (charHasClass(ch, CHAR_CLASS_WORD));
+
+        _highlightingState.charsRemaining = n;
+        _highlightingState.reset = true;
+
+        HighlightingType highlightingType = n == len ? _keywords.find(word, len) : HIGHLIGHTING_TYPE_NONE;
+        _highlightingState.highlightingType =
+            highlightingType != HIGHLIGHTING_TYPE_NONE ? highlightingType : HIGHLIGHTING_TYPE_IDENT;
+    }
+    else if (ch == '/')
+    {
+        pos = text.charForward(pos);
+
+        if (pos < text.length())
+        {
+            ch = text.charAt(pos);
+
+            if (ch == '*')
+            {
+                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_MULTILINE_COMMENT;
+                _highlightingState.charsRemaining = 2;
+                _highlightingState.reset = false;
+            }
+            else if (ch == '/')
+                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_SINGLELINE_COMMENT;
+        }
+    }
+    else if (ch == '#')
+    {
+        pos = text.charForward(pos);
+
+        if (pos < text.length())
+        {
+            ch = text.charAt(pos);
+
+            char_t word[KeywordTable::MAX_KEYWORD_LENGTH + 1];
+            int len = 0, n = 0;
+
+            while (charIsAlpha(ch))
+            {
+                if (ch < 128 && len < KeywordTable::MAX_KEYWORD_LENGTH + 1)
+                    word[len++] = static_cast<char_t>(ch);
+
+                ++n;
+                pos = text.charForward(pos);
+
+                if (pos < text.length())
+                    ch = text.charAt(pos);
+                else
+                    break;
+            }
+
+            if (n == len && _preprocessor.find(word, len) == HIGHLIGHTING_TYPE_PREPROCESSOR)
+            {
+                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_PREPROCESSOR;
+
+                if ((len == 4 && strCompareLen(word, STR("else"), len) == 0) ||
+                    (len == 5 && strCompareLen(word, STR("endif"), len) == 0))
+                {
+                    _highlightingState.charsRemaining = len + 1;
+                    _highlightingState.reset = true;
+                }
+            }
+        }
+    }
+}
+
+ShellSyntaxHighlighter::ShellSyntaxHighlighter() : SyntaxHighlighter(DOCUMENT_TYPE_SHELL)
+{
+    _keywords.add(STR("case"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("do"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("done"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("elif"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("else"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("esac"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("fi"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("for"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("function"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("if"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("in"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("select"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("then"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("time"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("until"), HIGHLIGHTING_TYPE_KEYWORD);
+    _keywords.add(STR("while"), HIGHLIGHTING_TYPE_KEYWORD);
+}
+
+void ShellSyntaxHighlighter::highlightChar(const TextBuffer& text, int pos)
+{
+    if (_highlightingState.charsRemaining > 0)
+    {
+        --_highlightingState.charsRemaining;
+        if (_highlightingState.charsRemaining > 0)
+            return;
+
+        if (_highlightingState.reset)
+            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_NONE;
+    }
+
+    unichar_t ch = text.charAt(pos);
+
+    if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_STRING)
+    {
+        if (_highlightingState.prevCh == '\\')
+            _highlightingState.prevCh = 0;
+        else if (ch == _highlightingState.startCh)
+        {
+            _highlightingState.charsRemaining = 1;
+            _highlightingState.reset = true;
+        }
+        else if (ch == '\\')
+            _highlightingState.prevCh = ch;
+
+        return;
+    }
+    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_NUMBER)
+    {
+        if (!charHasClass(ch, CHAR_CLASS_NUMBER))
+            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_NONE;
+        else
+            return;
+    }
+    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_SINGLELINE_COMMENT)
+    {
+        if (ch == '\n')
+        {
+            _highlightingState.charsRemaining = 1;
+            _highlightingState.reset = true;
+        }
+
+        return;
+    }
+    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_VARIABLE_REF)
+    {
+        if (_highlightingState.startCh == '{')
+        {
+            if (ch == '}')
+            {
+                _highlightingState.charsRemaining = 1;
+                _highlightingState.reset = true;
+            }
+
+            return;
+        }
+        else
+        {
+            if (!(charIsAlphaNum(ch) || charIsDigit(ch) || ch == '_' || ch == '*' ||
+                    ch == '@' || ch == '#' || ch == '?' || ch == '-' || ch == '$' || ch == '!'))
+                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_NONE;
+            else
+                return;
+        }
+    }
+
+    if (ch == '"' || ch == '\'')
+    {
+        _highlightingState.startCh = ch;
+        _highlightingState.highlightingType = HIGHLIGHTING_TYPE_STRING;
+    }
+    else if (charHasClass(ch, CHAR_CLASS_DIGIT))
+    {
+        _highlightingState.highlightingType = HIGHLIGHTING_TYPE_NUMBER;
+    }
+    else if (charHasClass(ch, CHAR_CLASS_WORD))
+    {
+        char_t word[KeywordTable::MAX_KEYWORD_LENGTH + 1];
+        int len = 0, n = 0;
+
+        do
+        {
+            if (ch < 128 && len < KeywordTable::MAX_KEYWORD_LENGTH + 1)
+                word[len++] = static_cast<char_t>(ch);
+
+            ++n;
+            pos = text.charForward(pos);
+
+            if (pos < text.length())
+                ch = text.charAt(pos);
+            else
+                break;
+        } while (charHasClass(ch, CHAR_CLASS_WORD));
+
+        _highlightingState.charsRemaining = n;
+        _highlightingState.reset = true;
+
+        if (n == len && _keywords.find(word, len) == HIGHLIGHTING_TYPE_KEYWORD)
+            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_KEYWORD;
+        else
+        {
+            if (pos < text.length() && ch == '=')
+                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_VARIABLE;
+            else
+                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_NONE;
+        }
+    }
+    else if (ch == '#')
+    {
+        _highlightingState.highlightingType = HIGHLIGHTING_TYPE_SINGLELINE_COMMENT;
+    }
+    else if (ch == '$')
+    {
+        pos = text.charForward(pos);
+
+        if (pos < text.length())
+        {
+            ch = text.charAt(pos);
+            _highlightingState.startCh = ch == '{' ? ch : 0;
+        }
+
+        _highlightingState.highlightingType = HIGHLIGHTING_TYPE_VARIABLE_REF;
+    }
+}
+
+// XmlSyntaxHighlighter
+
+void XmlSyntaxHighlighter::highlightChar(const TextBuffer& text, int pos)
+{
+    if (_highlightingState.charsRemaining > 0)
+    {
+        --_highlightingState.charsRemaining;
+        if (_highlightingState.charsRemaining > 0)
+            return;
+
+        if (_highlightingState.reset)
+            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_NONE;
+    }
+
+    unichar_t ch = text.charAt(pos);
+
+    if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_TAG)
+    {
+        if (ch == '>')
+        {
+            _highlightingState.charsRemaining = 1;
+            _highlightingState.reset = true;
+        }
+        else if (charIsSpace(ch))
+            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_ATTRIBUTE;
+
+        return;
+    }
+    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_ATTRIBUTE)
+    {
+        if (ch == '=')
+            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_ATTRIBUTE_EQUAL;
+        else if (ch == '>')
+        {
+            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_TAG;
+            _highlightingState.charsRemaining = 1;
+            _highlightingState.reset = true;
+        }
+        else if (ch == '/')
+            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_TAG;
+
+        return;
+    }
+    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_ATTRIBUTE_EQUAL)
+    {
+        if (ch == '\'' || ch == '"')
+        {
+            _highlightingState.startCh = ch;
+            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_ATTRIBUTE_VALUE;
+        }
+        else if (!charIsSpace(ch))
+        {
+            _highlightingState.startCh = 0;
+            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_ATTRIBUTE_VALUE;
+        }
+
+        return;
+    }
+    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_ATTRIBUTE_VALUE)
+    {
+        if (_highlightingState.prevCh != 0)
+        {
+            _highlightingState.prevCh = 0;
+
+            if (ch == '>')
+            {
+                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_TAG;
+                _highlightingState.charsRemaining = 1;
+                _highlightingState.reset = true;
+            }
+            else if (ch == '/')
+                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_TAG;
+            else
+                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_ATTRIBUTE;
+        }
+        else if (_highlightingState.startCh != 0)
+        {
+            if (ch == _highlightingState.startCh)
+                _highlightingState.prevCh = 1;
+        }
+        else if (_highlightingState.startCh == 0)
+        {
+            if (ch == '>')
+            {
+                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_TAG;
+                _highlightingState.charsRemaining = 1;
+                _highlightingState.reset = true;
+            }
+            else if (ch == '/')
+                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_TAG;
+            else if (charIsSpace(ch))
+                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_ATTRIBUTE;
+        }
+
+        return;
+    }
+    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_MULTILINE_COMMENT)
+    {
+        if (ch == '-')
+        {
+            pos = text.charForward(pos);
+
+            if (pos < text.length())
+            {
+                if (text.charAt(pos) == '-')
+                {
+                    pos = text.charForward(pos);
+
+                    if (pos < text.length())
+                    {
+                        if (text.charAt(pos) == '>')
+                        {
+                            _highlightingState.charsRemaining = 3;
+                            _highlightingState.reset = true;
+                        }
+                    }
+                }
+            }
+        }
+
+        return;
+    }
+
+    if (ch == '<')
+    {
+        pos = text.charForward(pos);
+
+        if (pos < text.length())
+        {
+            if (text.charAt(pos) == '!')
+            {
+                pos = text.charForward(pos);
+
+                if (pos < text.length())
+                {
+                    if (text.charAt(pos) == '-')
+                    {
+                        pos = text.charForward(pos);
+
+                        if (pos < text.length())
+                        {
+                            if (text.charAt(pos) == '-')
+                            {
+                                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_MULTILINE_COMMENT;
+                                return;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        _highlightingState.highlightingType = HIGHLIGHTING_TYPE_TAG;
+    }
+}
@@ -0,0 +1,154 @@
+#ifndef HIGHLIGHTER_INCLUDED
+#define HIGHLIGHTER_INCLUDED
+
+#include <foundation.h>
+
+// DocumentType
+
+enum DocumentType
+{
+    DOCUMENT_TYPE_TEXT,
+    DOCUMENT_TYPE_CPP,
+    DOCUMENT_TYPE_SHELL,
+    DOCUMENT_TYPE_BATCH,
+    DOCUMENT_TYPE_POWERSHELL,
+    DOCUMENT_TYPE_XML,
+    DOCUMENT_TYPE_HTML,
+    DOCUMENT_TYPE_PYTHON,
+    DOCUMENT_TYPE_JAVASCRIPT
+};
+
+// HighlightingType
+
+enum HighlightingType
+{
+    HIGHLIGHTING_TYPE_NONE,
+    HIGHLIGHTING_TYPE_STRING,
+    HIGHLIGHTING_TYPE_NUMBER,
+    HIGHLIGHTING_TYPE_IDENT,
+    HIGHLIGHTING_TYPE_KEYWORD,
+    HIGHLIGHTING_TYPE_TYPE,
+    HIGHLIGHTING_TYPE_SINGLELINE_COMMENT,
+    HIGHLIGHTING_TYPE_MULTILINE_COMMENT,
+    HIGHLIGHTING_TYPE_PREPROCESSOR,
+    HIGHLIGHTING_TYPE_VARIABLE,
+    HIGHLIGHTING_TYPE_VARIABLE_REF,
+    HIGHLIGHTING_TYPE_TAG,
+    HIGHLIGHTING_TYPE_ATTRIBUTE,
+    HIGHLIGHTING_TYPE_ATTRIBUTE_EQUAL,
+    HIGHLIGHTING_TYPE_ATTRIBUTE_VALUE
+};
+
+// HighlightingState
+
+struct HighlightingState
+{
+    HighlightingType highlightingType = HIGHLIGHTING_TYPE_NONE;
+    int charsRemaining = 0;
+    bool reset = false;
+    unichar_t startCh = 0, prevCh = 0;
+};
+
+// KeywordTable
+
+// open addressing table of static keyword strings filled once by a highlighter,
+// looked up without building a String
+
+class KeywordTable
+{
+public:
+    static const int MAX_KEYWORD_LENGTH = 31;
+
+    KeywordTable();
+
+    void add(const char_t* keyword, HighlightingType highlightingType);
+    HighlightingType find(const char_t* word, int len) const;
+
+protected:
+    static const int TABLE_SIZE = 512;
+
+    struct Entry
+    {
+        const char_t* keyword;
+        int len;
+        HighlightingType highlightingType;
+    };
+
+    static uint32_t hash(const char_t* word, int len);
+
+    Entry _entries[TABLE_SIZE];
+};
+
+// SyntaxHighlighter
+
+class SyntaxHighlighter
+{
+public:
+    SyntaxHighlighter(DocumentType documentType = DOCUMENT_TYPE_TEXT) : _documentType(documentType)
+    {
+    }
+
+    virtual ~SyntaxHighlighter()
+    {
+    }
+
+    DocumentType documentType() const
+    {
+        return _documentType;
+    }
+
+    const HighlightingState& highlightingState() const
+    {
+        return _highlightingState;
+    }
+
+    HighlightingState& highlightingState()
+    {
+        return _highlightingState;
+    }
+
+    virtual void highlightChar(const TextBuffer& text, int pos) = 0;
+
+protected:
+    DocumentType _documentType;
+    HighlightingState _highlightingState;
+};
+
+// CppSyntaxHighlighter
+
+class CppSyntaxHighlighter : public SyntaxHighlighter
+{
+public:
+    CppSyntaxHighlighter();
+    void highlightChar(const TextBuffer& text, int pos) override;
+
+protected:
+    KeywordTable _keywords;
+    KeywordTable _preprocessor;
+};
+
+// ShellSyntaxHighlighter
+
+class ShellSyntaxHighlighter : public SyntaxHighlighter
+{
+public:
+    ShellSyntaxHighlighter();
+    void highlightChar(const TextBuffer& text, int pos) override;
+
+protected:
+    KeywordTable _keywords;
+};
+
+// XmlSyntaxHighlighter
+
+class XmlSyntaxHighlighter : public SyntaxHighlighter
+{
+public:
+    XmlSyntaxHighlighter() : SyntaxHighlighter(DOCUMENT_TYPE_XML)
+    {
+    }
+
+    void highlightChar(const TextBuffer& text, int pos) override;
+};
+
+#endif
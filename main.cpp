@@ -43,6 +43,7 @@ int MAIN(int argc, const char_t** argv)
         CoUninitialize();
 #elif defined(PLATFORM_LINUX)
         gtk_init(nullptr, nullptr);
+        installReadFaultHandler();
         __run(argc, argv);
 #else
 #error Unsupported GUI platform
@@ -13,23 +13,29 @@ COMPILER_FLAGS = /Zi
 COMPILER_FLAGS = /O1
 !endif
 
+!ifdef MEMORY_STATISTICS
+COMPILER_FLAGS = $(COMPILER_FLAGS) /DMEMORY_STATISTICS
+BIN = $(BIN)\memory
+!endif
+
 !if "$(TARGET)" == "test"
 BIN = $(BIN)\$(TARGET)
 EXE = $(BIN)\test.exe
-OBJS = $(BIN)\test.obj $(BIN)\foundation.obj $(BIN)\file.obj $(BIN)\input.obj $(BIN)\console.obj $(BIN)\main.obj
+OBJS = $(BIN)\test.obj $(BIN)\foundation.obj $(BIN)\file.obj $(BIN)\highlighter.obj $(BIN)\input.obj \
+	$(BIN)\console.obj $(BIN)\main.obj
 LIBS = user32.lib ole32.lib
 !else if "$(TARGET)" == "gui"
 COMPILER_FLAGS = $(COMPILER_FLAGS) /DGUI_MODE
 LIBS = user32.lib ole32.lib dwrite.lib d2d1.lib windowscodecs.lib
 BIN = $(BIN)\$(TARGET)
 EXE = $(BIN)\ev.exe
-OBJS = $(BIN)\editor.obj $(BIN)\foundation.obj $(BIN)\file.obj $(BIN)\application.obj \
+OBJS = $(BIN)\editor.obj $(BIN)\highlighter.obj $(BIN)\foundation.obj $(BIN)\file.obj $(BIN)\application.obj \
 	$(BIN)\input.obj $(BIN)\console.obj $(BIN)\graphics.obj $(BIN)\main.obj $(BIN)\editor.res
 !else
 COMPILER_FLAGS = $(COMPILER_FLAGS)
 LIBS = user32.lib ole32.lib
 EXE = $(BIN)\ev.exe
-OBJS = $(BIN)\editor.obj $(BIN)\foundation.obj $(BIN)\file.obj $(BIN)\application.obj \
+OBJS = $(BIN)\editor.obj $(BIN)\highlighter.obj $(BIN)\foundation.obj $(BIN)\file.obj $(BIN)\application.obj \
 	$(BIN)\input.obj $(BIN)\console.obj $(BIN)\main.obj
 !endif
 
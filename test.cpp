@@ -135,6 +135,74 @@ void testSupport()
     }
 }
 
+void testHash()
+{
+    // int hashBytes(const void* data, int size)
+
+    {
+        ASSERT_EXCEPTION(Exception, hashBytes("", -1));
+
+        byte_t bytes[64];
+        for (int i = 0; i < 64; ++i)
+            bytes[i] = static_cast<byte_t>(i * 7 + 1);
+
+        // every length hashes differently and doesn't depend on alignment
+
+        Set<int> hashes;
+
+        for (int size = 0; size <= 40; ++size)
+        {
+            int h = hashBytes(bytes, size);
+            hashes.add(h);
+
+            byte_t copy[64];
+            memcpy(copy + 3, bytes, size);
+            ASSERT(hashBytes(copy + 3, size) == h);
+        }
+
+        ASSERT(hashes.size() == 41);
+
+        // every byte affects the hash
+
+        for (int size = 1; size <= 40; ++size)
+        {
+            for (int i = 0; i < size; ++i)
+            {
+                byte_t copy[64];
+                memcpy(copy, bytes, size);
+                copy[i] ^= 1;
+                ASSERT(hashBytes(copy, size) != hashBytes(bytes, size));
+            }
+        }
+    }
+
+    // int hash(const char_t* val)
+    // int hash(const String& val)
+
+    {
+        ASSERT(hash(STR("")) == hash(String()));
+        ASSERT(hash(STR("identifier")) == hash(String(STR("identifier"))));
+        ASSERT(hash(STR("identifier")) != hash(STR("identifies")));
+        ASSERT(hash(STR("ab")) != hash(STR("ba")));
+    }
+
+    // short identifiers spread evenly over buckets
+
+    {
+        const int NUM_BUCKETS = 1024;
+        int buckets[NUM_BUCKETS] = {};
+
+        for (int i = 0; i < NUM_BUCKETS; ++i)
+            ++buckets[hash(String::format(STR("word%d"), i)) & (NUM_BUCKETS - 1)];
+
+        int maxBucket = 0;
+        for (int i = 0; i < NUM_BUCKETS; ++i)
+            maxBucket = max(maxBucket, buckets[i]);
+
+        ASSERT(maxBucket <= 8);
+    }
+}
+
 void testSwapBytes()
 {
     {
@@ -174,6 +242,143 @@ void testSwapBytes()
     }
 }
 
+struct LargeBlock
+{
+    byte_t data[1 << 20];
+};
+
+void testMemory()
+{
+    // _Type* allocate()
+    // _Type* allocate(int size)
+    // _Type* reallocate(_Type* ptr, int size)
+    // void deallocate(void* ptr)
+
+    {
+        int* p = Memory::allocate<int>();
+        *p = 1;
+        Memory::deallocate(p);
+
+        ASSERT(Memory::allocate<int>(0) == nullptr);
+
+        p = Memory::allocate<int>(2);
+        p[1] = 2;
+        p = Memory::reallocate(p, 4);
+        ASSERT(p[1] == 2);
+        ASSERT(Memory::reallocate(p, 0) == nullptr);
+    }
+
+#ifdef MEMORY_STATISTICS
+
+    // MemoryStatistics statistics()
+
+    {
+        MemoryStatistics before = Memory::statistics();
+
+        int64_t* p = Memory::allocate<int64_t>(100);
+        MemoryStatistics after = Memory::statistics();
+        ASSERT(after.allocations == before.allocations + 1);
+        ASSERT(after.bytes == before.bytes + 800);
+
+        p = Memory::reallocate(p, 200);
+        after = Memory::statistics();
+        ASSERT(after.allocations == before.allocations + 2);
+        ASSERT(after.bytes == before.bytes + 1600);
+        ASSERT(after.peakBytes >= after.bytes);
+
+        Memory::deallocate(p);
+        ASSERT(Memory::statistics().bytes == before.bytes);
+    }
+
+    // int sites(MemorySite* sites, int maxSites)
+
+    {
+        ASSERT(Memory::sites(nullptr, 0) == 0);
+
+        LargeBlock* block = Memory::allocate<LargeBlock>(3);
+        int line = __LINE__ - 1;
+
+        MemorySite sites[4];
+        ASSERT(Memory::sites(sites, 4) == 4);
+        ASSERT(sites[0].allocations == 1);
+        ASSERT(sites[0].bytes == 3 * sizeof(LargeBlock));
+        ASSERT(sites[0].totalBytes == 3 * sizeof(LargeBlock));
+        ASSERT(sites[0].typeLength == 10 && strncmp(sites[0].type, "LargeBlock", 10) == 0);
+
+        for (int i = 1; i < 4; ++i)
+            ASSERT(sites[i].bytes <= sites[i - 1].bytes);
+
+        if (sites[0].line != 0)
+        {
+            ASSERT(strcmp(sites[0].function, "testMemory") == 0);
+            ASSERT(strstr(sites[0].file, "test.cpp") != nullptr);
+            ASSERT(sites[0].line == line);
+        }
+
+        // reallocated blocks move to the site that reallocated them
+
+        block = Memory::reallocate(block, 4);
+
+        ASSERT(Memory::sites(sites, 2) == 2);
+        ASSERT(sites[0].bytes == 4 * sizeof(LargeBlock));
+        ASSERT(sites[0].line != line || line == 0);
+
+        Memory::deallocate(block);
+
+        ASSERT(Memory::sites(sites, 1) == 1);
+        ASSERT(sites[0].bytes < static_cast<int64_t>(sizeof(LargeBlock)));
+    }
+
+    // Scope(const char* name)
+
+    {
+        LargeBlock* outside = Memory::allocate<LargeBlock>(3);
+        LargeBlock* inside;
+        LargeBlock* nested;
+
+        {
+            Memory::Scope scope("first");
+
+            {
+                Memory::Scope scope("second");
+                nested = Memory::allocate<LargeBlock>(4);
+            }
+
+            inside = Memory::allocate<LargeBlock>(2);
+        }
+
+        MemorySite sites[3];
+        ASSERT(Memory::sites(sites, 3) == 3);
+        ASSERT(sites[0].bytes == 4 * sizeof(LargeBlock) && strcmp(sites[0].scope, "second") == 0);
+        ASSERT(sites[1].bytes == 3 * sizeof(LargeBlock) && !sites[1].scope);
+        ASSERT(sites[2].bytes == 2 * sizeof(LargeBlock) && strcmp(sites[2].scope, "first") == 0);
+
+        Memory::deallocate(nested);
+        Memory::deallocate(inside);
+        Memory::deallocate(outside);
+
+        // the same caller is a different site in each scope
+
+        LargeBlock* blocks[2];
+
+        for (int i = 0; i < 2; ++i)
+        {
+            Memory::Scope scope(i == 0 ? "first" : "second");
+            blocks[i] = Memory::allocate<LargeBlock>(5 + i);
+        }
+
+        ASSERT(Memory::sites(sites, 2) == 2);
+        ASSERT(sites[0].bytes == 6 * sizeof(LargeBlock) && strcmp(sites[0].scope, "second") == 0);
+        ASSERT(sites[1].bytes == 5 * sizeof(LargeBlock) && strcmp(sites[1].scope, "first") == 0);
+        ASSERT(sites[0].line == sites[1].line && sites[0].function == sites[1].function);
+
+        Memory::deallocate(blocks[0]);
+        Memory::deallocate(blocks[1]);
+    }
+
+#endif
+}
+
 void testUnique()
 {
     // Unique()
@@ -859,6 +1064,12 @@ void testBuffer()
     }
 }
 
+bool isInPlace(const String& s)
+{
+    const char_t* object = reinterpret_cast<const char_t*>(&s);
+    return s.chars() >= object && s.chars() < object + sizeof(String) / sizeof(char_t);
+}
+
 void testString()
 {
     const char* CHARS8 = "\x24\xc2\xa2\xe2\x82\xac\xf0\x90\x8d\x88";
@@ -1418,6 +1629,19 @@ void testString()
         ASSERT(s.find(String(), false) == INVALID_POSITION);
     }
 
+    {
+        // long strings are searched with a Searcher
+
+        String s('x', 5000);
+        s += STR("Needle");
+        s += String('x', 100);
+        ASSERT(s.find(String(STR("Needle"))) == 5000);
+        ASSERT(s.find(String(STR("needle"))) == INVALID_POSITION);
+        ASSERT(s.find(String(STR("NEEDLE")), false) == 5000);
+        ASSERT(s.find(String(STR("needle")), false, 4000) == 5000);
+        ASSERT(s.find(String(STR("needle")), false, 5001) == INVALID_POSITION);
+    }
+
     // int find(const char_t* chars, bool caseSensitive = true, int pos = 0) const
 
     {
@@ -2811,6 +3035,96 @@ void testString()
         Memory::deallocate(p);
     }
 
+    // in place storage
+
+    {
+        String s1(STR("short")), s2(STR("a string that doesn't fit in place"));
+        ASSERT(isInPlace(s1));
+        ASSERT(!isInPlace(s2));
+        ASSERT(!isInPlace(String()));
+    }
+
+    {
+        String s(STR("abc"));
+        s.append(STR("defghijklmnopqrstuvwxyz"));
+        ASSERT(!isInPlace(s));
+        ASSERT(s == STR("abcdefghijklmnopqrstuvwxyz"));
+
+        s.erase(3);
+        s.shrinkToLength();
+        ASSERT(isInPlace(s));
+        ASSERT(s == STR("abc"));
+        ASSERT(s.capacity() == 4);
+    }
+
+    {
+        const char_t* longChars = STR("a string that doesn't fit in place");
+        String s1(STR("a")), s2(STR("b")), s3(longChars), s4(STR("c"));
+
+        swap(s1, s2);
+        ASSERT(s1 == STR("b") && s2 == STR("a"));
+        ASSERT(isInPlace(s1) && isInPlace(s2));
+
+        swap(s1, s3);
+        ASSERT(s1 == longChars && s3 == STR("b"));
+        ASSERT(!isInPlace(s1) && isInPlace(s3));
+
+        swap(s1, s3);
+        ASSERT(s1 == STR("b") && s3 == longChars);
+        ASSERT(isInPlace(s1) && !isInPlace(s3));
+
+        String s5(static_cast<String&&>(s4));
+        ASSERT(s4.empty() && s5 == STR("c"));
+        ASSERT(isInPlace(s5));
+
+        s4 = static_cast<String&&>(s5);
+        ASSERT(s5.empty() && s4 == STR("c"));
+        ASSERT(isInPlace(s4));
+    }
+
+    {
+        String s(STR("a"));
+        char_t* p = s.release();
+        ASSERT(strCompare(p, STR("a")) == 0);
+        ASSERT(s.empty());
+
+        s = String::acquire(p);
+        ASSERT(s.chars() == p);
+        ASSERT(s == STR("a"));
+    }
+
+    {
+        Array<String> a;
+
+        for (int i = 0; i < 100; ++i)
+            a.addLast(String::from(i));
+
+        for (int i = 0; i < 100; ++i)
+        {
+            ASSERT(isInPlace(a[i]));
+            ASSERT(a[i].toInt() == i);
+        }
+    }
+
+#ifdef MEMORY_STATISTICS
+
+    // short strings don't allocate
+
+    {
+        String s1(STR("word")), s4;
+        int64_t allocations = Memory::statistics().allocations;
+
+        String s2(s1), s3 = s1.substr(1, 2);
+        s3 += STR("x");
+        s4 = s1 + s2;
+        swap(s1, s4);
+
+        ASSERT(Memory::statistics().allocations == allocations);
+        ASSERT(s1 == STR("wordword") && s3 == STR("orx"));
+    }
+
+#endif
+
     // String concat(_Args&&... args)
 
     ASSERT(String::concat(STR("")) == STR(""));
@@ -2916,7 +3230,8 @@ void testUnicode()
                                                0x20, 0xac, 0xd8, 0x00, 0xdf, 0x48, 0x00, 0x0a };
 
     // static String bytesToString(ByteBuffer& bytes, TextEncoding& encoding, bool& bom, bool& crLf)
-    // static String bytesToString(int size, byte_t* bytes, TextEncoding& encoding, bool& bom, bool& crLf)
+    // static String bytesToString(int size, byte_t* bytes, TextEncoding& encoding, bool& bom, bool& crLf,
+    //                             int limit = INT_MAX)
 
     {
         TextEncoding encoding;
@@ -3018,6 +3333,122 @@ void testUnicode()
         ByteBuffer bytes = Unicode::stringToBytes(str, TEXT_ENCODING_UTF16_BE, true, false);
         ASSERT(memcmp(bytes.values(), BYTES_UTF16_BE_BOM_UNIX, sizeof(BYTES_UTF16_BE_BOM_UNIX)) == 0);
     }
+
+    // long ASCII runs mixed with control and multibyte characters
+
+    {
+        const char* BYTES_LONG = "0123456789abcdef\tghijklmnopqrstuv\r\nwxyz\xc2\xa2" "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                 "\x01 0123456789abcdefghijklmnopqrstuvwxyz\r\n";
+        const char* BYTES_LONG_CRLF = "0123456789abcdef\tghijklmnopqrstuv\r\nwxyz\xc2\xa2" "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                      " 0123456789abcdefghijklmnopqrstuvwxyz\r\n";
+#ifdef CHAR_ENCODING_UTF8
+        const char_t* STR_LONG = "0123456789abcdef\tghijklmnopqrstuv\nwxyz\xc2\xa2" "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                 " 0123456789abcdefghijklmnopqrstuvwxyz\n";
+#else
+        const char_t* STR_LONG = u"0123456789abcdef\tghijklmnopqrstuv\nwxyz\x00a2" u"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                 u" 0123456789abcdefghijklmnopqrstuvwxyz\n";
+#endif
+
+        TextEncoding encoding;
+        bool bom, crLf;
+        String s = Unicode::bytesToString(strlen(BYTES_LONG), reinterpret_cast<const byte_t*>(BYTES_LONG),
+                                          encoding, bom, crLf);
+        ASSERT(s == STR_LONG);
+        ASSERT(encoding == TEXT_ENCODING_UTF8);
+        ASSERT(!bom);
+        ASSERT(crLf);
+
+        ByteBuffer bytes = Unicode::stringToBytes(s, TEXT_ENCODING_UTF8, false, true);
+        ASSERT(bytes.size() == static_cast<int>(strlen(BYTES_LONG_CRLF)));
+        ASSERT(memcmp(bytes.values(), BYTES_LONG_CRLF, bytes.size()) == 0);
+
+        bytes = Unicode::stringToBytes(s, TEXT_ENCODING_UTF8, false, false);
+        ASSERT(Unicode::bytesToString(bytes, encoding, bom, crLf) == STR_LONG);
+        ASSERT(!crLf);
+    }
+
+    // sequences cut off by the end of the text
+
+    {
+        const int lengths[] = { 100, 4095 };
+        const byte_t tails[][3] = { { 0xe2 }, { 0xf0 }, { 0xf0, 0x90, 0x8d } };
+        const int tailLengths[] = { 1, 1, 3 };
+
+        for (int length : lengths)
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                ByteBuffer bytes(length + tailLengths[i], 'a');
+                memcpy(bytes.values() + length, tails[i], tailLengths[i]);
+
+                TextEncoding encoding;
+                bool bom, crLf;
+                String s = Unicode::bytesToString(bytes, encoding, bom, crLf);
+                ASSERT(s == String(unichar_t('a'), length) + String(unichar_t(0xfffd)));
+                ASSERT(encoding == TEXT_ENCODING_UTF8);
+            }
+        }
+
+        const byte_t BYTES_UTF16_LE_CUT[] = { 0xff, 0xfe, 0x24, 0x00, 0x00, 0xd8 };
+
+        TextEncoding encoding;
+        bool bom, crLf;
+        String s = Unicode::bytesToString(sizeof(BYTES_UTF16_LE_CUT), BYTES_UTF16_LE_CUT, encoding, bom, crLf);
+        ASSERT(s == String(unichar_t('$')) + String(unichar_t(0xfffd)));
+        ASSERT(encoding == TEXT_ENCODING_UTF16_LE);
+    }
+
+    // large text is decoded in chunks with the same result as short text
+
+    {
+        const char* LINE_UTF8 = "abc\xe4\xb8\xad\xf0\x90\x8d\x88 def\r\n\xe4\xb8\xad\xe4\xb8\xad\n";
+        const byte_t* line = reinterpret_cast<const byte_t*>(LINE_UTF8);
+        int lineSize = strlen(LINE_UTF8);
+
+        TextEncoding encoding;
+        bool bom, crLf;
+        String lineStr = Unicode::bytesToString(lineSize, line, encoding, bom, crLf);
+        ByteBuffer lineUtf16 = Unicode::stringToBytes(lineStr, TEXT_ENCODING_UTF16_LE, false, true);
+
+        const int numLines = 600000;
+        ByteBuffer bytes(lineSize * numLines);
+        ByteBuffer bytesUtf16(lineUtf16.size() * numLines + 2);
+        String str;
+
+        bytesUtf16[0] = 0xff;
+        bytesUtf16[1] = 0xfe;
+        str.ensureCapacity(lineStr.length() * numLines + 1);
+
+        for (int i = 0; i < numLines; ++i)
+        {
+            memcpy(bytes.values() + i * lineSize, line, lineSize);
+            memcpy(bytesUtf16.values() + 2 + i * lineUtf16.size(), lineUtf16.values(), lineUtf16.size());
+            str += lineStr;
+        }
+
+        ASSERT(Unicode::bytesToString(bytes, encoding, bom, crLf) == str);
+        ASSERT(encoding == TEXT_ENCODING_UTF8);
+        ASSERT(crLf);
+
+        ASSERT(Unicode::bytesToString(bytesUtf16, encoding, bom, crLf) == str);
+        ASSERT(encoding == TEXT_ENCODING_UTF16_LE);
+        ASSERT(crLf);
+
+        // a limited decode ends where a character starts and is a prefix of the whole text
+
+        for (int limit = 0; limit <= lineSize * 2; ++limit)
+        {
+            String s = Unicode::bytesToString(bytes.size(), bytes.values(), encoding, bom, crLf, limit);
+            ASSERT(s.length() <= limit);
+            ASSERT(s == str.substr(0, s.length()));
+            ASSERT(encoding == TEXT_ENCODING_UTF8);
+
+            s = Unicode::bytesToString(bytesUtf16.size(), bytesUtf16.values(), encoding, bom, crLf, limit);
+            ASSERT(s == str.substr(0, s.length()));
+            ASSERT(encoding == TEXT_ENCODING_UTF16_LE);
+            ASSERT(bom);
+        }
+    }
 }
 
 void testStringIterator()
@@ -3102,72 +3533,492 @@ void testStringIterator()
     }
 }
 
-void testArray()
+void testSearcher()
 {
-    int elem[] = { 1, 2, 3 };
-    const int* np = nullptr;
-    const int* ep = elem;
-
-    // Array()
+    // Searcher()
+    // Searcher(const String& pattern, bool caseSensitive = true)
+    // const String& pattern() const
+    // bool caseSensitive() const
+    // bool empty() const
 
     {
-        Array<int> a;
-        ASSERT(a.size() == 0);
-        ASSERT(a.capacity() == 0);
-        ASSERT(!a.values());
-    }
+        Searcher s;
+        ASSERT(s.empty());
+        ASSERT(s.caseSensitive());
 
-    // Array(int size)
+        Searcher s2(STR("abc"), false);
+        ASSERT(!s2.empty());
+        ASSERT(s2.pattern() == STR("abc"));
+        ASSERT(!s2.caseSensitive());
+    }
 
-    ASSERT_EXCEPTION(Exception, Array<int> a(-1));
+    // void assign(const String& pattern, bool caseSensitive = true)
+    // void clear()
 
     {
-        Array<int> a(0);
-        ASSERT(a.size() == 0);
-        ASSERT(a.capacity() == 0);
-        ASSERT(!a.values());
+        Searcher s(STR("abc"));
+        s.assign(STR("xyz"), false);
+        ASSERT(s.pattern() == STR("xyz"));
+        ASSERT(!s.caseSensitive());
+        s.clear();
+        ASSERT(s.empty());
+        ASSERT(s.caseSensitive());
     }
 
+    // const char_t* find(const char_t* start, const char_t* end) const
+
     {
-        Array<int> a(1);
-        ASSERT(a.size() == 1);
-        ASSERT(a.capacity() == 1);
-        ASSERT(a.values());
-        ASSERT(a[0] == 0);
+        String str(STR("abracadabra Abracadabra ABRACADABRA \u0444\u0432\u0444"));
+        const char_t* start = str.chars();
+        const char_t* end = start + str.length();
+
+        ASSERT(Searcher().find(start, end) == nullptr);
+        ASSERT(Searcher(STR("a")).find(nullptr, nullptr) == nullptr);
+
+        ASSERT(Searcher(STR("a")).find(start, end) == start);
+        ASSERT(Searcher(STR("c")).find(start, end) == start + 4);
+        ASSERT(Searcher(STR("ab")).find(start + 1, end) == start + 7);
+        ASSERT(Searcher(STR("cadabra")).find(start, end) == start + 4);
+        ASSERT(Searcher(STR("Abracadabra")).find(start, end) == start + 12);
+        ASSERT(Searcher(STR("ABRACADABRA")).find(start, end) == start + 24);
+        ASSERT(Searcher(STR("abracadabrA")).find(start, end) == nullptr);
+        ASSERT(Searcher(STR("cadabra")).find(start, start + 10) == nullptr);
+        ASSERT(Searcher(STR("cadabra")).find(start, start + 11) == start + 4);
+
+        ASSERT(Searcher(STR("A"), false).find(start, end) == start);
+        ASSERT(Searcher(STR("ABRACADABRA"), false).find(start + 1, end) == start + 12);
+        ASSERT(Searcher(STR("rA a"), false).find(start, end) == start + 9);
+        ASSERT(Searcher(STR("dabra abr"), false).find(start, end) == start + 6);
+        ASSERT(Searcher(STR("xyz"), false).find(start, end) == nullptr);
+
+        String suffix(STR("\u0432\u0444"));
+        ASSERT(Searcher(suffix).find(start, end) == end - suffix.length());
+        ASSERT(Searcher(suffix, false).find(start, end) == end - suffix.length());
     }
+}
 
-    // Array(int size, const _Type& value)
+void testTextBuffer()
+{
+#ifdef CHAR_ENCODING_UTF8
+    const char_t* CHARS = "\x24\xc2\xa2\xe2\x82\xac\xf0\x90\x8d\x88";
+#else
+    const char_t* CHARS = u"\x0024\x00a2\x20ac\xd800\xdf48";
+#endif
 
-    ASSERT_EXCEPTION(Exception, Array<int> a(-1, 123));
+    // TextBuffer()
 
     {
-        Array<int> a(0, 123);
-        ASSERT(a.size() == 0);
-        ASSERT(a.capacity() == 0);
-        ASSERT(!a.values());
+        TextBuffer t;
+        ASSERT(t.length() == 0);
+        ASSERT(t.empty());
+        ASSERT(t.chars() == String());
+        ASSERT(t.charAt(0) == 0);
+        ASSERT(t.charForward(0) == 0);
+        ASSERT(t.charBack(0) == 0);
     }
 
+    // TextBuffer(const String& str)
+    // TextBuffer(const TextBuffer& other)
+    // TextBuffer(TextBuffer&& other)
+
     {
-        Array<int> a(1, 123);
-        ASSERT(a.size() == 1);
-        ASSERT(a.capacity() == 1);
-        ASSERT(a.values());
-        ASSERT(a[0] == 123);
-    }
+        TextBuffer t(String(STR("abc")));
+        ASSERT(t.length() == 3);
+        ASSERT(t.chars() == String(STR("abc")));
 
-    // Array(int size, const _Type* values)
+        t.insert(1, STR("123"));
 
-    ASSERT_EXCEPTION(Exception, Array<int>(-1, np));
-    ASSERT_EXCEPTION(Exception, Array<int>(1, np));
+        TextBuffer t2(t);
+        ASSERT(t2.chars() == String(STR("a123bc")));
 
-    {
-        Array<int> a(0, np);
-        ASSERT(a.size() == 0);
-        ASSERT(a.capacity() == 0);
-        ASSERT(!a.values());
+        TextBuffer t3(static_cast<TextBuffer&&>(t));
+        ASSERT(t.empty());
+        ASSERT(t3.chars() == String(STR("a123bc")));
     }
 
-    {
+    // void insert(int pos, const String& str)
+    // void insert(int pos, const char_t* chars, int len = -1)
+    // void insert(int pos, unichar_t ch, int n = 1)
+
+    {
+        TextBuffer t;
+        t.insert(0, STR("ad"));
+        t.insert(1, String(STR("bc")));
+        t.insert(4, 'e', 2);
+        t.insert(0, STR("xyz"), 1);
+        ASSERT(t.chars() == String(STR("xabcdee")));
+        ASSERT_EXCEPTION(Exception, t.insert(-1, STR("a")));
+        ASSERT_EXCEPTION(Exception, t.insert(8, STR("a")));
+    }
+
+    {
+        TextBuffer t;
+
+        for (int i = 0; i < 1000; ++i)
+            t.insert(t.length() / 2, i % 2 ? 'a' : 'b');
+
+        ASSERT(t.length() == 1000);
+        ASSERT(t.substr(0, 4) == STR("aaaa"));
+        ASSERT(t.substr(498, 4) == STR("aabb"));
+        ASSERT(t.substr(996) == STR("bbbb"));
+    }
+
+    // unichar_t charAt(int pos) const
+    // int charForward(int pos, int n = 1) const
+    // int charBack(int pos, int n = 1) const
+
+    {
+        TextBuffer t = String(CHARS);
+        int len = t.length();
+        t.insert(t.charForward(0, 2), STR("-"));
+
+        int p = 0;
+        ASSERT(t.charAt(p) == 0x24);
+        p = t.charForward(p);
+        ASSERT(t.charAt(p) == 0xa2);
+        p = t.charForward(p);
+        ASSERT(t.charAt(p) == '-');
+        p = t.charForward(p);
+        ASSERT(t.charAt(p) == 0x20ac);
+        p = t.charForward(p);
+        ASSERT(t.charAt(p) == 0x10348);
+        p = t.charForward(p);
+        ASSERT(p == len + 1);
+        ASSERT(t.charAt(p) == 0);
+        ASSERT(t.charForward(p) == p);
+
+        p = t.charBack(p);
+        ASSERT(t.charAt(p) == 0x10348);
+        p = t.charBack(p, 2);
+        ASSERT(t.charAt(p) == '-');
+        p = t.charBack(p, 5);
+        ASSERT(p == 0);
+        ASSERT_EXCEPTION(Exception, t.charAt(len + 2));
+    }
+
+    // int lineCount() const
+    // int lineStart(int line) const
+    // int lineEnd(int line) const
+    // int lineAt(int pos) const
+
+    {
+        TextBuffer t;
+        ASSERT(t.lineCount() == 1);
+        ASSERT(t.lineStart(1) == 0);
+        ASSERT(t.lineEnd(1) == 0);
+        ASSERT(t.lineAt(0) == 1);
+        ASSERT_EXCEPTION(Exception, t.lineStart(2));
+        ASSERT_EXCEPTION(Exception, t.lineAt(1));
+    }
+
+    {
+        TextBuffer t(String(STR("ab\ncd\n\nef")));
+        ASSERT(t.lineCount() == 4);
+        ASSERT(t.lineStart(2) == 3);
+        ASSERT(t.lineEnd(2) == 5);
+        ASSERT(t.lineStart(3) == 6);
+        ASSERT(t.lineEnd(3) == 6);
+        ASSERT(t.lineEnd(4) == 9);
+        ASSERT(t.lineAt(2) == 1);
+        ASSERT(t.lineAt(3) == 2);
+        ASSERT(t.lineAt(6) == 3);
+        ASSERT(t.lineAt(9) == 4);
+
+        t.insert(4, STR("x\ny"));
+        ASSERT(t.chars() == String(STR("ab\ncx\nyd\n\nef")));
+        ASSERT(t.lineCount() == 5);
+        ASSERT(t.lineStart(3) == 6);
+        ASSERT(t.lineAt(8) == 3);
+        ASSERT(t.lineStart(5) == 10);
+
+        t.erase(1, 6);
+        ASSERT(t.chars() == String(STR("ad\n\nef")));
+        ASSERT(t.lineCount() == 3);
+        ASSERT(t.lineEnd(1) == 2);
+        ASSERT(t.lineStart(3) == 4);
+
+        t.insert(0, '\n', 2);
+        ASSERT(t.lineCount() == 5);
+        ASSERT(t.lineAt(2) == 3);
+        ASSERT(t.lineStart(5) == 6);
+
+        t.replaceString(STR("\n"), STR("--"));
+        ASSERT(t.lineCount() == 1);
+        ASSERT(t.lineEnd(1) == t.length());
+    }
+
+    {
+        TextBuffer t;
+
+        for (int i = 0; i < 500; ++i)
+        {
+            int pos = (i * 7919) % (t.length() + 1);
+            t.insert(t.lineStart(t.lineAt(pos)), i % 3 ? STR("ab") : STR("\n"));
+
+            if (i % 5 == 0)
+                t.erase(t.length() / 3, t.length() / 10);
+        }
+
+        String s = t.substr(0);
+        int line = 1, start = 0;
+
+        for (int p = 0; p <= s.length(); ++p)
+        {
+            ASSERT(t.lineAt(p) == line);
+
+            if (p == s.length() || s.charAt(p) == '\n')
+            {
+                ASSERT(t.lineStart(line) == start);
+                ASSERT(t.lineEnd(line) == p);
+                start = p + 1;
+                ++line;
+            }
+        }
+
+        ASSERT(t.lineCount() == line - 1);
+    }
+
+    // String substr(int pos, int len = -1) const
+
+    {
+        TextBuffer t(String(STR("abcdef")));
+        t.insert(3, STR("123"));
+        t.insert(9, STR("!"));
+        t.erase(9, 1);
+        t.insert(3, STR("x"));
+        ASSERT(t.substr(0) == STR("abcx123def"));
+        ASSERT(t.substr(2, 4) == STR("cx12"));
+        ASSERT(t.substr(4, 6) == STR("123def"));
+        ASSERT(t.substr(10).empty());
+        ASSERT_EXCEPTION(Exception, t.substr(5, 6));
+    }
+
+    // void erase(int pos, int len = -1)
+    // void replace(int pos, const String& str, int len = -1)
+    // void replace(int pos, const char_t* chars, int len = -1)
+
+    {
+        TextBuffer t(String(STR("abcdef")));
+        t.erase(1, 2);
+        ASSERT(t.chars() == String(STR("adef")));
+        t.erase(3);
+        ASSERT(t.chars() == String(STR("ade")));
+        t.replace(1, String(STR("xyz")), 1);
+        ASSERT(t.chars() == String(STR("axyze")));
+        t.replace(0, STR("12"), 2);
+        ASSERT(t.chars() == String(STR("12yze")));
+        t.erase(0);
+        ASSERT(t.empty());
+        ASSERT_EXCEPTION(Exception, t.erase(0, 1));
+    }
+
+    // int find(const String& str, bool caseSensitive = true, int pos = 0) const
+    // bool startsWith(const char_t* chars, bool caseSensitive = true) const
+
+    {
+        TextBuffer t(String(STR("one two three")));
+        t.insert(4, STR("TWO "));
+        ASSERT(t.find(STR("two")) == 8);
+        ASSERT(t.find(STR("two"), false) == 4);
+        ASSERT(t.find(STR("two"), false, 5) == 8);
+        ASSERT(t.find(STR("four")) == INVALID_POSITION);
+        ASSERT(t.startsWith(STR("one")));
+        ASSERT(t.startsWith(STR("ONE"), false));
+        ASSERT(!t.startsWith(STR("two")));
+    }
+
+    // int find(const Searcher& searcher, int pos = 0, int end = -1) const
+
+    {
+        TextBuffer t(String(STR("one two three")));
+        ASSERT(t.find(Searcher(STR("two"))) == 4);
+
+        t.insert(5, STR("W"));
+        t.erase(5, 1);
+        ASSERT(t.find(Searcher(STR("two"))) == 4);
+        ASSERT(t.find(Searcher(STR("wo t"))) == 5);
+        ASSERT(t.find(Searcher(STR("TWO THREE"), false)) == 4);
+        ASSERT(t.find(Searcher(STR("e")), 3) == 11);
+        ASSERT(t.find(Searcher(STR("three")), 0, 12) == INVALID_POSITION);
+        ASSERT(t.find(Searcher(STR("three")), 0, 13) == 8);
+        ASSERT(t.find(Searcher(STR("one")), 1) == INVALID_POSITION);
+        ASSERT(t.find(Searcher(STR("one two three!"))) == INVALID_POSITION);
+        ASSERT(t.find(Searcher()) == INVALID_POSITION);
+        ASSERT_EXCEPTION(Exception, t.find(Searcher(STR("one")), 5, 4));
+    }
+
+    // void replaceString(const String& searchStr, const String& replaceStr, bool caseSensitive = true)
+
+    {
+        TextBuffer t(String(STR("a-b-c")));
+        t.insert(1, STR("-"));
+        t.replaceString(STR("-"), STR("+"));
+        ASSERT(t.chars() == String(STR("a++b+c")));
+        t.replaceString(STR("+"), String());
+        ASSERT(t.chars() == String(STR("abc")));
+        t.replaceString(STR("B"), STR("x"), false);
+        ASSERT(t.chars() == String(STR("axc")));
+        t.replaceString(STR("z"), STR("y"));
+        ASSERT(t.chars() == String(STR("axc")));
+    }
+
+    // void assign(const String& str)
+    // void assign(String&& str)
+    // void clear()
+
+    {
+        TextBuffer t;
+        t.assign(String(STR("abc")));
+        ASSERT(t.chars() == String(STR("abc")));
+
+        String s(STR("def"));
+        t.assign(static_cast<String&&>(s));
+        ASSERT(s.empty());
+        ASSERT(t.chars() == String(STR("def")));
+
+        t.insert(0, STR("x"));
+        ASSERT(t.chars() == String(STR("xdef")));
+
+        t.clear();
+        ASSERT(t.empty());
+        ASSERT(t.chars() == String());
+    }
+
+    // ConstTextBufferIterator
+
+    {
+        TextBuffer t = String(CHARS);
+        t.insert(t.charForward(0, 2), STR("-"));
+        auto iter = t.constIterator();
+
+        ASSERT_EXCEPTION(Exception, iter.value());
+        ASSERT(iter.moveNext());
+        ASSERT(iter.value() == 0x24);
+        ASSERT(iter.moveNext());
+        ASSERT(iter.value() == 0xa2);
+        ASSERT(iter.moveNext());
+        ASSERT(iter.value() == '-');
+        ASSERT(iter.moveNext());
+        ASSERT(iter.value() == 0x20ac);
+        ASSERT(iter.moveNext());
+        ASSERT(iter.value() == 0x10348);
+        ASSERT(!iter.moveNext());
+        ASSERT_EXCEPTION(Exception, iter.value());
+
+        ASSERT(iter.movePrev());
+        ASSERT(iter.value() == 0x10348);
+        ASSERT(iter.movePrev());
+        ASSERT(iter.value() == 0x20ac);
+        ASSERT(iter.movePrev());
+        ASSERT(iter.value() == '-');
+        iter.reset();
+        ASSERT(iter.moveNext());
+        ASSERT(iter.value() == 0x24);
+        ASSERT(!iter.movePrev());
+    }
+
+#ifdef MEMORY_STATISTICS
+
+    // decoding a large text into a list node holds a single copy of it
+
+    {
+        const int SIZE = 16 * 1024 * 1024;
+
+        ByteBuffer bytes(SIZE, 'a');
+        for (int i = 4095; i < SIZE; i += 4096)
+            bytes[i] = '\n';
+
+        List<TextBuffer> texts;
+        TextEncoding encoding;
+        bool bom, crLf;
+
+        Memory::resetPeakBytes();
+        int64_t bytesBefore = Memory::statistics().bytes;
+
+        auto node = texts.emplaceLast();
+        node->value.assign(Unicode::bytesToString(bytes.size(), bytes.values(), encoding, bom, crLf));
+        texts.emplaceLast(static_cast<TextBuffer&&>(node->value));
+
+        int64_t peakBytes = Memory::statistics().peakBytes - bytesBefore;
+        ASSERT(texts.last()->value.length() == SIZE);
+        ASSERT(peakBytes >= static_cast<int64_t>(SIZE * sizeof(char_t)));
+        ASSERT(peakBytes < static_cast<int64_t>(SIZE * sizeof(char_t)) * 11 / 10);
+
+        // the first insert grows the gap by a fraction of the text, not by the whole text
+
+        texts.last()->value.insert(0, 'a');
+        ASSERT(Memory::statistics().bytes - bytesBefore < static_cast<int64_t>(SIZE * sizeof(char_t)) * 11 / 10);
+    }
+
+#endif
+}
+
+void testArray()
+{
+    int elem[] = { 1, 2, 3 };
+    const int* np = nullptr;
+    const int* ep = elem;
+
+    // Array()
+
+    {
+        Array<int> a;
+        ASSERT(a.size() == 0);
+        ASSERT(a.capacity() == 0);
+        ASSERT(!a.values());
+    }
+
+    // Array(int size)
+
+    ASSERT_EXCEPTION(Exception, Array<int> a(-1));
+
+    {
+        Array<int> a(0);
+        ASSERT(a.size() == 0);
+        ASSERT(a.capacity() == 0);
+        ASSERT(!a.values());
+    }
+
+    {
+        Array<int> a(1);
+        ASSERT(a.size() == 1);
+        ASSERT(a.capacity() == 1);
+        ASSERT(a.values());
+        ASSERT(a[0] == 0);
+    }
+
+    // Array(int size, const _Type& value)
+
+    ASSERT_EXCEPTION(Exception, Array<int> a(-1, 123));
+
+    {
+        Array<int> a(0, 123);
+        ASSERT(a.size() == 0);
+        ASSERT(a.capacity() == 0);
+        ASSERT(!a.values());
+    }
+
+    {
+        Array<int> a(1, 123);
+        ASSERT(a.size() == 1);
+        ASSERT(a.capacity() == 1);
+        ASSERT(a.values());
+        ASSERT(a[0] == 123);
+    }
+
+    // Array(int size, const _Type* values)
+
+    ASSERT_EXCEPTION(Exception, Array<int>(-1, np));
+    ASSERT_EXCEPTION(Exception, Array<int>(1, np));
+
+    {
+        Array<int> a(0, np);
+        ASSERT(a.size() == 0);
+        ASSERT(a.capacity() == 0);
+        ASSERT(!a.values());
+    }
+
+    {
         Array<int> a(3, ep);
         ASSERT(a.size() == 3);
         ASSERT(a.capacity() == 3);
@@ -4022,6 +4873,111 @@ void testArrayIterator()
     }
 }
 
+void testMemoryPool()
+{
+    // MemoryPool(int blockSize, int blockAlignment, int blocksPerChunk = DEFAULT_BLOCKS_PER_CHUNK, bool arena = false)
+
+    {
+        MemoryPool pool(1, 1, 4);
+        ASSERT(pool.blockSize() == sizeof(void*));
+        ASSERT(pool.blocksPerChunk() == 4);
+        ASSERT(!pool.arena());
+        ASSERT(pool.numBlocks() == 0);
+        ASSERT(pool.numChunks() == 0);
+    }
+
+    {
+        MemoryPool pool(20, 8);
+        ASSERT(pool.blockSize() == 24);
+        ASSERT(pool.blocksPerChunk() == DEFAULT_BLOCKS_PER_CHUNK);
+    }
+
+    ASSERT_EXCEPTION(Exception, MemoryPool(0, 8));
+    ASSERT_EXCEPTION(Exception, MemoryPool(8, 3));
+    ASSERT_EXCEPTION(Exception, MemoryPool(8, 8, 0));
+
+    // void* allocate()
+    // void deallocate(void* block)
+
+    {
+        MemoryPool pool(24, 8, 4);
+        void* blocks[6];
+
+        for (int i = 0; i < 6; ++i)
+        {
+            blocks[i] = pool.allocate();
+            ASSERT(reinterpret_cast<uintptr_t>(blocks[i]) % 8 == 0);
+            memset(blocks[i], i, 24);
+        }
+
+        ASSERT(pool.numBlocks() == 6);
+        ASSERT(pool.numChunks() == 2);
+        ASSERT(static_cast<byte_t*>(blocks[1]) - static_cast<byte_t*>(blocks[0]) == 24);
+
+        pool.deallocate(blocks[2]);
+        pool.deallocate(blocks[4]);
+        pool.deallocate(nullptr);
+        ASSERT(pool.numBlocks() == 4);
+
+        // freed blocks are reused before the rest of the chunk
+        ASSERT(pool.allocate() == blocks[4]);
+        ASSERT(pool.allocate() == blocks[2]);
+        ASSERT(pool.numBlocks() == 6);
+        ASSERT(pool.numChunks() == 2);
+    }
+
+    {
+        MemoryPool pool(24, 8, 4, true);
+        ASSERT(pool.arena());
+
+        void* block = pool.allocate();
+        pool.deallocate(block);
+        ASSERT(pool.numBlocks() == 0);
+        ASSERT(pool.allocate() != block);
+    }
+
+    // void release()
+
+    {
+        MemoryPool pool(16, 16, 2);
+
+        for (int i = 0; i < 5; ++i)
+            ASSERT(reinterpret_cast<uintptr_t>(pool.allocate()) % 16 == 0);
+
+        ASSERT(pool.numChunks() == 3);
+
+        pool.release();
+        ASSERT(pool.numBlocks() == 0);
+        ASSERT(pool.numChunks() == 0);
+
+        pool.allocate();
+        ASSERT(pool.numChunks() == 1);
+    }
+
+    // NodePool
+
+    {
+        NodePool<ListNode<int>> pool;
+        ASSERT(pool.blockSize() == sizeof(ListNode<int>));
+
+        ListNode<int>* node = pool.allocate();
+        ASSERT(node);
+        pool.deallocate(node);
+    }
+
+#ifdef MEMORY_STATISTICS
+    {
+        int64_t allocations = Memory::statistics().allocations;
+
+        MemoryPool pool(32, 8, 16);
+        for (int i = 0; i < 100; ++i)
+            pool.allocate();
+
+        ASSERT(Memory::statistics().allocations - allocations == 7);
+    }
+#endif
+}
+
 void testList()
 {
     int elem[] = { 1, 2, 3 };
@@ -4391,6 +5347,30 @@ void testList()
         ASSERT(l.last()->value == 2);
     }
 
+    // ListNode<_Type>* emplaceFirst(_Args&&... args)
+    // ListNode<_Type>* emplaceLast(_Args&&... args)
+
+    {
+        List<String> l;
+        ASSERT(l.emplaceLast(STR("abc"), 2)->value == STR("ab"));
+        ASSERT(l.emplaceFirst('x', 3)->value == STR("xxx"));
+        ASSERT(l.emplaceLast()->value.empty());
+        ASSERT(l.first()->value == STR("xxx"));
+        ASSERT(l.first()->next->value == STR("ab"));
+        ASSERT(l.last()->prev->value == STR("ab"));
+        ASSERT(!l.first()->prev && !l.last()->next);
+    }
+
+    {
+        List<Unique<Test>> l;
+        l.emplaceFirst(createUnique<Test>(1));
+        l.emplaceFirst(createUnique<Test>(2));
+        l.emplaceLast(createUnique<Test>(3));
+        ASSERT(l.first()->value->val() == 2);
+        ASSERT(l.first()->next->value->val() == 1);
+        ASSERT(l.last()->value->val() == 3);
+    }
+
     // ListNode<_Type>* insertBefore(ListNode<_Type>* pos, const _Type& value)
 
     {
@@ -4535,6 +5515,101 @@ void testList()
         l.clear();
         ASSERT(l.empty());
     }
+
+    // List(Pool* pool)
+    // Pool* pool() const
+    // void pool(Pool* pool)
+
+    {
+        List<int>::Pool pool(4);
+
+        {
+            List<int> l(&pool);
+            ASSERT(l.pool() == &pool);
+
+            for (int i = 0; i < 10; ++i)
+                l.addLast(i);
+
+            l.removeFirst();
+            l.removeLast();
+            l.remove(l.first()->next);
+            l.emplaceFirst(10);
+            l.insertAfter(l.first(), 11);
+            ASSERT(pool.numBlocks() == 9);
+            ASSERT(pool.numChunks() == 3);
+            ASSERT(l.size() == 9);
+            ASSERT(l.first()->value == 10);
+            ASSERT(l.last()->value == 8);
+
+            // a copy doesn't share the pool, a move and swap carry it
+
+            List<int> l2(l);
+            ASSERT(l2.pool() == nullptr);
+            ASSERT(l2.size() == 9);
+            ASSERT(pool.numBlocks() == 9);
+
+            l2.assign(3, 1);
+            ASSERT(l2.pool() == nullptr);
+            ASSERT(pool.numBlocks() == 9);
+
+            List<int> l3(static_cast<List<int>&&>(l));
+            ASSERT(l3.pool() == &pool);
+            ASSERT(l3.size() == 9);
+
+            List<int> l4;
+            swap(l3, l4);
+            ASSERT(l3.pool() == nullptr);
+            ASSERT(l4.pool() == &pool);
+
+            l4.assign(3, 1);
+            ASSERT(pool.numBlocks() == 3);
+        }
+
+        ASSERT(pool.numBlocks() == 0);
+    }
+
+    {
+        List<int>::Pool pool;
+        List<int> l;
+        l.pool(&pool);
+        l.addLast(1);
+        ASSERT(pool.numBlocks() == 1);
+        ASSERT_EXCEPTION(Exception, l.pool(nullptr));
+    }
+
+    {
+        List<Unique<int>>::Pool pool(64, true);
+
+        {
+            List<Unique<int>> l(&pool);
+            l.addLast(createUnique<int>(1));
+            l.addLast(createUnique<int>(2));
+            l.removeFirst();
+            ASSERT(*l.first()->value == 2);
+        }
+
+        ASSERT(pool.numBlocks() == 0);
+        ASSERT(pool.numChunks() == 1);
+    }
+
+#ifdef MEMORY_STATISTICS
+    {
+        List<int>::Pool pool(128);
+        List<int> l(&pool);
+        int64_t allocations = Memory::statistics().allocations;
+
+        for (int i = 0; i < 1000; ++i)
+            l.addLast(i);
+
+        for (int i = 0; i < 1000; ++i)
+        {
+            l.removeFirst();
+            l.addLast(i);
+        }
+
+        ASSERT(Memory::statistics().allocations - allocations == 8);
+    }
+#endif
 }
 
 void testListIterator()
@@ -5047,6 +6122,51 @@ void testMap()
         m.rehash(10);
         m.clear();
     }
+
+    // Map(Pool* pool, int numBuckets = 0)
+    // Pool* pool() const
+
+    {
+        Map<String, int>::Pool pool;
+
+        {
+            Map<String, int> m(&pool, 3);
+            ASSERT(m.pool() == &pool);
+            ASSERT(m.numBuckets() == 3);
+
+            for (int i = 0; i < 100; ++i)
+                m[String::from(i)] = i;
+
+            ASSERT(m.size() == 100);
+            ASSERT(m.pool() == &pool);
+            ASSERT(pool.numBlocks() == 100);
+            ASSERT(*m.find(STR("42")) == 42);
+            ASSERT(m.remove(STR("42")));
+            ASSERT(pool.numBlocks() == 99);
+
+            Map<String, int> m2(m);
+            ASSERT(m2.pool() == nullptr);
+            ASSERT(m2.size() == 99);
+            ASSERT(pool.numBlocks() == 99);
+
+            Map<String, int> m3;
+            swap(m, m3);
+            ASSERT(m3.pool() == &pool);
+            ASSERT(m.pool() == nullptr);
+        }
+
+        ASSERT(pool.numBlocks() == 0);
+    }
+
+    {
+        Map<Unique<int>, Unique<int>>::Pool pool(64, true);
+        Map<Unique<int>, Unique<int>> m(&pool);
+        m.add(createUnique<int>(1), createUnique<int>(10));
+        m.add(createUnique<int>(2), createUnique<int>(20));
+        ASSERT(**m.find(createUnique<int>(2)) == 20);
+        m.clear();
+        ASSERT(pool.numBlocks() == 0);
+    }
 }
 
 void testMapIterator()
@@ -5314,6 +6434,7 @@ void testSet()
 
     {
         Set<int> s;
+        ASSERT(!s.contains(1));
         s.add(1);
 
         const Set<int>& cs = s;
@@ -5351,176 +6472,1536 @@ void testSet()
         ASSERT(s.contains(v));
     }
 
-    // void add(_Type&& value)
+    // void add(_Type&& value)
+
+    {
+        Set<int> s;
+        s.add(1);
+        ASSERT(s.contains(1));
+    }
+
+    // _Type remove()
+
+    ASSERT_EXCEPTION(Exception, Set<int>().remove());
+
+    {
+        Set<int> s;
+        s.add(1);
+        ASSERT(s.remove() == 1);
+    }
+
+    // bool remove(const _Type& value)
+
+    {
+        Set<int> s;
+        ASSERT(!s.remove(1));
+        s.add(1);
+        ASSERT(!s.remove(2));
+        ASSERT(s.remove(1));
+        ASSERT(s.empty());
+    }
+
+    // void clear()
+
+    {
+        Set<int> s;
+        s.add(1);
+        s.add(2);
+        s.clear();
+        ASSERT(s.empty());
+    }
+
+    // void rehash(int numBuckets)
+
+    {
+        Set<int> s;
+        ASSERT_EXCEPTION(Exception, s.rehash(-1));
+    }
+
+    {
+        Set<int> s;
+        s.rehash(0);
+        ASSERT(s.size() == 0);
+        ASSERT(s.numBuckets() == 0);
+    }
+
+    {
+        Set<int> s;
+        s.add(1);
+        s.add(2);
+        ASSERT(s.size() == 2);
+        ASSERT(s.numBuckets() == 3);
+
+        s.rehash(0);
+        ASSERT(s.size() == 2);
+        ASSERT(s.numBuckets() == 3);
+    }
+
+    {
+        Set<int> s;
+        s.add(1);
+        s.add(2);
+        ASSERT(s.size() == 2);
+        ASSERT(s.numBuckets() == 3);
+
+        s.rehash(10);
+        ASSERT(s.size() == 2);
+        ASSERT(s.numBuckets() == 10);
+    }
+
+    // Unique
+
+    {
+        Set<Unique<int>> s;
+        s.add(createUnique<int>(1));
+        ASSERT(s.contains(createUnique<int>(1)));
+    }
+
+    {
+        Set<Unique<int>> s;
+        s.add(createUnique<int>(1));
+        Unique<int> p = s.remove();
+        ASSERT(*p == 1);
+    }
+
+    {
+        Set<Unique<int>> s;
+        s.add(createUnique<int>(1));
+        ASSERT(!s.remove(createUnique<int>(2)));
+        ASSERT(s.remove(createUnique<int>(1)));
+    }
+
+    {
+        Set<Unique<int>> s;
+        s.add(createUnique<int>(1));
+        s.add(createUnique<int>(2));
+        s.rehash(10);
+        s.clear();
+    }
+
+    // Set(Pool* pool, int numBuckets = 0)
+    // Pool* pool() const
+
+    {
+        Set<int>::Pool pool;
+
+        {
+            Set<int> s(&pool, 3);
+            ASSERT(s.pool() == &pool);
+            ASSERT(s.numBuckets() == 3);
+
+            for (int i = 0; i < 100; ++i)
+                s.add(i);
+
+            ASSERT(s.size() == 100);
+            ASSERT(pool.numBlocks() == 100);
+            ASSERT(s.contains(42));
+            ASSERT(s.remove(42));
+            ASSERT(pool.numBlocks() == 99);
+
+            Set<int> s2(s);
+            ASSERT(s2.pool() == nullptr);
+            ASSERT(s2.size() == 99);
+            ASSERT(pool.numBlocks() == 99);
+        }
+
+        ASSERT(pool.numBlocks() == 0);
+    }
+}
+
+void testSetIterator()
+{
+    {
+        Set<int> s;
+        auto iter = s.constIterator();
+        ASSERT_EXCEPTION(Exception, iter.value());
+        ASSERT(!iter.moveNext());
+    }
+
+    {
+        Set<int> s;
+        s.add(1);
+        s.add(2);
+        s.add(3);
+
+        auto iter = s.constIterator();
+        int sum = 0;
+
+        ASSERT_EXCEPTION(Exception, iter.value());
+        ASSERT(iter.moveNext());
+        sum += iter.value();
+        ASSERT(iter.moveNext());
+        sum += iter.value();
+        ASSERT(iter.moveNext());
+        sum += iter.value();
+        ASSERT(!iter.moveNext());
+        ASSERT_EXCEPTION(Exception, iter.value());
+
+        ASSERT(sum == 6);
+    }
+
+    {
+        Set<int> s;
+        s.add(1);
+        s.add(2);
+        s.add(3);
+
+        auto iter = s.constIterator();
+        ASSERT_EXCEPTION(Exception, iter.value());
+        ASSERT(iter.moveNext());
+        ASSERT_NO_EXCEPTION(iter.value());
+        iter.reset();
+        ASSERT_EXCEPTION(Exception, iter.value());
+    }
+}
+
+void testFlatMap()
+{
+    // FlatMap(int numBuckets = 0)
+
+    ASSERT_EXCEPTION(Exception, FlatMap<int, int>(-1));
+
+    {
+        FlatMap<int, int> m;
+        ASSERT(m.size() == 0);
+        ASSERT(m.numBuckets() == 0);
+        ASSERT(m.maxLoadFactor() == 0.875f);
+        ASSERT(m.empty());
+        ASSERT(!m.find(1));
+        ASSERT(!m.remove(1));
+    }
+
+    {
+        FlatMap<int, int> m(10);
+        ASSERT(m.size() == 0);
+        ASSERT(m.numBuckets() == 16);
+        ASSERT(m.empty());
+    }
+
+    // FlatMap(const FlatMap<_Key, _Value>& other)
+
+    {
+        FlatMap<int, int> m1;
+        m1.add(1, 10);
+        FlatMap<int, int> m2(m1);
+        ASSERT(m1.size() == 1);
+        ASSERT(m2.size() == 1);
+        ASSERT(m2.numBuckets() == m1.numBuckets());
+        ASSERT(m2[1] == 10);
+    }
+
+    // FlatMap(FlatMap<_Key, _Value>&& other)
+
+    {
+        FlatMap<int, int> m1;
+        m1.add(1, 10);
+        FlatMap<int, int> m2(static_cast<FlatMap<int, int>&&>(m1));
+
+        ASSERT(m1.size() == 0);
+        ASSERT(m1.numBuckets() == 0);
+        ASSERT(m1.empty());
+
+        ASSERT(m2.size() == 1);
+        ASSERT(m2.numBuckets() == 8);
+        ASSERT(m2[1] == 10);
+    }
+
+    // _Value& operator[](const _Key& key)
+    // _Value& operator[](_Key&& key)
+    // const _Value& operator[](const _Key& key) const
+
+    {
+        FlatMap<int, int> m;
+        int k = 1;
+
+        m[k] = 10;
+        m[k] = 20;
+        m[2] = 30;
+        ASSERT(m.size() == 2);
+        ASSERT(m[k] == 20);
+        ASSERT(m[2] == 30);
+
+        const FlatMap<int, int>& cm = m;
+        ASSERT(cm[1] == 20);
+        ASSERT_EXCEPTION(Exception, cm[3]);
+    }
+
+    // FlatMap<_Key, _Value>& operator=(const FlatMap<_Key, _Value>& other)
+    // FlatMap<_Key, _Value>& operator=(FlatMap<_Key, _Value>&& other)
+    // void assign(const FlatMap<_Key, _Value>& other)
+
+    {
+        FlatMap<int, int> m1, m2, m3;
+        m1.add(1, 10);
+        m2 = m1;
+        ASSERT(m1.size() == 1);
+        ASSERT(m2[1] == 10);
+
+        m3 = static_cast<FlatMap<int, int>&&>(m1);
+        ASSERT(m1.empty());
+        ASSERT(m3[1] == 10);
+
+        m1.assign(m3);
+        ASSERT(m1[1] == 10);
+    }
+
+    // float loadFactor() const
+    // float maxLoadFactor() const
+    // void maxLoadFactor(float loadFactor)
+
+    {
+        FlatMap<int, int> m;
+        ASSERT(isnan(m.loadFactor()));
+
+        for (int i = 0; i < 7; ++i)
+            m.add(i, i);
+
+        ASSERT(m.numBuckets() == 8);
+        ASSERT(m.loadFactor() == 0.875f);
+
+        m.add(7, 7);
+        ASSERT(m.numBuckets() == 16);
+        ASSERT(m.loadFactor() == 0.5f);
+
+        ASSERT_EXCEPTION(Exception, m.maxLoadFactor(0));
+        ASSERT_EXCEPTION(Exception, m.maxLoadFactor(1));
+        m.maxLoadFactor(0.5f);
+        ASSERT(m.maxLoadFactor() == 0.5f);
+    }
+
+    // _Value* find(const _Key& key)
+    // const _Value* find(const _Key& key) const
+
+    {
+        FlatMap<int, int> m;
+        m.add(1, 10);
+        ASSERT(*m.find(1) == 10);
+        ASSERT(!m.find(2));
+
+        const FlatMap<int, int>& cm = m;
+        ASSERT(*cm.find(1) == 10);
+        ASSERT(!cm.find(2));
+    }
+
+    // void add(const _Key& key, const _Value& value)
+    // void add(_Key&& key, _Value&& value)
+    // bool remove(const _Key& key)
+
+    {
+        FlatMap<String, String> m;
+        String k = STR("a"), v = STR("b");
+        m.add(k, v);
+        m.add(STR("c"), STR("d"));
+        m.add(STR("c"), STR("e"));
+        ASSERT(m.size() == 2);
+        ASSERT(m[k] == STR("b"));
+        ASSERT(m[STR("c")] == STR("e"));
+
+        ASSERT(m.remove(STR("a")));
+        ASSERT(!m.remove(STR("a")));
+        ASSERT(m.size() == 1);
+        ASSERT(m[STR("c")] == STR("e"));
+    }
+
+    // colliding keys keep working after removal in the middle of a cluster
+
+    {
+        FlatMap<int, int> m(64);
+
+        for (int i = 0; i < 40; ++i)
+            m.add(i * 64, i);
+
+        for (int i = 0; i < 40; i += 3)
+            ASSERT(m.remove(i * 64));
+
+        for (int i = 0; i < 40; ++i)
+        {
+            if (i % 3 == 0)
+                ASSERT(!m.find(i * 64));
+            else
+                ASSERT(*m.find(i * 64) == i);
+        }
+    }
+
+    // void clear()
+    // void rehash(int numBuckets)
+
+    {
+        FlatMap<int, int> m;
+        ASSERT_EXCEPTION(Exception, m.rehash(-1));
+
+        m.rehash(0);
+        ASSERT(m.numBuckets() == 0);
+
+        m.add(1, 10);
+        m.add(2, 20);
+        m.rehash(0);
+        ASSERT(m.numBuckets() == 8);
+
+        m.rehash(100);
+        ASSERT(m.numBuckets() == 128);
+        ASSERT(m.size() == 2);
+        ASSERT(m[1] == 10 && m[2] == 20);
+
+        m.clear();
+        ASSERT(m.empty());
+        ASSERT(m.numBuckets() == 0);
+    }
+
+    // Unique
+
+    {
+        FlatMap<Unique<int>, Unique<int>> m;
+        m[createUnique<int>(1)] = createUnique<int>(10);
+        m.add(createUnique<int>(2), createUnique<int>(20));
+        m.add(createUnique<int>(2), createUnique<int>(30));
+        ASSERT(m.size() == 2);
+        ASSERT(**m.find(createUnique<int>(2)) == 30);
+        m.rehash(100);
+        ASSERT(m.remove(createUnique<int>(1)));
+        ASSERT(!m.remove(createUnique<int>(3)));
+        ASSERT(m.size() == 1);
+    }
+
+    // same contents as Map after random operations
+
+    {
+        Map<int, int> m1;
+        FlatMap<int, int> m2;
+        uint32_t seed = 1;
+
+        for (int i = 0; i < 100000; ++i)
+        {
+            seed = seed * 1103515245 + 12345;
+            int key = (seed >> 8) % 2000;
+
+            if (seed & 0x80000000)
+            {
+                ASSERT(m1.remove(key) == m2.remove(key));
+            }
+            else
+            {
+                m1[key] += i;
+                m2[key] += i;
+            }
+        }
+
+        ASSERT(m1.size() == m2.size());
+
+        for (auto iter = m2.constIterator(); iter.moveNext();)
+            ASSERT(m1[iter.value().key] == iter.value().value);
+    }
+}
+
+void testFlatMapIterator()
+{
+    {
+        FlatMap<int, int> m;
+        auto iter = m.iterator();
+        ASSERT_EXCEPTION(Exception, iter.value());
+        ASSERT(!iter.moveNext());
+    }
+
+    {
+        FlatMap<int, int> m;
+        m.add(1, 10);
+        m.add(2, 20);
+        m.add(3, 30);
+
+        auto iter = m.iterator();
+        int sum1 = 0, sum2 = 0;
+
+        while (iter.moveNext())
+        {
+            sum1 += iter.value().key;
+            iter.value().value += 1;
+        }
+
+        ASSERT_EXCEPTION(Exception, iter.value());
+
+        auto citer = m.constIterator();
+
+        while (citer.moveNext())
+            sum2 += citer.value().value;
+
+        ASSERT(sum1 == 6 && sum2 == 63);
+
+        ASSERT(citer.moveNext());
+        ASSERT_NO_EXCEPTION(citer.value());
+        citer.reset();
+        ASSERT_EXCEPTION(Exception, citer.value());
+    }
+}
+
+void testFlatSet()
+{
+    // FlatSet(int numBuckets = 0)
+
+    ASSERT_EXCEPTION(Exception, FlatSet<int>(-1));
+
+    {
+        FlatSet<int> s;
+        ASSERT(s.size() == 0);
+        ASSERT(s.numBuckets() == 0);
+        ASSERT(s.maxLoadFactor() == 0.875f);
+        ASSERT(s.empty());
+        ASSERT(!s.contains(1));
+        ASSERT(!s.remove(1));
+        ASSERT_EXCEPTION(Exception, s.remove());
+    }
+
+    {
+        FlatSet<int> s(20);
+        ASSERT(s.numBuckets() == 32);
+    }
+
+    // FlatSet(const FlatSet<_Type>& other)
+    // FlatSet(FlatSet<_Type>&& other)
+    // FlatSet<_Type>& operator=(const FlatSet<_Type>& other)
+    // FlatSet<_Type>& operator=(FlatSet<_Type>&& other)
+
+    {
+        FlatSet<int> s1;
+        s1.add(1);
+        FlatSet<int> s2(s1);
+        ASSERT(s1.contains(1) && s2.contains(1));
+
+        FlatSet<int> s3(static_cast<FlatSet<int>&&>(s1));
+        ASSERT(s1.empty() && s3.contains(1));
+
+        s1 = s3;
+        ASSERT(s1.contains(1));
+
+        FlatSet<int> s4;
+        s4 = static_cast<FlatSet<int>&&>(s3);
+        ASSERT(s3.empty() && s4.contains(1));
+    }
+
+    // void add(const _Type& value)
+    // void add(_Type&& value)
+    // bool contains(const _Type& value) const
+    // _Type remove()
+    // bool remove(const _Type& value)
+
+    {
+        FlatSet<String> s;
+        String a = STR("a");
+        s.add(a);
+        s.add(STR("b"));
+        s.add(STR("b"));
+        ASSERT(s.size() == 2);
+        ASSERT(s.contains(STR("a")) && s.contains(STR("b")));
+        ASSERT(!s.contains(STR("c")));
+
+        ASSERT(s.remove(STR("a")));
+        ASSERT(!s.remove(STR("a")));
+        ASSERT(s.remove() == STR("b"));
+        ASSERT(s.empty());
+    }
+
+    // void clear()
+    // void rehash(int numBuckets)
+
+    {
+        FlatSet<int> s;
+        ASSERT_EXCEPTION(Exception, s.rehash(-1));
+
+        for (int i = 0; i < 100; ++i)
+            s.add(i * 1024);
+
+        ASSERT(s.size() == 100);
+        ASSERT(s.numBuckets() == 128);
+
+        s.rehash(1000);
+        ASSERT(s.numBuckets() == 1024);
+
+        for (int i = 0; i < 100; ++i)
+            ASSERT(s.contains(i * 1024));
+
+        s.clear();
+        ASSERT(s.empty());
+        ASSERT(s.numBuckets() == 0);
+    }
+
+    // Unique
+
+    {
+        FlatSet<Unique<int>> s;
+        s.add(createUnique<int>(1));
+        s.add(createUnique<int>(1));
+        s.add(createUnique<int>(2));
+        ASSERT(s.size() == 2);
+        ASSERT(s.contains(createUnique<int>(2)));
+        ASSERT(s.remove(createUnique<int>(1)));
+        ASSERT(*s.remove() == 2);
+    }
+}
+
+void testFlatSetIterator()
+{
+    {
+        FlatSet<int> s;
+        auto iter = s.constIterator();
+        ASSERT_EXCEPTION(Exception, iter.value());
+        ASSERT(!iter.moveNext());
+    }
+
+    {
+        FlatSet<int> s;
+        s.add(1);
+        s.add(2);
+        s.add(3);
+
+        auto iter = s.constIterator();
+        int sum = 0;
+
+        while (iter.moveNext())
+            sum += iter.value();
+
+        ASSERT(sum == 6);
+        ASSERT_EXCEPTION(Exception, iter.value());
+
+        ASSERT(iter.moveNext());
+        iter.reset();
+        ASSERT_EXCEPTION(Exception, iter.value());
+    }
+}
+
+struct ThreadCounter
+{
+    Mutex mutex;
+    int count = 0;
+};
+
+void incrementCounter(void* param)
+{
+    ThreadCounter* counter = static_cast<ThreadCounter*>(param);
+
+    for (int i = 0; i < 10000; ++i)
+    {
+        MutexLock lock(counter->mutex);
+        ++counter->count;
+    }
+}
+
+void testThread()
+{
+    // void start(void (*func)(void*), void* param = nullptr)
+    // void join()
+
+    {
+        Thread t;
+        ASSERT(!t.started());
+        ASSERT_NO_EXCEPTION(t.join());
+    }
+
+    {
+        ThreadCounter counter;
+        Thread threads[4];
+
+        for (int i = 0; i < 4; ++i)
+        {
+            threads[i].start(incrementCounter, &counter);
+            ASSERT(threads[i].started());
+        }
+
+        ASSERT_EXCEPTION(Exception, threads[0].start(incrementCounter, &counter));
+
+        for (int i = 0; i < 4; ++i)
+        {
+            threads[i].join();
+            ASSERT(!threads[i].started());
+        }
+
+        ASSERT(counter.count == 40000);
+    }
+
+    {
+        ThreadCounter counter;
+        Thread t;
+
+        t.start(incrementCounter, &counter);
+        t.join();
+        t.start(incrementCounter, &counter);
+        t.join();
+
+        ASSERT(counter.count == 20000);
+    }
+
+    // static int processorCount()
+
+    ASSERT(Thread::processorCount() >= 1);
+}
+
+void testFoundation()
+{
+    testHash();
+    testSwapBytes();
+    testMemory();
+    testUnique();
+    testShared();
+    testBuffer();
+    testString();
+    testUnicode();
+    testStringIterator();
+    testSearcher();
+    testTextBuffer();
+    testArray();
+    testArrayIterator();
+    testMemoryPool();
+    testList();
+    testListIterator();
+    testMap();
+    testMapIterator();
+    testSet();
+    testSetIterator();
+    testFlatMap();
+    testFlatMapIterator();
+    testFlatSet();
+    testFlatSetIterator();
+    testThread();
+}
+
+template<typename _Highlighter>
+void highlightText(_Highlighter& highlighter, const TextBuffer& text, Array<HighlightingType>& types)
+{
+    types.assign(text.length(), HIGHLIGHTING_TYPE_NONE);
+
+    for (int p = 0; p < text.length(); p = text.charForward(p))
+    {
+        highlighter.highlightChar(text, p);
+        types[p] = highlighter.highlightingState().highlightingType;
+    }
+}
+
+void testHighlighter()
+{
+    // KeywordTable
+
+    {
+        KeywordTable table;
+        table.add(STR("if"), HIGHLIGHTING_TYPE_KEYWORD);
+        table.add(STR("int"), HIGHLIGHTING_TYPE_TYPE);
+
+        ASSERT(table.find(STR("if"), 2) == HIGHLIGHTING_TYPE_KEYWORD);
+        ASSERT(table.find(STR("int"), 3) == HIGHLIGHTING_TYPE_TYPE);
+        ASSERT(table.find(STR("integer"), 3) == HIGHLIGHTING_TYPE_TYPE);
+        ASSERT(table.find(STR("in"), 2) == HIGHLIGHTING_TYPE_NONE);
+        ASSERT(table.find(STR("if"), 0) == HIGHLIGHTING_TYPE_NONE);
+        ASSERT(table.find(STR("abcdefghijklmnopqrstuvwxyzabcdefgh"), 34) == HIGHLIGHTING_TYPE_NONE);
+    }
+
+    // CppSyntaxHighlighter
+
+    {
+        TextBuffer text(STR("#include <x>\nint f() { return 0x1f; } // c\n\"s\" /* m */"));
+        CppSyntaxHighlighter highlighter;
+        Array<HighlightingType> types;
+        highlightText(highlighter, text, types);
+
+        ASSERT(types[0] == HIGHLIGHTING_TYPE_PREPROCESSOR);
+        ASSERT(types[13] == HIGHLIGHTING_TYPE_TYPE);
+        ASSERT(types[17] == HIGHLIGHTING_TYPE_IDENT);
+        ASSERT(types[23] == HIGHLIGHTING_TYPE_KEYWORD);
+        ASSERT(types[30] == HIGHLIGHTING_TYPE_NUMBER);
+        ASSERT(types[38] == HIGHLIGHTING_TYPE_SINGLELINE_COMMENT);
+        ASSERT(types[44] == HIGHLIGHTING_TYPE_STRING);
+        ASSERT(types[50] == HIGHLIGHTING_TYPE_MULTILINE_COMMENT);
+        ASSERT(types[53] == HIGHLIGHTING_TYPE_MULTILINE_COMMENT);
+    }
+}
+
+// Map with its own node pool, the pool is a base so that it outlives the map
+
+template<typename _Key, typename _Value>
+struct MapNodePool
+{
+    typename Map<_Key, _Value>::Pool nodePool;
+
+    MapNodePool(bool arena) : nodePool(DEFAULT_BLOCKS_PER_CHUNK, arena)
+    {
+    }
+};
+
+template<typename _Key, typename _Value, bool _Arena>
+class PooledMap : protected MapNodePool<_Key, _Value>, public Map<_Key, _Value>
+{
+public:
+    PooledMap() : MapNodePool<_Key, _Value>(_Arena), Map<_Key, _Value>(&this->nodePool)
+    {
+    }
+};
+
+template<typename _MapType, typename _Key>
+void benchmarkMap(const char_t* name, const Array<_Key>& keys, const Array<_Key>& missingKeys)
+{
+#ifdef MEMORY_STATISTICS
+    MemoryStatistics before = Memory::statistics();
+#endif
+
+    int64_t start = Timer::ticks();
+    _MapType map;
+
+    for (int i = 0; i < keys.size(); ++i)
+        map[keys[i]] = i;
+
+    int64_t inserted = Timer::ticks();
+
+#ifdef MEMORY_STATISTICS
+    MemoryStatistics after = Memory::statistics();
+#endif
+
+    int found = 0;
+
+    for (int i = 0; i < keys.size(); ++i)
+    {
+        if (map.find(keys[i]))
+            ++found;
+    }
+
+    for (int i = 0; i < missingKeys.size(); ++i)
+    {
+        if (map.find(missingKeys[i]))
+            ++found;
+    }
+
+    int64_t searched = Timer::ticks();
+
+    for (int i = 0; i < keys.size(); ++i)
+        map.remove(keys[i]);
+
+    int64_t removed = Timer::ticks();
+
+    // Not an assert so that release builds don't optimize the lookups away
+    if (found != keys.size() || !map.empty())
+        throw Exception(STR("benchmark failed"));
+
+    Console::writeFormatted(STR("%-24s insert %7lld us, find %7lld us, remove %7lld us"), name,
+        static_cast<long long>(inserted - start), static_cast<long long>(searched - inserted),
+        static_cast<long long>(removed - searched));
+
+#ifdef MEMORY_STATISTICS
+    Console::writeFormatted(STR(", %lld bytes in %lld allocations"),
+        static_cast<long long>(after.bytes - before.bytes),
+        static_cast<long long>(after.allocations - before.allocations));
+#endif
+
+    Console::writeLine();
+}
+
+#ifdef MEMORY_STATISTICS
+
+void benchmarkStrings()
+{
+    // word indexing, current word lookups and command parsing as the editor does them
+
+    String line = STR("    for (int index = 0; index < document.lineCount(); ++index) ");
+    line += STR("addWordCount(_uniqueWords, currentWord, count); // update the autocomplete index\n");
+
+    String text;
+    for (int i = 0; i < 1000; ++i)
+        text += line;
+
+    TextBuffer buffer(text);
+    FlatMap<String, int> words;
+    int numStrings = 0;
+
+    int64_t allocations = Memory::statistics().allocations;
+
+    for (int p = 0; p < buffer.length();)
+    {
+        while (p < buffer.length() && !(charIsAlphaNum(buffer.charAt(p)) || buffer.charAt(p) == '_'))
+            ++p;
+
+        int q = p;
+        while (q < buffer.length() && (charIsAlphaNum(buffer.charAt(q)) || buffer.charAt(q) == '_'))
+            ++q;
+
+        if (q > p)
+        {
+            String word = buffer.substr(p, q - p);
+            ++words[word];
+            ++numStrings;
+        }
+
+        p = q;
+    }
+
+    for (int i = 0; i < 10000; ++i)
+    {
+        String command = String(STR(" goto ")) + String::from(i);
+        command.trim();
+
+        int space = command.find(' ');
+        String name = command.substr(0, space), arg = command.substr(space + 1);
+        ASSERT(arg.toInt() == i);
+        numStrings += 5;
+    }
+
+    // keys copied into the map
+    numStrings += words.size();
+
+    Console::writeLineFormatted(STR("string workload: %d strings, %lld allocations"), numStrings,
+        static_cast<long long>(Memory::statistics().allocations - allocations));
+}
+
+#endif
+
+void benchmarkContainers()
+{
+    const int SIZE = 100000;
+
+    Array<int> intKeys, missingIntKeys;
+    Array<String> stringKeys, missingStringKeys;
+    uint32_t seed = 1;
+
+    for (int i = 0; i < SIZE; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        intKeys.addLast(static_cast<int>(seed & ~1u));
+        missingIntKeys.addLast(static_cast<int>(seed | 1));
+        stringKeys.addLast(String::format(STR("identifier%d"), i));
+        missingStringKeys.addLast(String::format(STR("identifier%d"), i + SIZE));
+    }
+
+    benchmarkMap<Map<int, int>>(STR("Map<int, int>"), intKeys, missingIntKeys);
+    benchmarkMap<PooledMap<int, int, false>>(STR("Map<int, int> pool"), intKeys, missingIntKeys);
+    benchmarkMap<PooledMap<int, int, true>>(STR("Map<int, int> arena"), intKeys, missingIntKeys);
+    benchmarkMap<FlatMap<int, int>>(STR("FlatMap<int, int>"), intKeys, missingIntKeys);
+    benchmarkMap<Map<String, int>>(STR("Map<String, int>"), stringKeys, missingStringKeys);
+    benchmarkMap<PooledMap<String, int, false>>(STR("Map<String, int> pool"), stringKeys, missingStringKeys);
+    benchmarkMap<PooledMap<String, int, true>>(STR("Map<String, int> arena"), stringKeys, missingStringKeys);
+    benchmarkMap<FlatMap<String, int>>(STR("FlatMap<String, int>"), stringKeys, missingStringKeys);
+}
+
+int hashString(const String& val)
+{
+    return hash(val);
+}
+
+int hashMultiplyAdd(const String& val)
+{
+    // previous String hash, kept for comparison
+    uint32_t h = 0;
+
+    for (const char_t* p = val.chars(); *p; ++p)
+        h = 33 * h + static_cast<uint32_t>(*p);
+
+    return static_cast<int>(h);
+}
+
+int hashFnv(const String& val)
+{
+    uint32_t h = 2166136261u;
+
+    for (const char_t* p = val.chars(); *p; ++p)
+    {
+        h ^= static_cast<uint32_t>(*p);
+        h *= 16777619u;
+    }
+
+    return static_cast<int>(h);
+}
+
+void addIdentifiers(const String& filename, FlatSet<String>& identifiers)
+{
+    ByteBuffer bytes;
+
+    try
+    {
+        File file(filename);
+        bytes = file.read();
+    }
+    catch (Exception&)
+    {
+        return;
+    }
+
+    char_t word[256];
+    int len = 0;
+
+    for (int i = 0; i <= bytes.size(); ++i)
+    {
+        byte_t ch = i < bytes.size() ? bytes[i] : 0;
+
+        if (ch == '_' || isalpha(ch) || (len > 0 && isdigit(ch)))
+        {
+            if (len < 255)
+                word[len++] = ch;
+        }
+        else if (len > 0)
+        {
+            identifiers.add(String(word, len));
+            len = 0;
+        }
+    }
+}
+
+void benchmarkHashFunction(const char_t* name, int (*hashFunction)(const String&), const Array<String>& words)
+{
+    int numBytes = 0;
+    for (int i = 0; i < words.size(); ++i)
+        numBytes += words[i].length() * sizeof(char_t);
+
+    int rounds = max(1, 50000000 / max(numBytes, 1));
+    uint32_t sum = 0;
+    int64_t start = Timer::ticks();
+
+    for (int round = 0; round < rounds; ++round)
+    {
+        for (int i = 0; i < words.size(); ++i)
+            sum += hashFunction(words[i]);
+    }
+
+    int64_t time = max<int64_t>(Timer::ticks() - start, 1);
+
+    // keeps the loop from being optimized away
+    volatile uint32_t result = sum;
+    (void)result;
+
+    // distribution over a power of two table like FlatMap and an odd sized table like Map
+
+    int numBuckets = 1;
+    while (numBuckets < words.size() * 2)
+        numBuckets *= 2;
+
+    Array<int> powerBuckets(numBuckets, 0), oddBuckets(numBuckets + 1, 0);
+
+    for (int i = 0; i < words.size(); ++i)
+    {
+        uint32_t h = hashFunction(words[i]);
+        ++powerBuckets[h & (numBuckets - 1)];
+        ++oddBuckets[static_cast<int>(abs(static_cast<int>(h)) % (numBuckets + 1))];
+    }
+
+    int powerCollisions = 0, oddCollisions = 0, maxBucket = 0;
+
+    for (int i = 0; i < numBuckets; ++i)
+    {
+        powerCollisions += max(powerBuckets[i] - 1, 0);
+        oddCollisions += max(oddBuckets[i] - 1, 0);
+        maxBucket = max(maxBucket, powerBuckets[i]);
+    }
+
+    oddCollisions += max(oddBuckets[numBuckets] - 1, 0);
+
+    Console::writeLineFormatted(STR("%-16s %8.1f MB/s, collisions %5d (2^n) %5d (odd), max bucket %d"), name,
+        static_cast<double>(numBytes) * rounds / time, powerCollisions, oddCollisions, maxBucket);
+}
+
+void benchmarkHash(const Array<String>& filenames)
+{
+    // identifiers from the specified source files, or from the sources in the current directory
+
+    FlatSet<String> identifiers;
+
+    for (int i = 0; i < filenames.size(); ++i)
+        addIdentifiers(filenames[i], identifiers);
+
+    if (filenames.empty())
+    {
+        addIdentifiers(STR("foundation.h"), identifiers);
+        addIdentifiers(STR("editor.cpp"), identifiers);
+    }
+
+    if (identifiers.empty())
+    {
+        for (int i = 0; i < 10000; ++i)
+            identifiers.add(String::format(STR("identifier%d"), i));
+    }
+
+    Array<String> words;
+    for (auto iter = identifiers.constIterator(); iter.moveNext();)
+        words.addLast(iter.value());
+
+    double numBuckets = 1;
+    while (numBuckets < words.size() * 2)
+        numBuckets *= 2;
+
+    // collisions of an ideal random hash
+    double expected = words.size() - numBuckets * (1 - pow(1 - 1 / numBuckets, words.size()));
+
+    Console::writeLineFormatted(STR("%d identifiers, %d expected collisions"), words.size(), static_cast<int>(expected));
+
+    benchmarkHashFunction(STR("multiply add"), hashMultiplyAdd, words);
+    benchmarkHashFunction(STR("FNV-1a"), hashFnv, words);
+    benchmarkHashFunction(STR("hashBytes"), hashString, words);
+}
+
+// the C++ highlighter as it was before KeywordTable, kept as the baseline for benchmarkHighlighting()
+
+struct SetHighlightingState
+{
+    HighlightingType highlightingType = HIGHLIGHTING_TYPE_NONE;
+    int charsRemaining = 0;
+    bool reset = false;
+    unichar_t startCh = 0, prevCh = 0;
+    String word;
+};
+
+class SetCppSyntaxHighlighter
+{
+public:
+    SetCppSyntaxHighlighter();
+
+    const SetHighlightingState& highlightingState() const
+    {
+        return _highlightingState;
+    }
+
+    void highlightChar(const TextBuffer& text, int pos);
+
+protected:
+    Set<String> _keywords;
+    Set<String> _types;
+    Set<String> _preprocessor;
+    SetHighlightingState _highlightingState;
+};
+
+SetCppSyntaxHighlighter::SetCppSyntaxHighlighter()
+{
+    _keywords.add(String(STR("alignas")));
+    _keywords.add(String(STR("alignof")));
+    _keywords.add(String(STR("and")));
+    _keywords.add(String(STR("and_eq")));
+    _keywords.add(String(STR("asm")));
+    _keywords.add(String(STR("atomic_cancel")));
+    _keywords.add(String(STR("atomic_commit")));
+    _keywords.add(String(STR("atomic_noexcept")));
+    _keywords.add(String(STR("bitand")));
+    _keywords.add(String(STR("bitor")));
+    _keywords.add(String(STR("break")));
+    _keywords.add(String(STR("case")));
+    _keywords.add(String(STR("catch")));
+    _keywords.add(String(STR("class")));
+    _keywords.add(String(STR("compl")));
+    _keywords.add(String(STR("concept")));
+    _keywords.add(String(STR("const_cast")));
+    _keywords.add(String(STR("continue")));
+    _keywords.add(String(STR("co_await")));
+    _keywords.add(String(STR("co_return")));
+    _keywords.add(String(STR("co_yield")));
+    _keywords.add(String(STR("decltype")));
+    _keywords.add(String(STR("default")));
+    _keywords.add(String(STR("delete")));
+    _keywords.add(String(STR("do")));
+    _keywords.add(String(STR("dynamic_cast")));
+    _keywords.add(String(STR("else")));
+    _keywords.add(String(STR("enum")));
+    _keywords.add(String(STR("explicit")));
+    _keywords.add(String(STR("export")));
+    _keywords.add(String(STR("extern")));
+    _keywords.add(String(STR("false")));
+    _keywords.add(String(STR("for")));
+    _keywords.add(String(STR("friend")));
+    _keywords.add(String(STR("goto")));
+    _keywords.add(String(STR("if")));
+    _keywords.add(String(STR("import")));
+    _keywords.add(String(STR("inline")));
+    _keywords.add(String(STR("module")));
+    _keywords.add(String(STR("mutable")));
+    _keywords.add(String(STR("namespace")));
+    _keywords.add(String(STR("new")));
+    _keywords.add(String(STR("noexcept")));
+    _keywords.add(String(STR("not")));
+    _keywords.add(String(STR("not_eq")));
+    _keywords.add(String(STR("nullptr")));
+    _keywords.add(String(STR("operator")));
+    _keywords.add(String(STR("or")));
+    _keywords.add(String(STR("or_eq")));
+    _keywords.add(String(STR("private")));
+    _keywords.add(String(STR("protected")));
+    _keywords.add(String(STR("public")));
+    _keywords.add(String(STR("register")));
+    _keywords.add(String(STR("reflexpr")));
+    _keywords.add(String(STR("reinterpret_cast")));
+    _keywords.add(String(STR("requires")));
+    _keywords.add(String(STR("return")));
+    _keywords.add(String(STR("sizeof")));
+    _keywords.add(String(STR("static")));
+    _keywords.add(String(STR("static_assert")));
+    _keywords.add(String(STR("static_cast")));
+    _keywords.add(String(STR("struct")));
+    _keywords.add(String(STR("switch")));
+    _keywords.add(String(STR("synchronized")));
+    _keywords.add(String(STR("template")));
+    _keywords.add(String(STR("this")));
+    _keywords.add(String(STR("thread_local")));
+    _keywords.add(String(STR("throw")));
+    _keywords.add(String(STR("true")));
+    _keywords.add(String(STR("try")));
+    _keywords.add(String(STR("typedef")));
+    _keywords.add(String(STR("typeid")));
+    _keywords.add(String(STR("typename")));
+    _keywords.add(String(STR("union")));
+    _keywords.add(String(STR("using")));
+    _keywords.add(String(STR("virtual")));
+    _keywords.add(String(STR("while")));
+    _keywords.add(String(STR("xor")));
+    _keywords.add(String(STR("xor_eq")));
+    _keywords.add(String(STR("override")));
+    _keywords.add(String(STR("final")));
+    _keywords.add(String(STR("transaction_safe")));
+    _keywords.add(String(STR("transaction_safe_dynamic")));
+    _keywords.add(String(STR("_Pragma")));
+
+    _types.add(String(STR("auto")));
+    _types.add(String(STR("bool")));
+    _types.add(String(STR("byte")));
+    _types.add(String(STR("char")));
+    _types.add(String(STR("char16_t")));
+    _types.add(String(STR("char32_t")));
+    _types.add(String(STR("const")));
+    _types.add(String(STR("constexpr")));
+    _types.add(String(STR("double")));
+    _types.add(String(STR("float")));
+    _types.add(String(STR("int")));
+    _types.add(String(STR("long")));
+    _types.add(String(STR("short")));
+    _types.add(String(STR("signed")));
+    _types.add(String(STR("unsigned")));
+    _types.add(String(STR("void")));
+    _types.add(String(STR("volatile")));
+    _types.add(String(STR("wchar_t")));
+    _types.add(String(STR("int8_t")));
+    _types.add(String(STR("int16_t")));
+    _types.add(String(STR("int32_t")));
+    _types.add(String(STR("int64_t")));
+    _types.add(String(STR("uint8_t")));
+    _types.add(String(STR("uint16_t")));
+    _types.add(String(STR("uint32_t")));
+    _types.add(String(STR("uint64_t")));
+    _types.add(String(STR("intptr_t")));
+    _types.add(String(STR("uintptr_t")));
+    _types.add(String(STR("intmax_t")));
+    _types.add(String(STR("uintmax_t")));
+    _types.add(String(STR("size_t")));
+    _types.add(String(STR("ptrdiff_t")));
+    _types.add(String(STR("nullptr_t")));
+    _types.add(String(STR("max_align_t")));
+    _types.add(String(STR("unichar_t")));
+    _types.add(String(STR("char_t")));
+    _types.add(String(STR("byte_t")));
+
+    _preprocessor.add(String(STR("if")));
+    _preprocessor.add(String(STR("elif")));
+    _preprocessor.add(String(STR("else")));
+    _preprocessor.add(String(STR("endif")));
+    _preprocessor.add(String(STR("defined")));
+    _preprocessor.add(String(STR("ifdef")));
+    _preprocessor.add(String(STR("ifndef")));
+    _preprocessor.add(String(STR("define")));
+    _preprocessor.add(String(STR("undef")));
+    _preprocessor.add(String(STR("include")));
+    _preprocessor.add(String(STR("line")));
+    _preprocessor.add(String(STR("error")));
+    _preprocessor.add(String(STR("pragma")));
+}
+
+void SetCppSyntaxHighlighter::highlightChar(const TextBuffer& text, int pos)
+{
+    if (_highlightingState.charsRemaining > 0)
+    {
+        --_highlightingState.charsRemaining;
+        if (_highlightingState.charsRemaining > 0)
+            return;
+
+        if (_highlightingState.reset)
+            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_NONE;
+    }
+
+    unichar_t ch = text.charAt(pos);
+
+    if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_STRING)
+    {
+        if (_highlightingState.prevCh == '\\')
+            _highlightingState.prevCh = 0;
+        else if (ch == _highlightingState.startCh)
+        {
+            _highlightingState.charsRemaining = 1;
+            _highlightingState.reset = true;
+        }
+        else if (ch == '\\')
+            _highlightingState.prevCh = ch;
+
+        return;
+    }
+    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_NUMBER)
+    {
+        if (!(charIsDigit(ch) || ch == 'x' || ch == 'X' || ch == 'a' || ch == 'A' || ch == 'b' || ch == 'B' ||
+              ch == 'c' || ch == 'C' || ch == 'd' || ch == 'D' || ch == 'e' || ch == 'E' || ch == 'f' || ch == 'F' ||
+              ch == '.' || ch == '+' || ch == '-'))
+            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_NONE;
+        else
+            return;
+    }
+    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_SINGLELINE_COMMENT)
+    {
+        if (ch == '\n')
+        {
+            _highlightingState.charsRemaining = 1;
+            _highlightingState.reset = true;
+        }
+
+        return;
+    }
+    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_MULTILINE_COMMENT)
+    {
+        if (ch == '*')
+        {
+            pos = text.charForward(pos);
+
+            if (pos < text.length())
+            {
+                if (text.charAt(pos) == '/')
+                {
+                    _highlightingState.charsRemaining = 2;
+                    _highlightingState.reset = true;
+                }
+            }
+        }
+
+        return;
+    }
+    else if (_highlightingState.highlightingType == HIGHLIGHTING_TYPE_PREPROCESSOR)
+    {
+        if (ch == '\n')
+        {
+            if (_highlightingState.prevCh != '\\')
+            {
+                _highlightingState.charsRemaining = 1;
+                _highlightingState.reset = true;
+            }
+
+            _highlightingState.prevCh = 0;
+        }
+        else if (ch == '\\')
+            _highlightingState.prevCh = ch;
+
+        return;
+    }
+
+    if (ch == '"' || ch == '\'')
+    {
+        _highlightingState.startCh = ch;
+        _highlightingState.highlightingType = HIGHLIGHTING_TYPE_STRING;
+    }
+    else if (charIsDigit(ch))
+    {
+        _highlightingState.highlightingType = HIGHLIGHTING_TYPE_NUMBER;
+    }
+    else if (charIsAlphaNum(ch) || ch == '_')
+    {
+        int s = pos;
+
+        do
+        {
+            pos = text.charForward(pos);
+            if (pos < text.length())
+                ch = text.charAt(pos);
+            else
+                break;
+        } while (charIsAlphaNum(ch) || charIsDigit(ch) || ch == '_');
+
+        _highlightingState.word = text.substr(s, pos - s);
+        _highlightingState.charsRemaining = _highlightingState.word.charLength();
+        _highlightingState.reset = true;
+
+        if (_keywords.contains(_highlightingState.word))
+            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_KEYWORD;
+        else if (_types.contains(_highlightingState.word))
+            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_TYPE;
+        else
+            _highlightingState.highlightingType = HIGHLIGHTING_TYPE_IDENT;
+    }
+    else if (ch == '/')
+    {
+        pos = text.charForward(pos);
+
+        if (pos < text.length())
+        {
+            ch = text.charAt(pos);
+
+            if (ch == '*')
+            {
+                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_MULTILINE_COMMENT;
+                _highlightingState.charsRemaining = 2;
+                _highlightingState.reset = false;
+            }
+            else if (ch == '/')
+                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_SINGLELINE_COMMENT;
+        }
+    }
+    else if (ch == '#')
+    {
+        pos = text.charForward(pos);
+
+        if (pos < text.length())
+        {
+            ch = text.charAt(pos);
+            int q = pos;
 
-    {
-        Set<int> s;
-        s.add(1);
-        ASSERT(s.contains(1));
-    }
+            while (charIsAlpha(ch))
+            {
+                pos = text.charForward(pos);
+                if (pos < text.length())
+                    ch = text.charAt(pos);
+                else
+                    break;
+            }
 
-    // _Type remove()
+            _highlightingState.word = text.substr(q, pos - q);
 
-    ASSERT_EXCEPTION(Exception, Set<int>().remove());
+            if (_preprocessor.contains(_highlightingState.word))
+            {
+                _highlightingState.highlightingType = HIGHLIGHTING_TYPE_PREPROCESSOR;
 
-    {
-        Set<int> s;
-        s.add(1);
-        ASSERT(s.remove() == 1);
+                if (_highlightingState.word == STR("else") || _highlightingState.word == STR("endif"))
+                {
+                    _highlightingState.charsRemaining = _highlightingState.word.charLength() + 1;
+                    _highlightingState.reset = true;
+                }
+            }
+        }
     }
+}
 
-    // bool remove(const _Type& value)
-
+void addSource(const String& filename, String& source)
+{
+    try
     {
-        Set<int> s;
-        s.add(1);
-        ASSERT(!s.remove(2));
-        ASSERT(s.remove(1));
-        ASSERT(s.empty());
+        File file(filename);
+        TextEncoding encoding;
+        bool bom, crLf;
+        source += Unicode::bytesToString(file.read(), encoding, bom, crLf);
     }
-
-    // void clear()
-
+    catch (Exception&)
     {
-        Set<int> s;
-        s.add(1);
-        s.add(2);
-        s.clear();
-        ASSERT(s.empty());
     }
+}
 
-    // void rehash(int numBuckets)
+void benchmarkHighlighting(const Array<String>& filenames)
+{
+    // the specified C++ sources, or the ones in the current directory, repeated to about 5 MB
 
+    String source;
+
+    for (int i = 0; i < filenames.size(); ++i)
+        addSource(filenames[i], source);
+
+    if (filenames.empty())
     {
-        Set<int> s;
-        ASSERT_EXCEPTION(Exception, s.rehash(-1));
+        addSource(STR("foundation.h"), source);
+        addSource(STR("editor.cpp"), source);
     }
 
+    if (source.empty())
     {
-        Set<int> s;
-        s.rehash(0);
-        ASSERT(s.size() == 0);
-        ASSERT(s.numBuckets() == 0);
+        for (int i = 0; i < 10000; ++i)
+            source += String::format(STR("for (int i%d = 0; i%d < 10; ++i%d) // loop\n"), i, i, i);
     }
 
-    {
-        Set<int> s;
-        s.add(1);
-        s.add(2);
-        ASSERT(s.size() == 2);
-        ASSERT(s.numBuckets() == 3);
+    String str;
+    while (str.length() * static_cast<int>(sizeof(char_t)) < 5 * 1024 * 1024)
+        str += source;
 
-        s.rehash(0);
-        ASSERT(s.size() == 2);
-        ASSERT(s.numBuckets() == 3);
-    }
+    TextBuffer text(str);
+    double numBytes = static_cast<double>(text.length()) * sizeof(char_t);
 
-    {
-        Set<int> s;
-        s.add(1);
-        s.add(2);
-        ASSERT(s.size() == 2);
-        ASSERT(s.numBuckets() == 3);
+    SetCppSyntaxHighlighter baseline;
+    Array<HighlightingType> baselineTypes;
 
-        s.rehash(10);
-        ASSERT(s.size() == 2);
-        ASSERT(s.numBuckets() == 10);
-    }
+    int64_t start = Timer::ticks();
+    highlightText(baseline, text, baselineTypes);
+    int64_t baselineTime = max<int64_t>(Timer::ticks() - start, 1);
 
-    // Unique
+    CppSyntaxHighlighter highlighter;
+    Array<HighlightingType> types;
 
-    {
-        Set<Unique<int>> s;
-        s.add(createUnique<int>(1));
-        ASSERT(s.contains(createUnique<int>(1)));
-    }
+    start = Timer::ticks();
+    highlightText(highlighter, text, types);
+    int64_t time = max<int64_t>(Timer::ticks() - start, 1);
 
+    for (int i = 0; i < types.size(); ++i)
     {
-        Set<Unique<int>> s;
-        s.add(createUnique<int>(1));
-        Unique<int> p = s.remove();
-        ASSERT(*p == 1);
+        if (types[i] != baselineTypes[i])
+            throw Exception(STR("benchmark failed"));
     }
 
+    Console::writeLineFormatted(STR("highlighting %.1f MB"), numBytes / (1024 * 1024));
+    Console::writeLineFormatted(STR("%-16s %8.1f MB/s"), STR("Set<String>"), numBytes / baselineTime);
+    Console::writeLineFormatted(STR("%-16s %8.1f MB/s"), STR("KeywordTable"), numBytes / time);
+}
+
+void benchmarkUnicode()
+{
+    // the files under unicode/ in the current directory concatenated to about 64 MB
+
+    String text;
+
+    try
     {
-        Set<Unique<int>> s;
-        s.add(createUnique<int>(1));
-        ASSERT(!s.remove(createUnique<int>(2)));
-        ASSERT(s.remove(createUnique<int>(1)));
-    }
+        Array<DirectoryEntry> entries = Directory::entries(STR("unicode"));
 
+        for (int i = 0; i < entries.size(); ++i)
+        {
+            if (!entries[i].directory)
+                addSource(String(STR("unicode/")) + entries[i].name, text);
+        }
+    }
+    catch (Exception&)
     {
-        Set<Unique<int>> s;
-        s.add(createUnique<int>(1));
-        s.add(createUnique<int>(2));
-        s.rehash(10);
-        s.clear();
     }
-}
 
-void testSetIterator()
-{
+    if (text.empty())
     {
-        Set<int> s;
-        auto iter = s.constIterator();
-        ASSERT_EXCEPTION(Exception, iter.value());
-        ASSERT(!iter.moveNext());
+        Console::writeLine(STR("no files under unicode/"));
+        return;
     }
 
-    {
-        Set<int> s;
-        s.add(1);
-        s.add(2);
-        s.add(3);
+    String str;
+    while (str.length() * static_cast<int>(sizeof(char_t)) < 64 * 1024 * 1024)
+        str += text;
 
-        auto iter = s.constIterator();
-        int sum = 0;
+    const TextEncoding encodings[] = { TEXT_ENCODING_UTF8, TEXT_ENCODING_UTF16_LE };
+    const char_t* names[] = { STR("UTF-8"), STR("UTF-16") };
 
-        ASSERT_EXCEPTION(Exception, iter.value());
-        ASSERT(iter.moveNext());
-        sum += iter.value();
-        ASSERT(iter.moveNext());
-        sum += iter.value();
-        ASSERT(iter.moveNext());
-        sum += iter.value();
-        ASSERT(!iter.moveNext());
-        ASSERT_EXCEPTION(Exception, iter.value());
+    for (int i = 0; i < 2; ++i)
+    {
+        int64_t start = Timer::ticks();
+        ByteBuffer bytes = Unicode::stringToBytes(str, encodings[i], i > 0, false);
+        int64_t encodeTime = max<int64_t>(Timer::ticks() - start, 1);
 
-        ASSERT(sum == 6);
-    }
+        TextEncoding encoding;
+        bool bom, crLf;
 
-    {
-        Set<int> s;
-        s.add(1);
-        s.add(2);
-        s.add(3);
+        start = Timer::ticks();
+        String decoded = Unicode::bytesToString(bytes, encoding, bom, crLf);
+        int64_t decodeTime = max<int64_t>(Timer::ticks() - start, 1);
 
-        auto iter = s.constIterator();
-        ASSERT_EXCEPTION(Exception, iter.value());
-        ASSERT(iter.moveNext());
-        ASSERT_NO_EXCEPTION(iter.value());
-        iter.reset();
-        ASSERT_EXCEPTION(Exception, iter.value());
+        if (encoding != encodings[i] || decoded != str)
+            throw Exception(STR("benchmark failed"));
+
+        Console::writeLineFormatted(STR("%-16s %6.1f MB, bytesToString %5.2f GB/s, stringToBytes %5.2f GB/s"),
+            names[i], bytes.size() / (1024.0 * 1024.0), bytes.size() / (decodeTime * 1000.0),
+            bytes.size() / (encodeTime * 1000.0));
     }
 }
 
-void testFoundation()
+void runBenchmarks(const Array<String>& args)
 {
-    testSwapBytes();
-    testUnique();
-    testShared();
-    testBuffer();
-    testString();
-    testUnicode();
-    testStringIterator();
-    testArray();
-    testArrayIterator();
-    testList();
-    testListIterator();
-    testMap();
-    testMapIterator();
-    testSet();
-    testSetIterator();
+    Array<String> filenames;
+    for (int i = 2; i < args.size(); ++i)
+        filenames.addLast(args[i]);
+
+    benchmarkContainers();
+    benchmarkHash(filenames);
+    benchmarkHighlighting(filenames);
+    benchmarkUnicode();
+
+#ifdef MEMORY_STATISTICS
+    benchmarkStrings();
+#endif
 }
 
 void testFileOpenSuccess(bool exists, int openMode)
@@ -5746,6 +8227,177 @@ void testFile()
         f.write(sizeof(BYTES), BYTES);
         ASSERT(f.size() == 2 * sizeof(BYTES));
     }
+
+    // FileMapping(const File& file)
+    // const byte_t* data() const
+    // int64_t size() const
+
+    {
+        File f;
+        ASSERT_EXCEPTION(Exception, FileMapping m(f));
+    }
+
+    {
+        File f(STR("test.txt"));
+        FileMapping m(f);
+        ASSERT(m.size() == 2 * sizeof(BYTES));
+        ASSERT(memcmp(m.data(), BYTES, sizeof(BYTES)) == 0);
+        ASSERT(memcmp(m.data() + sizeof(BYTES), BYTES, sizeof(BYTES)) == 0);
+    }
+
+    {
+        File f(STR("test.txt"), FILE_MODE_READ | FILE_MODE_WRITE | FILE_MODE_TRUNCATE);
+        FileMapping m(f);
+        ASSERT(m.size() == 0);
+        ASSERT(m.data() == nullptr);
+    }
+
+#ifndef PLATFORM_WINDOWS
+    // reading a mapping of a file truncated after it was mapped
+
+    {
+        {
+            File f(STR("test.txt"), FILE_MODE_WRITE | FILE_MODE_TRUNCATE);
+            f.write(ByteBuffer(65536, 'a'));
+        }
+
+        File f(STR("test.txt"));
+        FileMapping m(f);
+        ASSERT(m.data()[0] == 'a');
+
+        File(STR("test.txt"), FILE_MODE_WRITE | FILE_MODE_TRUNCATE);
+
+        TextEncoding encoding;
+        bool bom, crLf;
+        ASSERT_EXCEPTION(Exception, Unicode::bytesToString(static_cast<int>(m.size()), m.data(), encoding, bom, crLf));
+    }
+#endif
+
+    // void writeText(const TextBuffer& text, TextEncoding encoding, bool bom, bool crLf)
+
+    {
+        TextBuffer text(STR("abc\ndef\n"));
+        text.insert(4, STR("\u0444\n"));
+
+        {
+            File f(STR("test.txt"), FILE_MODE_WRITE | FILE_MODE_TRUNCATE);
+            f.writeText(text, TEXT_ENCODING_UTF8, false, false);
+        }
+
+        {
+            File f(STR("test.txt"));
+            ByteBuffer bytes = f.read();
+            ASSERT(bytes.size() == 11 && memcmp(bytes.values(), "abc\n\xd1\x84\ndef\n", 11) == 0);
+        }
+
+        {
+            File f(STR("test.txt"), FILE_MODE_WRITE | FILE_MODE_TRUNCATE);
+            f.writeText(text, TEXT_ENCODING_UTF8, true, true);
+        }
+
+        {
+            File f(STR("test.txt"));
+            ByteBuffer bytes = f.read();
+            ASSERT(bytes.size() == 17 && memcmp(bytes.values(), "\xef\xbb\xbf" "abc\r\n\xd1\x84\r\ndef\r\n", 17) == 0);
+        }
+
+        {
+            File f(STR("test.txt"), FILE_MODE_WRITE | FILE_MODE_TRUNCATE);
+            f.writeText(text, TEXT_ENCODING_UTF16_BE, true, false);
+        }
+
+        {
+            File f(STR("test.txt"));
+            ByteBuffer bytes = f.read();
+            ASSERT(bytes.size() == 22 && memcmp(bytes.values(),
+                "\xfe\xff\0a\0b\0c\0\n\x04\x44\0\n\0d\0e\0f\0\n", 22) == 0);
+        }
+    }
+
+    {
+        String str;
+        for (int i = 0; i < 10000; ++i)
+            str += STR("line \u0444\u0430\n");
+
+        TextBuffer text(str);
+        text.insert(text.length() / 2, STR("x"));
+        str.insert(str.length() / 2, STR("x"));
+
+        {
+            File f(STR("test.txt"), FILE_MODE_WRITE | FILE_MODE_TRUNCATE);
+            f.writeText(text, TEXT_ENCODING_UTF16_LE, false, true);
+        }
+
+        File f(STR("test.txt"));
+        ByteBuffer bytes = f.read();
+        ByteBuffer expected = Unicode::stringToBytes(str, TEXT_ENCODING_UTF16_LE, false, true);
+        ASSERT(bytes.size() == expected.size() && memcmp(bytes.values(), expected.values(), bytes.size()) == 0);
+    }
+
+    // static void replace(const String& filename, const String& newFilename)
+
+    {
+        {
+            File f(STR("test2.txt"), FILE_MODE_WRITE | FILE_MODE_CREATE | FILE_MODE_TRUNCATE);
+            f.write(sizeof(BYTES), BYTES);
+            f.flush();
+        }
+
+        File::replace(STR("test.txt"), STR("test2.txt"));
+        ASSERT(!File::exists(STR("test2.txt")));
+
+        File f(STR("test.txt"));
+        ByteBuffer bytes = f.read();
+        ASSERT(bytes.size() == sizeof(BYTES) && memcmp(bytes.values(), BYTES, sizeof(BYTES)) == 0);
+
+        ASSERT_EXCEPTION(Exception, File::replace(STR("test.txt"), STR("test2.txt")));
+    }
+
+    // static bool canReplace(const String& filename)
+    // static String resolvePath(const String& filename)
+
+    {
+        ASSERT(File::canReplace(STR("test.txt")));
+        ASSERT(File::canReplace(STR("missing.txt")));
+        ASSERT(File::resolvePath(STR("missing.txt")) == STR("missing.txt"));
+
+#ifndef PLATFORM_WINDOWS
+        ASSERT(link("test.txt", "test2.txt") == 0);
+        ASSERT(!File::canReplace(STR("test.txt")));
+        File::remove(STR("test2.txt"));
+
+        ASSERT(symlink("test.txt", "test2.txt") == 0);
+        ASSERT(File::resolvePath(STR("test2.txt")) == File::resolvePath(STR("test.txt")));
+        ASSERT(File::resolvePath(STR("test.txt")).endsWith(STR("/test.txt")));
+        File::remove(STR("test2.txt"));
+#endif
+    }
+
+    // static bool exists(const String& path)
+    // static Array<DirectoryEntry> entries(const String& path)
+
+    {
+        ASSERT(Directory::exists(STR(".")));
+        ASSERT(!Directory::exists(STR("test.txt")));
+        ASSERT(!Directory::exists(STR("missing")));
+        ASSERT_EXCEPTION(Exception, Directory::entries(STR("missing")));
+
+        Array<DirectoryEntry> entries = Directory::entries(STR("."));
+        bool found = false;
+
+        for (int i = 0; i < entries.size(); ++i)
+        {
+            ASSERT(entries[i].name != STR(".") && entries[i].name != STR(".."));
+
+            if (entries[i].name == STR("test.txt"))
+            {
+                ASSERT(!entries[i].directory && entries[i].size == sizeof(BYTES));
+                found = true;
+            }
+        }
+
+        ASSERT(found);
+    }
 }
 
 void testConsole()
@@ -5811,6 +8463,16 @@ void testConsoleWrite()
 
     Console::writeLineFormatted(STR("%d"), 333);
     writeLineFormatted(STR("%d"), 444);
+
+    ConsoleStatistics statistics = Console::statistics();
+    Console::write(14, 10, STR("kkk"));
+    ASSERT(Console::statistics().writes > statistics.writes);
+    ASSERT(Console::statistics().bytes - statistics.bytes >= static_cast<int64_t>(3 * sizeof(char_t)));
+
+    statistics = Console::statistics();
+    Console::write(STR("lll"));
+    ASSERT(Console::statistics().writes == statistics.writes + 1);
+    ASSERT(Console::statistics().bytes == statistics.bytes + static_cast<int64_t>(3 * sizeof(char_t)));
 }
 
 void testConsoleColor()
@@ -6157,9 +8819,15 @@ void runTests()
     printPlatformInfo();
     testSupport();
     testFoundation();
+    testHighlighter();
 }
 
 void run(const Array<String>& args)
 {
-    runTests();
+    // "test bench [files]" runs the benchmarks, words for hashing are taken from the files
+
+    if (args.size() > 1 && args[1] == STR("bench"))
+        runBenchmarks(args);
+    else
+        runTests();
 }
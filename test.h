@@ -4,6 +4,7 @@
 #include <foundation.h>
 #include <console.h>
 #include <file.h>
+#include <highlighter.h>
 
 // Test
 